@@ -0,0 +1,110 @@
+#include "vire/lex/include.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <ostream>
+#include <string>
+
+// Measures the lexer's character scanning on a large generated source, in GB/s. It is built twice,
+// vire-bench-lex with the SIMD scanning the build targets and vire-bench-lex-scalar with
+// VIRE_SCAN_SCALAR, so running both compares the two. The size of the source in MiB can be passed,
+// 64 by default
+
+#if defined(VIRE_SCAN_BLOCKS) && defined(__AVX2__)
+static const char* scan_path="AVX2";
+#elif defined(VIRE_SCAN_BLOCKS)
+static const char* scan_path="SSE2";
+#else
+static const char* scan_path="scalar";
+#endif
+
+// Functions with long names, indentation, numbers and strings, repeated until `size` bytes
+static std::string generateSource(std::size_t size)
+{
+    std::string code;
+    code.reserve(size+1024);
+    for(std::size_t i=0; code.size()<size; ++i)
+    {
+        auto n=std::to_string(i);
+        code+="func compute_running_total_"+n+"(first_argument: int, second_argument: int) : int {\n";
+        code+="        let accumulated_value_"+n+" = first_argument * 1234567 + second_argument;\n";
+        code+="        for (let index_variable = 0; index_variable < 1000000; index_variable++) {\n";
+        code+="                accumulated_value_"+n+" = (accumulated_value_"+n+" + index_variable) % 1000003;\n";
+        code+="        }\n";
+        code+="        let message = \"the running total of the generated function number "+n+" is done\";\n";
+        code+="        return accumulated_value_"+n+" + 3.14159265;\n";
+        code+="}\n\n";
+    }
+    return code;
+}
+
+// Best of `rounds` runs of `run`, which goes over `bytes` bytes each time, in GB/s
+template<typename Run>
+static double measure(std::size_t bytes, int rounds, Run run)
+{
+    using clock=std::chrono::steady_clock;
+    double best=0;
+    for(int i=0; i<rounds; ++i)
+    {
+        auto start=clock::now();
+        run();
+        std::chrono::duration<double> time=clock::now()-start;
+        best=std::max(best, bytes/time.count()/1e9);
+    }
+    return best;
+}
+
+// Walks the whole of `text` with the scanner of `Class`, stepping over a character wherever a run ends
+template<typename Class, bool span>
+static std::size_t walk(std::string const& text)
+{
+    const char* p=text.data();
+    const char* end=p+text.size();
+    std::size_t stops=0;
+    while(p<end)
+    {
+        p+=span?vire::scan::span<Class>(p, end):vire::scan::find<Class>(p, end);
+        ++p;
+        ++stops;
+    }
+    return stops;
+}
+
+int main(int argc, char** argv)
+{
+    std::size_t mib=argc>1?std::strtoul(argv[1], nullptr, 10):64;
+    auto code=generateSource(std::max<std::size_t>(mib, 1)*1024*1024);
+    const int rounds=5;
+
+    // Volatile so the walks are not optimized out
+    volatile std::size_t sink=0;
+    std::cout << "scan: " << scan_path << ", source " << code.size()/(1024*1024) << "MiB" << std::endl;
+
+    std::size_t tokens=0;
+    double lex=measure(code.size(), rounds, [&]()
+    {
+        vire::errors::ErrorBuilder ebuilder("This program");
+        vire::VLexer lexer(code, &ebuilder);
+        vire::VTokenTable table;
+        lexer.tokenize(table);
+        tokens=table.size();
+    });
+    std::cout << "tokenize:        " << lex << " GB/s, " << tokens << " tokens" << std::endl;
+
+    // The same routines the lexer calls, alone
+    std::string ids(code.size(), 'a');
+    std::string spaces(code.size(), ' ');
+    for(std::size_t i=63; i<code.size(); i+=64)
+    {
+        ids[i]=' ';
+        spaces[i]='x';
+    }
+    std::cout << "span identifier: " << measure(ids.size(), rounds, [&]() { sink=sink+walk<vire::scan::IdChar, true>(ids); }) << " GB/s" << std::endl;
+    std::cout << "span whitespace: " << measure(spaces.size(), rounds, [&]() { sink=sink+walk<vire::scan::Space, true>(spaces); }) << " GB/s" << std::endl;
+    std::cout << "find quote:      " << measure(code.size(), rounds, [&]() { sink=sink+walk<vire::scan::Quote, false>(code); }) << " GB/s" << std::endl;
+    std::cout << "find brace:      " << measure(code.size(), rounds, [&]() { sink=sink+walk<vire::scan::Brace, false>(code); }) << " GB/s" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,89 @@
+#include "vire/includes.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <ostream>
+#include <sstream>
+#include <string>
+
+// Runs one program on the bytecode interpreter and through the JIT at O0 and prints how long each
+// took from the verified module to the exit code, code generation and lowering included. The
+// program can be replaced by passing a file, the default keeps arrays, structs and calls hot
+static const char* default_program=R"(
+struct P {
+ int x;
+ int y;
+}
+func dot(a: int[64], b: int[64]) : int {
+ let s = 0;
+ for (let i = 0; i < 64; i++) {
+  s = (s + a[i] * b[i]) % 1000003;
+ }
+ return s;
+}
+func shift(p: P, k: int) : int {
+ return (p.x * 31 + p.y + k) % 1000003;
+}
+func main() : int {
+ let a[64] : int;
+ let b[64] : int;
+ for (let i = 0; i < 64; i++) {
+  a[i] = i * 7 % 13;
+  b[i] = i * 5 % 11;
+ }
+ let p = P(1, 2);
+ let total = 0;
+ for (let r = 0; r < 20000; r++) {
+  total = (total + dot(a, b)) % 1000003;
+  p.x = shift(p, r);
+  a[r % 64] = total % 97;
+ }
+ return (total + p.x) % 256;
+}
+)";
+
+static std::unique_ptr<vire::VApi> load(std::string const& code)
+{
+    auto api=vire::VApi::loadFromText(code);
+    if(!api->parseSourceModule() || !api->verifySourceModule())
+    {
+        api->showErrors();
+        return nullptr;
+    }
+    return api;
+}
+
+int main(int argc, char** argv)
+{
+    std::string code=default_program;
+    if(argc>1)
+    {
+        std::ifstream file(argv[1]);
+        std::stringstream ss;
+        ss << file.rdbuf();
+        code=ss.str();
+    }
+
+    using clock=std::chrono::steady_clock;
+    int vm_exit=-1, jit_exit=-1;
+
+    auto vm_api=load(code);
+    if(!vm_api)
+        return 1;
+    auto vm_start=clock::now();
+    bool vm_ok=vm_api->runBytecode(vm_exit);
+    std::chrono::duration<double, std::milli> vm_time=clock::now()-vm_start;
+
+    auto jit_api=load(code);
+    if(!jit_api)
+        return 1;
+    auto jit_start=clock::now();
+    bool jit_ok=jit_api->runJIT(jit_exit, vire::Optimization::O0);
+    std::chrono::duration<double, std::milli> jit_time=clock::now()-jit_start;
+
+    std::cout << "bytecode: " << (vm_ok?"ok":"failed") << ", exit " << vm_exit << ", " << vm_time.count() << "ms" << std::endl;
+    std::cout << "jit O0:   " << (jit_ok?"ok":"failed") << ", exit " << jit_exit << ", " << jit_time.count() << "ms" << std::endl;
+
+    return (vm_ok && jit_ok && vm_exit==jit_exit)?0:1;
+}
@@ -0,0 +1,68 @@
+#include "vire/remote/include.hpp"
+
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <iterator>
+#include <ostream>
+#include <string>
+
+static int usage()
+{
+    std::cout << "Usage: vire-client [<file>|-] [-o <output>] [-O0|-O1|-O2|-O3|-Os|-Oz] [--lto] [-j <jobs>] [--target <target>] [--socket <path>]" << std::endl;
+    std::cout << "       vire-client --stop [--socket <path>]" << std::endl;
+    return 1;
+}
+
+// Compiles like VIRELANG does, `res/test.ve` to `./test.o` at O3 unless told otherwise, by asking a
+// running vire-server to. A file of `-` is read from the standard input
+int main(int argc, char** argv)
+{
+    std::string socket_path=vire::getDefaultSocketPath();
+    std::string input="res/test.ve";
+    std::string output="./test.o";
+
+    vire::CompileRequest request;
+    request.opt_level=vire::Optimization::O3;
+    for(int i=1; i<argc; ++i)
+    {
+        std::string arg=argv[i];
+        if(arg=="--socket" && i+1<argc)
+            socket_path=argv[++i];
+        else if(arg=="-o" && i+1<argc)
+            output=argv[++i];
+        else if(arg=="-j" && i+1<argc)
+            request.jobs=std::strtoul(argv[++i], nullptr, 10);
+        else if(arg=="--target" && i+1<argc)
+            request.target=argv[++i];
+        else if(arg=="--lto")
+            request.enable_lto=true;
+        else if(arg=="--stop")
+            request.command=vire::CompileRequest::stop;
+        else if(arg.size()>1 && arg[0]=='-' && vire::str_to_optimization.count(arg.substr(1)))
+            request.opt_level=vire::str_to_optimization.at(arg.substr(1));
+        else if(arg=="-" || arg[0]!='-')
+            input=arg;
+        else
+            return usage();
+    }
+
+    // The server has a working directory of its own
+    if(input=="-")
+        request.source.assign(std::istreambuf_iterator<char>(std::cin), std::istreambuf_iterator<char>());
+    else
+        request.path=std::filesystem::absolute(input).string();
+    request.output=std::filesystem::absolute(output).string();
+
+    vire::CompileResponse response;
+    if(!vire::VCompileClient(socket_path).send(request, response))
+        return 1;
+
+    std::cout << response.message << std::endl;
+    if(!response.success)
+        return 1;
+
+    if(request.command==vire::CompileRequest::compile)
+        std::cout << "---" << std::endl;
+    return 0;
+}
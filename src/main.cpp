@@ -1,8 +1,11 @@
 #include "vire/includes.hpp"
 
+#include <filesystem>
 #include <iostream>
 #include <ostream>
 #include <memory>
+#include <string>
+#include <vector>
 
 int entry()
 {
@@ -32,10 +35,85 @@ int entry()
 }
 
 #ifndef VIRE_USE_EMCC
-int main()
+// Each file is compiled to an object of the same name next to it, as many at once as there are cores
+int compileFiles(int count, char** files)
+{
+    std::vector<vire::BatchSource> sources;
+    for(int i=0; i<count; ++i)
+    {
+        vire::BatchSource source;
+        source.path=files[i];
+        source.output_file=std::filesystem::path(files[i]).replace_extension(".o").string();
+        sources.push_back(std::move(source));
+    }
+
+    vire::BatchOptions options;
+    options.opt_level=vire::Optimization::O3;
+    auto results=vire::VApi::compileBatch(sources, options);
+
+    int ret=0;
+    for(std::size_t i=0; i<results.size(); ++i)
+    {
+        auto const& result=results[i];
+        std::cout << "--- " << sources[i].path << std::endl;
+        std::cout << result.diagnostics;
+        if(!result.success)
+        {
+            std::cout << std::endl;
+            ret=1;
+            continue;
+        }
+        std::cout << "Compiled in " << result.parse_time+result.verify_time+result.compile_time << "ms" << std::endl;
+    }
+
+    return ret;
+}
+
+// --build root.ve [--build-dir dir] [-j threads]
+// Builds the module and what it imports into objects in the build directory, only what changed
+int buildModules(int count, char** args)
+{
+    std::filesystem::path root;
+    std::filesystem::path build_dir="build";
+    vire::BuildOptions options;
+    options.opt_level=vire::Optimization::O3;
+    for(int i=0; i<count; ++i)
+    {
+        std::string arg=args[i];
+        if(arg=="--build-dir" && i+1<count)
+            build_dir=args[++i];
+        else if(arg=="-j" && i+1<count)
+            options.threads=std::stoul(args[++i]);
+        else
+            root=arg;
+    }
+    if(root.empty())
+    {
+        std::cout << "No module to build was given" << std::endl;
+        return 1;
+    }
+
+    vire::VBuildDriver driver(build_dir, options);
+    std::vector<std::filesystem::path> objects;
+    bool success=driver.build(root, objects);
+    std::cout << "Compiled " << driver.getCompiledCount() << " modules, " << driver.getUpToDateCount() << " up to date" << std::endl;
+    if(!success)
+        return 1;
+
+    for(auto const& object : objects)
+        std::cout << object.string() << std::endl;
+    return 0;
+}
+
+int main(int argc, char** argv)
 {
     int ret=0;
-    ret=entry();
+    if(argc>1 && std::string(argv[1])=="--build")
+        ret=buildModules(argc-2, argv+2);
+    else if(argc>1)
+        ret=compileFiles(argc-1, argv+1);
+    else
+        ret=entry();
 
     return ret;
 }
@@ -0,0 +1,61 @@
+#include "vire/includes.hpp"
+#include "vire/remote/include.hpp"
+
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <ostream>
+#include <string>
+#include <thread>
+
+#include <pthread.h>
+
+static int usage()
+{
+    std::cout << "Usage: vire-server [--socket <path>] [--threads <count>]" << std::endl;
+    return 1;
+}
+
+int main(int argc, char** argv)
+{
+    std::string socket_path=vire::getDefaultSocketPath();
+    unsigned int threads=0;
+    for(int i=1; i<argc; ++i)
+    {
+        std::string arg=argv[i];
+        if(arg=="--socket" && i+1<argc)
+            socket_path=argv[++i];
+        else if(arg=="--threads" && i+1<argc)
+            threads=std::strtoul(argv[++i], nullptr, 10);
+        else
+            return usage();
+    }
+
+    // Blocked before any thread starts, so only the thread waiting for them ever sees them
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    vire::VCompileServer server(socket_path, threads);
+    if(!server.listen())
+        return 1;
+
+    std::thread waiter([&server, &signals]
+    {
+        int signal;
+        sigwait(&signals, &signal);
+        server.stop();
+    });
+
+    std::cout << "Listening on " << socket_path << std::endl;
+    server.serve();
+
+    // Stopped by a client, the waiter is still waiting
+    pthread_kill(waiter.native_handle(), SIGTERM);
+    waiter.join();
+
+    std::cout << "Served " << server.getRequestCount() << " requests" << std::endl;
+    return 0;
+}
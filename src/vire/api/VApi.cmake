@@ -2,6 +2,15 @@ add_library(
     vire-api
     ${SRC_DIR}/src/vire/api/VApi.hpp
     ${SRC_DIR}/src/vire/api/VApi.cpp
+    ${SRC_DIR}/src/vire/api/capture.hpp
+    ${SRC_DIR}/src/vire/api/capture.cpp
+    ${SRC_DIR}/src/vire/api/module.hpp
+    ${SRC_DIR}/src/vire/api/module.cpp
+    ${SRC_DIR}/src/vire/api/interface.hpp
+    ${SRC_DIR}/src/vire/api/interface.cpp
+    ${SRC_DIR}/src/vire/api/build.hpp
+    ${SRC_DIR}/src/vire/api/build.cpp
 )
 
-target_link_libraries(VIRELANG PRIVATE vire-api)
\ No newline at end of file
+target_link_libraries(vire-api PRIVATE vire-interpreter vire-tiering)
+target_link_libraries(VIRELANG PRIVATE vire-api)
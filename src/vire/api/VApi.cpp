@@ -1,21 +1,43 @@
 #include "VApi.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <fstream>
 #include <iostream>
+#include <iterator>
 #include <ostream>
 #include <string>
+#include <thread>
 #include "llvm/IR/Verifier.h"
+#include "llvm/Support/FileUtilities.h"
+
+#include "vire/v_interpreter/include.hpp"
+#include "vire/v_interpreter/tiering.hpp"
+
+#include "capture.hpp"
 
 namespace vire
 {
+// Identifiers past the interner's limit all become the same invalid symbol, nothing made from them
+// can be trusted
+static bool symbolsOverflowed()
+{
+    if(!proto::Interner::global().overflowed())
+        return false;
+    std::cout << "Too many distinct identifiers, the symbol table is full" << std::endl;
+    return true;
+}
+
 void VApi::internal_setup()
 {
 
 }
 
 VApi::VApi(std::unique_ptr<VParser> parser, std::unique_ptr<VCompiler> compiler, 
-     std::unique_ptr<errors::ErrorBuilder> ebuilder, std::string source_code, std::string target)
+     std::unique_ptr<errors::ErrorBuilder> ebuilder, std::unique_ptr<proto::SourceManager> sources,
+     std::unique_ptr<types::TypeContext> type_context, std::string target)
 : parser(std::move(parser)), compiler(std::move(compiler)), ebuilder(std::move(ebuilder)),
-  source_code(source_code), target(target)
+  sources(std::move(sources)), type_context(std::move(type_context)), target(target)
 {
     internal_setup();
 }
@@ -23,29 +45,138 @@ VApi::VApi(std::unique_ptr<VParser> parser, std::unique_ptr<VCompiler> compiler,
 VApi::VApi()
 {   }
 
-std::unique_ptr<VApi> VApi::loadFromFile(std::string input_file_path, std::string compilation_target)
+std::unique_ptr<VApi> VApi::loadFromFile(std::string input_file_path, std::string compilation_target, VCompilerSession* session)
 {
-    auto file=vire::proto::openFile(input_file_path);
-    std::string src=vire::proto::readFile(file, true);
+    auto sources=std::make_unique<proto::SourceManager>();
+    auto src=proto::SourceBuffer::fromFile(input_file_path);
+    auto start=sources->addBuffer(src, input_file_path);
 
+    // Each api compiles into its own type context, so several can run side by side
+    auto type_context=std::make_unique<types::TypeContext>();
     auto ebuilder=std::make_unique<errors::ErrorBuilder>("This program");
-    auto lexer=std::make_unique<VLexer>(src, ebuilder.get());
-    auto parser=std::make_unique<VParser>(std::move(lexer));
-    auto analyzer=std::make_unique<VAnalyzer>(ebuilder.get(), src);
-    auto compiler=std::make_unique<VCompiler>(std::move(analyzer));
+    auto lexer=std::make_unique<VLexer>(std::move(src), ebuilder.get(), start);
+    auto parser=std::make_unique<VParser>(std::move(lexer), nullptr, true, type_context.get());
+    auto analyzer=std::make_unique<VAnalyzer>(ebuilder.get(), sources.get(), type_context.get());
+    auto compiler=std::make_unique<VCompiler>(std::move(analyzer), "vire", session);
 
-    return std::make_unique<VApi>(std::move(parser), std::move(compiler), std::move(ebuilder), src, compilation_target);
+    auto api=std::make_unique<VApi>(std::move(parser), std::move(compiler), std::move(ebuilder), std::move(sources), std::move(type_context), compilation_target);
+    api->source_path=input_file_path;
+    return api;
 }
-std::unique_ptr<VApi> VApi::loadFromText(std::string input_code, std::string compilation_target)
+std::unique_ptr<VApi> VApi::loadFromText(std::string input_code, std::string compilation_target, VCompilerSession* session)
 {
+    auto sources=std::make_unique<proto::SourceManager>();
+    auto src=proto::SourceBuffer::fromString(std::move(input_code));
+    auto start=sources->addBuffer(src, "<text>");
+
+    // Each api compiles into its own type context, so several can run side by side
+    auto type_context=std::make_unique<types::TypeContext>();
     auto ebuilder=std::make_unique<errors::ErrorBuilder>("This program");
-    auto lexer=std::make_unique<VLexer>(input_code, ebuilder.get());
-    auto parser=std::make_unique<VParser>(std::move(lexer));
-    auto analyzer=std::make_unique<VAnalyzer>(ebuilder.get(), input_code);
-    auto compiler=std::make_unique<VCompiler>(std::move(analyzer));
+    auto lexer=std::make_unique<VLexer>(std::move(src), ebuilder.get(), start);
+    auto parser=std::make_unique<VParser>(std::move(lexer), nullptr, true, type_context.get());
+    auto analyzer=std::make_unique<VAnalyzer>(ebuilder.get(), sources.get(), type_context.get());
+    auto compiler=std::make_unique<VCompiler>(std::move(analyzer), "vire", session);
+
+    return std::make_unique<VApi>(std::move(parser), std::move(compiler), std::move(ebuilder), std::move(sources), std::move(type_context), compilation_target); 
+}
+#ifndef VIRE_USE_EMCC
+std::vector<BatchResult> VApi::compileBatch(std::vector<BatchSource> const& sources, BatchOptions const& options)
+{
+    std::vector<BatchResult> results(sources.size());
+    if(sources.empty())
+        return results;
+
+    std::unique_ptr<VCompilerSession> own_session;
+    auto* session=options.session;
+    if(!session)
+    {
+        own_session=std::make_unique<VCompilerSession>();
+        session=own_session.get();
+    }
+
+    unsigned int threads=options.threads;
+    if(threads==0)
+        threads=proto::ThreadPool::getDefaultThreadCount();
+    threads=(unsigned int)std::min<std::size_t>(threads, sources.size());
+
+    proto::ThreadPool pool(threads);
+    std::vector<std::thread::id> workers(pool.size());
+    pool.forEach(sources.size(), [&](std::size_t i, unsigned int worker)
+    {
+        workers[worker]=std::this_thread::get_id();
+        results[i]=compileBatchSource(sources[i], options, session);
+    });
+
+    // The pool's threads end with the batch, their contexts can go with them. The calling thread
+    // is worker 0 and keeps its own
+    for(unsigned int worker=1; worker<workers.size(); ++worker)
+    {
+        if(workers[worker]!=std::thread::id())
+            session->releaseContext(workers[worker]);
+    }
+
+    return results;
+}
+BatchResult VApi::compileBatchSource(BatchSource const& source, BatchOptions const& options, VCompilerSession* session)
+{
+    using clock=std::chrono::steady_clock;
+    auto since=[](clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(clock::now()-start).count();
+    };
+
+    BatchResult result;
+    VOutputCapture printed;
+    auto fail=[&](std::string const& why)
+    {
+        result.diagnostics=printed.take()+why;
+        return std::move(result);
+    };
+
+    if(options.write_to_file && source.output_file.empty())
+        return fail("No output file was given");
+
+    std::unique_ptr<VApi> api;
+    if(!source.path.empty())
+    {
+        std::error_code ec;
+        if(!std::filesystem::is_regular_file(source.path, ec))
+            return fail("File "+source.path+" does not exist");
+        api=loadFromFile(source.path, options.target, session);
+    }
+    else
+    {
+        api=loadFromText(source.code, options.target, session);
+    }
+    // The batch already keeps every core busy, a pool of the analyzer's own would multiply the threads
+    api->getCompiler()->getAnalyzer()->setThreadCount(1);
+    if(!options.ast_cache.empty())
+        api->setASTCache(options.ast_cache);
+    api->setLazyParsing(options.lazy_parsing);
+
+    auto start=clock::now();
+    api->parseSourceModule();
+    result.parse_time=since(start);
+
+    start=clock::now();
+    bool verified=api->verifySourceModule();
+    result.verify_time=since(start);
+    if(!verified)
+        return fail("Verification failed");
 
-    return std::make_unique<VApi>(std::move(parser), std::move(compiler), std::move(ebuilder), input_code, compilation_target); 
+    start=clock::now();
+    bool compiled=api->compileSourceModule(source.output_file, options.write_to_file, options.opt_level, options.enable_lto);
+    result.compile_time=since(start);
+    if(!compiled)
+        return fail("Compilation failed");
+
+    if(!options.write_to_file)
+        result.object=std::move(api->byte_output);
+    result.success=true;
+    result.diagnostics=printed.take();
+    return result;
 }
+#endif
 
 void VApi::showErrors() const
 {
@@ -55,6 +186,14 @@ errors::ErrorBuilder* const VApi::getErrorBuilder() const
 {
     return ebuilder.get();
 }
+proto::SourceManager* const VApi::getSourceManager() const
+{
+    return sources.get();
+}
+types::TypeContext* const VApi::getTypeContext() const
+{
+    return type_context.get();
+}
 VCompiler* const VApi::getCompiler() const
 {
     return compiler.get();
@@ -62,20 +201,98 @@ VCompiler* const VApi::getCompiler() const
 
 bool VApi::parseSourceModule()
 {
-    ast=parser->ParseSourceModule();
+    parser->setLazyBodies(lazy_parsing && !library);
+    ast=ast_cache.empty()?parser->ParseSourceModule():parseThroughCache();
+    parsed=true;
 
-    if(!ast)
+    if(!ast || symbolsOverflowed() || !resolveImports())
     {
+        ast=nullptr;
+        return 0;
+    }
+
+    // They all go in front of the module's own declarations
+    if(!importInterfaces(ast.get(), interfaces, sources.get(), type_context.get()))
+    {
+        ast=nullptr;
         return 0;
     }
     return 1;
 }
+// The module as the parser makes it, from the AST cache if the source is in it. What the parser
+// made is stored before imports are added to it
+std::unique_ptr<ModuleAST> VApi::parseThroughCache()
+{
+    auto buffer=sources?sources->getBuffer(source_start):nullptr;
+    if(!buffer)
+        return parser->ParseSourceModule();
+
+    // A lazily parsed module leaves functions out
+    std::string material=lazy_parsing && !library?"lazy\n":"whole\n";
+    material+=buffer->view();
+    auto path=ast_cache/(VSerializedModule::makeKey(material)+".vast");
+    std::error_code ec;
+    if(std::filesystem::is_regular_file(path, ec))
+    {
+        types::TypeContextScope type_scope(type_context.get());
+        if(auto module=VSerializedModule(proto::SourceBuffer::fromFile(path.string())).instantiate(source_start))
+            return module;
+    }
+
+    auto module=parser->ParseSourceModule();
+    std::string data;
+    if(module && VSerializedModule::write(*module, source_start, data))
+    {
+        // Another compiler may be writing the same file, whichever finishes last wins
+        auto temporary=path.string()+"-%%%%%%%%.tmp";
+        llvm::consumeError(llvm::writeFileAtomically(temporary, path.string(), llvm::StringRef(data.data(), data.size())));
+    }
+    return module;
+}
+// Reads the interfaces of the modules the source imports unless they were added
+bool VApi::resolveImports()
+{
+    if(!sources)
+        sources=std::make_unique<proto::SourceManager>();
+    if(imports_added || imports_resolved)
+        return true;
+
+    auto buffer=sources->getBuffer(source_start);
+    if(!buffer)
+        return true;
+
+    auto scan=scanModule(buffer);
+    std::string error;
+    interfaces.clear();
+    if(!collectImports(source_path, scan.imports, interfaces, error))
+    {
+        std::cout << error << std::endl;
+        interfaces.clear();
+        return false;
+    }
+
+    imports_resolved=true;
+    return true;
+}
+void VApi::addImport(std::string name, std::shared_ptr<const proto::SourceBuffer> interface)
+{
+    if(!imports_added)
+        interfaces.clear();
+    imports_added=true;
+    interfaces.push_back(ModuleInterface{std::move(name), std::move(interface)});
+}
+void VApi::setLibrary(bool is_library)
+{
+    library=is_library;
+    compiler->setEmitEntry(!is_library);
+}
 bool VApi::verifySourceModule()
 {
-    bool success=compiler->getAnalyzer()->verifySourceModule(std::move(ast));
+    bool success=compiler->getAnalyzer()->verifySourceModule(std::move(ast)) && !symbolsOverflowed();
+    verified=success;
     return success;
 }
-bool VApi::compileSourceModule(std::string const& output_file_path, bool write_to_file, Optimization opt_level, bool enable_lto)
+bool VApi::compileSourceModule(std::string const& output_file_path, bool write_to_file, Optimization opt_level, bool enable_lto, unsigned int jobs)
 {
     std::string out_file_path;
 
@@ -93,6 +310,35 @@ bool VApi::compileSourceModule(std::string const& output_file_path, bool write_t
         out_file_path=output_file_path;
     }
 
+    std::string cache_key;
+    if(object_cache)
+    {
+        cache_key=getCacheKey(opt_level, enable_lto);
+
+        std::vector<unsigned char> object;
+        if(!cache_key.empty() && object_cache->lookup(cache_key, object))
+        {
+            if(!write_to_file)
+            {
+                byte_output=std::move(object);
+                return true;
+            }
+
+            std::ofstream file(out_file_path, std::ios::binary);
+            file.write((char const*)object.data(), object.size());
+            return (bool)file;
+        }
+
+        // The front end only runs once it is known to be needed, and not again if it failed before
+        if(!verified)
+        {
+            if(parsed && !ast)
+                return false;
+            if((!parsed && !parseSourceModule()) || !verifySourceModule())
+                return false;
+        }
+    }
+
     compiler->compileModule();
 
     std::string errs;
@@ -107,19 +353,137 @@ bool VApi::compileSourceModule(std::string const& output_file_path, bool write_t
     
     if(!failure && write_to_file)
     {
-        compiler->compileToFile(output_file_path, target, opt_level, enable_lto);
+        compiler->compileToFile(out_file_path, target, opt_level, enable_lto, jobs);
+
+        if(!cache_key.empty())
+        {
+            std::ifstream file(out_file_path, std::ios::binary);
+            std::vector<unsigned char> object((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+            if(!object.empty())
+                object_cache->store(cache_key, object);
+        }
     }
     else if(!failure && !write_to_file)
     {
         byte_output=compiler->compileToString(target, opt_level, enable_lto);
+
+        if(!cache_key.empty() && !byte_output.empty())
+            object_cache->store(cache_key, byte_output);
     }
 
     return !failure;
 }
+// Empty when there is no source to key on
+std::string VApi::getCacheKey(Optimization opt_level, bool enable_lto)
+{
+    if(!sources)
+        return "";
+    auto buffer=sources->getBuffer(source_start);
+    if(!buffer || !resolveImports())
+        return "";
+
+    std::string triple, cpu;
+    VCompiler::resolveTarget(target, triple, cpu);
+    if(interfaces.empty() && !library && !lazy_parsing)
+        return VObjectCache::makeKey(buffer->view(), triple, cpu, opt_level, enable_lto);
+
+    // The object also depends on what the source imports, on whether it has a `main` and on which
+    // functions lazy parsing leaves out
+    std::string material=library?"library\n":lazy_parsing?"lazy program\n":"program\n";
+    for(auto const& interface : interfaces)
+    {
+        auto data=interface.data->view();
+        material+=std::to_string(data.size());
+        material+=':';
+        material+=data;
+    }
+    material+=buffer->view();
+    return VObjectCache::makeKey(material, triple, cpu, opt_level, enable_lto);
+}
+void VApi::setObjectCache(std::filesystem::path directory, std::uintmax_t max_size)
+{
+    object_cache=std::make_unique<VObjectCache>(std::move(directory), max_size);
+}
+void VApi::setLazyParsing(bool enable)
+{
+    lazy_parsing=enable;
+}
+void VApi::setASTCache(std::filesystem::path directory)
+{
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+    ast_cache=std::move(directory);
+}
+std::uint64_t VApi::getCacheHits() const
+{
+    return object_cache?object_cache->getHits():0;
+}
+std::uint64_t VApi::getCacheMisses() const
+{
+    return object_cache?object_cache->getMisses():0;
+}
+void VApi::setFunctionCache(bool enable)
+{
+    compiler->setFunctionCache(enable);
+}
 bool VApi::compileSourceModuleStringOpt(std::string const& output_file_path, bool write_to_file, std::string const& opt_level, bool enable_lto)
 {
     return compileSourceModule(output_file_path, write_to_file, str_to_optimization[opt_level], enable_lto);
 }
+bool VApi::runBytecode(int& exit_code)
+{
+    VBytecodeCompiler lowering(compiler->getAnalyzer());
+    auto module=lowering.compileModule();
+    if(!module)
+        return false;
+
+    VInterpreter interpreter(module.get());
+    for(auto const& [name, address] : host_symbols)
+        interpreter.addHostSymbol(name, address);
+
+    return interpreter.run(exit_code);
+}
+#ifndef VIRE_USE_EMCC
+bool VApi::runJIT(int& exit_code, Optimization opt_level, bool lazy)
+{
+    compiler->compileModule();
+
+    std::string errs;
+    llvm::raw_string_ostream os(errs);
+    bool failure=llvm::verifyModule(*compiler->getModule(), &os);
+    if(failure)
+    {
+        return false;
+    }
+
+    return compiler->runJIT(exit_code, opt_level, lazy);
+}
+bool VApi::runTiered(int& exit_code, Optimization opt_level)
+{
+    VBytecodeCompiler lowering(compiler->getAnalyzer());
+    auto module=lowering.compileModule();
+    if(!module)
+        return false;
+
+    VTierCompiler tier(compiler.get(), opt_level);
+    VInterpreter interpreter(module.get());
+    for(auto const& [name, address] : host_symbols)
+        interpreter.addHostSymbol(name, address);
+
+    // Without native calls there is nothing to promote to
+    if(VInterpreter::canCallNative())
+        interpreter.setPromotionHandler([&tier](BytecodeFunction* function) { tier.request(function); });
+
+    bool ran=interpreter.run(exit_code);
+    tier.stop();
+    return ran;
+}
+void VApi::addHostSymbol(std::string const& name, void* address)
+{
+    host_symbols[name]=address;
+    compiler->addHostSymbol(name, address);
+}
+#endif
 std::vector<unsigned char> const& VApi::getByteOutput()
 {
     return byte_output;
@@ -129,15 +493,35 @@ std::string const& VApi::getCompiledLLVMIR()
     return getCompiler()->getCompiledOutput();
 }
 
-// DEPRECATED
 void VApi::setSourceCode(std::string new_code)
 {
-    this->source_code=new_code;
+    if(compiler)
+        reset();
+    if(!sources)
+        sources=std::make_unique<proto::SourceManager>();
+
+    auto src=proto::SourceBuffer::fromString(std::move(new_code));
+    source_start=sources->addBuffer(src, "<text>");
+    // The new source may import other modules
+    imports_resolved=false;
+    if(ebuilder)
+    {
+        auto lexer=std::make_unique<VLexer>(std::move(src), ebuilder.get(), source_start);
+        parser=std::make_unique<VParser>(std::move(lexer), nullptr, true, type_context.get());
+    }
 }
 void VApi::reset()
 {
+    // Releasing a module frees its whole arena at once
     this->ast.reset();
+    this->compiler->getAnalyzer()->resetSourceModule();
     this->compiler->resetModule();
+    parsed=false;
+    verified=false;
+
+    // Nothing points at the module's types anymore, the structs it defined are forgotten too
+    if(type_context)
+        type_context->reset();
 }
 
 #ifdef VIRE_USE_EMCC
@@ -152,12 +536,22 @@ EMSCRIPTEN_BINDINGS(VAPI)
     .function("ParseSourceModule", &VApi::parseSourceModule)
     .function("VerifySourceModule", &VApi::verifySourceModule)
     .function("CompileSourceModule", &VApi::compileSourceModuleStringOpt)
+    .function("RunBytecode", optional_override([](VApi& api)
+    {
+        int exit_code=-1;
+        api.runBytecode(exit_code);
+        return exit_code;
+    }))
     .function("getByteOutput", &VApi::getByteOutput)
     .function("getCompiledLLVMIR", &VApi::getCompiledLLVMIR)
     .function("showErrors", &VApi::showErrors)
     .function("setSourceCode", &VApi::setSourceCode)
+    .function("setFunctionCache", &VApi::setFunctionCache)
     .function("reset", &VApi::reset)
-    .class_function("loadFromText", &VApi::loadFromText)
+    .class_function("loadFromText", optional_override([](std::string input_code, std::string compilation_target)
+    {
+        return VApi::loadFromText(std::move(input_code), std::move(compilation_target));
+    }))
     ;
 }
 
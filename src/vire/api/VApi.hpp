@@ -2,10 +2,13 @@
 
 #include <filesystem>
 #include <memory>
+#include <unordered_map>
 
 #include "vire/proto/include.hpp"
 #include "vire/v_compiler/include.hpp"
 
+#include "module.hpp"
+
 #ifdef VIRE_USE_EMCC
 #include <emscripten/emscripten.h>
 #include <emscripten/bind.h>
@@ -14,6 +17,45 @@
 namespace vire
 {
 
+// BatchSource - One source of a batch, `code` or else the file at `path`. Its object is written to
+// `output_file` if the batch writes files
+struct BatchSource
+{
+    std::string code;
+    std::string path;
+    std::string output_file;
+};
+
+struct BatchOptions
+{
+    std::string target="sys";
+    Optimization opt_level=Optimization::O0;
+    bool enable_lto=false;
+    // Otherwise each result holds its object
+    bool write_to_file=true;
+    // How many sources are compiled at once at most, 0 is one per hardware thread
+    unsigned int threads=0;
+    // Where target machines come from, a batch makes a session of its own without one
+    VCompilerSession* session=nullptr;
+    // Where parsed sources are cached, see VApi::setASTCache. Nothing is cached if empty
+    std::filesystem::path ast_cache;
+    // See VApi::setLazyParsing
+    bool lazy_parsing=false;
+};
+
+struct BatchResult
+{
+    bool success=false;
+    // What the compiler printed for the source, and why it failed if it did
+    std::string diagnostics;
+    std::vector<unsigned char> object;
+
+    // Milliseconds spent in each stage
+    double parse_time=0;
+    double verify_time=0;
+    double compile_time=0;
+};
+
 class VApi
 {
     std::unique_ptr<VParser> parser;
@@ -21,31 +63,100 @@ class VApi
     std::unique_ptr<ModuleAST> ast;
     std::unique_ptr<errors::ErrorBuilder> ebuilder;
 
-    std::string source_code;
+    std::unique_ptr<proto::SourceManager> sources;
+    proto::SourceLocation source_start=proto::SourceLocation(proto::SourceManager::first_offset);
+    std::unique_ptr<types::TypeContext> type_context;
     std::string target;
+    std::unordered_map<std::string, void*> host_symbols;
+    std::unique_ptr<VObjectCache> object_cache;
+    std::filesystem::path ast_cache;
+    bool lazy_parsing=false;
+    bool parsed=false;
+    bool verified=false;
+
+    // Where imports are looked for when none were added, the working directory for text
+    std::filesystem::path source_path;
+    std::vector<ModuleInterface> interfaces;
+    bool imports_added=false;
+    bool imports_resolved=false;
+    bool library=false;
 
     std::vector<unsigned char> byte_output;
 private:
     void internal_setup();
+    bool resolveImports();
+    std::unique_ptr<ModuleAST> parseThroughCache();
+    std::string getCacheKey(Optimization opt_level, bool enable_lto);
+#ifndef VIRE_USE_EMCC
+    static BatchResult compileBatchSource(BatchSource const& source, BatchOptions const& options, VCompilerSession* session);
+#endif
 
 public:
     VApi(std::unique_ptr<VParser> parser, std::unique_ptr<VCompiler> compiler, 
-    std::unique_ptr<errors::ErrorBuilder> ebuilder, std::string source_code="", std::string target="sys");
+    std::unique_ptr<errors::ErrorBuilder> ebuilder, std::unique_ptr<proto::SourceManager> sources=nullptr,
+    std::unique_ptr<types::TypeContext> type_context=nullptr, std::string target="sys");
     VApi();
 
-    static std::unique_ptr<VApi> loadFromFile(std::string input_file_path, std::string compilation_target="sys");
-    static std::unique_ptr<VApi> loadFromText(std::string input_code, std::string compilation_target="sys");
+    // With a `session` the compiler takes its context and target machines from it, see VCompilerSession
+    static std::unique_ptr<VApi> loadFromFile(std::string input_file_path, std::string compilation_target="sys", VCompilerSession* session=nullptr);
+    static std::unique_ptr<VApi> loadFromText(std::string input_code, std::string compilation_target="sys", VCompilerSession* session=nullptr);
+#ifndef VIRE_USE_EMCC
+    // Compiles every source on its own, up to `options.threads` of them at once. Each gets a parser,
+    // analyzer and types of its own and an LLVMContext no other source uses at the same time.
+    // The results are in the order of `sources`
+    static std::vector<BatchResult> compileBatch(std::vector<BatchSource> const& sources, BatchOptions const& options=BatchOptions());
+#endif
 
     bool parseSourceModule();
     bool verifySourceModule();
-    bool compileSourceModule(std::string const& output_file_name="", bool write_to_file=true, Optimization opt_level=Optimization::O0, bool enable_lto=false);
+    // `jobs` above 1 splits code generation for a file over that many threads. With an object
+    // cache set, a source compiled before with the same options is taken from the cache; called
+    // right after loading, a hit then skips parsing and verification too
+    bool compileSourceModule(std::string const& output_file_name="", bool write_to_file=true, Optimization opt_level=Optimization::O0, bool enable_lto=false, unsigned int jobs=1);
     bool compileSourceModuleStringOpt(std::string const& output_file_name="", bool write_to_file=true, std::string const& opt_level="O0", bool enable_lto=false);
+    // Runs the verified module's `main` in the bytecode interpreter alone, nothing goes through LLVM
+    bool runBytecode(int& exit_code);
+#ifndef VIRE_USE_EMCC
+    // Compiles the module in memory and runs its `main` without writing or linking an object,
+    // `exit_code` is what it returned. With `lazy` only the functions that are called get compiled
+    bool runJIT(int& exit_code, Optimization opt_level=Optimization::O0, bool lazy=false);
+    // Starts running the module in the bytecode interpreter right away and moves the functions that
+    // get hot to native code compiled at `opt_level` in the background
+    bool runTiered(int& exit_code, Optimization opt_level=Optimization::O2);
+    // A function the module's externs can call when it runs in process
+    void addHostSymbol(std::string const& name, void* address);
+#endif
+
+    // The interface of a module the source imports, see VModuleInterface. Once one is added the api
+    // reads no other modules, every module imported directly or not has to be added after the ones it
+    // imports. Without any the imports are read from the files they name
+    void addImport(std::string name, std::shared_ptr<const proto::SourceBuffer> interface);
+    // A library is imported by other modules, it gets no `main` of its own
+    void setLibrary(bool is_library);
+    // Only the functions a program's `main` or its top-level statements can reach are parsed and
+    // compiled, the bodies of the others are skipped without being lexed and are not checked for
+    // errors. Libraries export every function and are always parsed whole
+    void setLazyParsing(bool enable);
+
+    // Objects are cached in `directory`, which other compilers may share, up to `max_size` bytes
+    void setObjectCache(std::filesystem::path directory, std::uintmax_t max_size=std::uintmax_t(512)*1024*1024);
+    std::uint64_t getCacheHits() const;
+    std::uint64_t getCacheMisses() const;
+    // Parsed modules are kept in `directory` as VSerializedModule files named after the source, a
+    // source that was parsed before is read from there instead of lexed and parsed again
+    void setASTCache(std::filesystem::path directory);
+    // For sessions that compile the same module over and over as it is edited, each function that
+    // did not change is copied from the last compilation instead of compiled again
+    void setFunctionCache(bool enable);
 
+    // Replaces the source the next parse reads, the compiler is kept along with what it cached
     void setSourceCode(std::string new_code);
     void reset();
 
     void showErrors() const;
     errors::ErrorBuilder* const getErrorBuilder() const;
+    proto::SourceManager* const getSourceManager() const;
+    types::TypeContext* const getTypeContext() const;
     VCompiler* const getCompiler() const;
 
     std::vector<unsigned char> const& getByteOutput();
@@ -0,0 +1,432 @@
+#include "build.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <ostream>
+#include <sstream>
+#include <thread>
+#include <unordered_set>
+
+#include "llvm/Support/FileUtilities.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
+
+#include "VApi.hpp"
+#include "capture.hpp"
+#include "module.hpp"
+
+namespace vire
+{
+    // Changes whenever the state file does, a state from another version is ignored
+    static char const* const state_header="vire-build 2";
+
+    static std::uint64_t hashText(std::string_view text)
+    {
+        return llvm::xxHash64(llvm::StringRef(text.data(), text.size()));
+    }
+    static std::string toHex(std::uint64_t value)
+    {
+        static char const* const hex="0123456789abcdef";
+        std::string text(16, '0');
+        for(int i=15; i>=0; --i, value>>=4)
+            text[i]=hex[value & 0xF];
+        return text;
+    }
+    static bool writeFile(std::filesystem::path const& path, std::string_view text)
+    {
+        auto temporary=path.string()+"-%%%%%%%%.tmp";
+        auto error=llvm::writeFileAtomically(temporary, path.string(), llvm::StringRef(text.data(), text.size()));
+        if(error)
+        {
+            llvm::errs() << "Could not write " << path.string() << ": " << llvm::toString(std::move(error)) << "\n";
+            return false;
+        }
+        return true;
+    }
+
+    VBuildDriver::VBuildDriver(std::filesystem::path build_dir, BuildOptions options)
+    : build_dir(std::move(build_dir)), options(std::move(options))
+    {   }
+
+    std::filesystem::path VBuildDriver::getStatePath() const
+    {
+        return build_dir/"modules.state";
+    }
+    std::filesystem::path VBuildDriver::getInterfacePath(Module const& module) const
+    {
+        return build_dir/(module.id+".vif");
+    }
+    std::filesystem::path VBuildDriver::getObjectPath(Module const& module) const
+    {
+        return build_dir/(module.id+".o");
+    }
+
+    // A module takes a line with its path, one with what was known of its source, one per import
+    // and one each with the keys of its interface and its object
+    void VBuildDriver::loadState(std::unordered_map<std::string, Module>& previous) const
+    {
+        std::ifstream file(getStatePath());
+        std::string line;
+        if(!std::getline(file, line) || line!=state_header)
+            return;
+
+        while(std::getline(file, line))
+        {
+            Module module;
+            module.source=line;
+
+            std::size_t import_count=0;
+            if(!std::getline(file, line))
+                return;
+            std::istringstream fields(line);
+            fields >> module.id >> module.size >> module.mtime >> module.source_hash >> module.decl_hash
+                >> module.interface_hash >> module.has_entry >> import_count;
+            if(!fields)
+                return;
+
+            for(std::size_t i=0; i<import_count; ++i)
+            {
+                if(!std::getline(file, line))
+                    return;
+                module.import_names.push_back(line);
+            }
+            if(!std::getline(file, module.interface_key) || !std::getline(file, module.built_key))
+                return;
+
+            previous[module.source.string()]=std::move(module);
+        }
+    }
+    bool VBuildDriver::saveState() const
+    {
+        std::ostringstream state;
+        state << state_header << '\n';
+        for(auto const& module : modules)
+        {
+            state << module.source.string() << '\n';
+            state << module.id << ' ' << module.size << ' ' << module.mtime << ' ' << module.source_hash << ' ' << module.decl_hash << ' '
+                << module.interface_hash << ' ' << module.has_entry << ' ' << module.import_names.size() << '\n';
+            for(auto const& name : module.import_names)
+                state << name << '\n';
+            state << module.interface_key << '\n';
+            state << module.built_key << '\n';
+        }
+        return writeFile(getStatePath(), state.str());
+    }
+
+    bool VBuildDriver::discover(std::filesystem::path const& root, std::unordered_map<std::string, Module> const& previous)
+    {
+        std::unordered_map<std::string, std::size_t> indexes;
+        std::unordered_set<std::string> visiting;
+
+        std::function<bool(std::filesystem::path const&, std::filesystem::path const*)> visit;
+        visit=[&](std::filesystem::path const& path, std::filesystem::path const* importer)
+        {
+            auto key=path.string();
+            if(indexes.count(key))
+                return true;
+            if(visiting.count(key))
+            {
+                std::cout << "Module " << key << " imports itself through " << importer->string() << std::endl;
+                return false;
+            }
+
+            std::error_code ec;
+            Module module;
+            module.source=path;
+            module.size=std::filesystem::file_size(path, ec);
+            if(!ec)
+                module.mtime=std::filesystem::last_write_time(path, ec).time_since_epoch().count();
+            if(ec || !std::filesystem::is_regular_file(path, ec))
+            {
+                if(importer)
+                    std::cout << "Module " << key << " imported by " << importer->string() << " does not exist" << std::endl;
+                else
+                    std::cout << "File " << key << " does not exist" << std::endl;
+                return false;
+            }
+            module.id=path.stem().string()+"-"+toHex(hashText(std::filesystem::absolute(path, ec).string()));
+
+            auto last=previous.find(key);
+            bool known=(last!=previous.end() && last->second.id==module.id);
+            if(known)
+            {
+                module.interface_key=last->second.interface_key;
+                module.interface_hash=last->second.interface_hash;
+                module.built_key=last->second.built_key;
+            }
+
+            if(known && last->second.size==module.size && last->second.mtime==module.mtime)
+            {
+                // Not read at all
+                module.source_hash=last->second.source_hash;
+            }
+            else
+            {
+                auto buffer=proto::SourceBuffer::fromFile(key);
+                module.source_hash=hashText(buffer->view());
+                // Touched but not changed, what was scanned before still holds
+                known=(known && last->second.source_hash==module.source_hash);
+
+                if(!known)
+                {
+                    auto scan=scanModule(buffer);
+                    module.decl_hash=hashText(scan.declarations);
+                    module.declarations=std::move(scan.declarations);
+                    module.scanned=true;
+                    module.has_entry=scan.has_entry;
+                    module.import_names=std::move(scan.imports);
+                }
+            }
+            if(known)
+            {
+                module.decl_hash=last->second.decl_hash;
+                module.has_entry=last->second.has_entry;
+                module.import_names=last->second.import_names;
+            }
+
+            visiting.insert(key);
+            std::vector<std::size_t> direct;
+            for(auto const& name : module.import_names)
+            {
+                auto import_path=resolveImport(path, name);
+                if(!visit(import_path, &path))
+                    return false;
+                direct.push_back(indexes[import_path.string()]);
+            }
+            visiting.erase(key);
+
+            // What a module imports comes before it, so indexes are already in build order
+            std::vector<bool> imported(modules.size(), false);
+            for(auto i : direct)
+            {
+                modules[i].library=true;
+                imported[i]=true;
+                for(auto j : modules[i].imports)
+                    imported[j]=true;
+            }
+            for(std::size_t i=0; i<imported.size(); ++i)
+            {
+                if(imported[i])
+                    module.imports.push_back(i);
+            }
+
+            indexes[key]=modules.size();
+            modules.push_back(std::move(module));
+            return true;
+        };
+
+        return visit(root.lexically_normal(), nullptr);
+    }
+
+    bool VBuildDriver::buildInterface(Module& module, std::string& diagnostics) const
+    {
+        if(!module.scanned)
+        {
+            auto scan=scanModule(proto::SourceBuffer::fromFile(module.source.string()));
+            module.declarations=std::move(scan.declarations);
+            module.scanned=true;
+        }
+
+        std::vector<ModuleInterface> imports;
+        for(auto i : module.imports)
+        {
+            auto const& imported=modules[i];
+            imports.push_back(ModuleInterface{imported.source.string(), proto::SourceBuffer::fromFile(getInterfacePath(imported).string())});
+        }
+
+        std::string data;
+        if(!vire::buildInterface(module.source.string(), module.declarations, imports, data, diagnostics))
+            return false;
+        if(!writeFile(getInterfacePath(module), data))
+        {
+            diagnostics="Could not write the interface";
+            return false;
+        }
+
+        module.interface_hash=hashText(data);
+        return true;
+    }
+
+    bool VBuildDriver::compile(Module const& module, VCompilerSession* session, std::string& diagnostics) const
+    {
+        VOutputCapture printed;
+        auto fail=[&](std::string const& why)
+        {
+            diagnostics=printed.take()+why;
+            return false;
+        };
+
+        auto api=VApi::loadFromFile(module.source.string(), options.target, session);
+        for(auto i : module.imports)
+        {
+            // Mapped, what is not valid is reported when the module is parsed
+            auto const& imported=modules[i];
+            api->addImport(imported.source.string(), proto::SourceBuffer::fromFile(getInterfacePath(imported).string()));
+        }
+        api->setLibrary(module.library);
+        // Modules are compiled side by side on the driver's workers, each verifies on its own thread
+        api->getCompiler()->getAnalyzer()->setThreadCount(1);
+
+        if(!api->parseSourceModule())
+            return fail("Parsing failed");
+        if(!api->verifySourceModule())
+            return fail("Verification failed");
+        if(!api->compileSourceModule(getObjectPath(module).string(), true, options.opt_level, options.enable_lto))
+            return fail("Compilation failed");
+
+        diagnostics=printed.take();
+        return true;
+    }
+
+    bool VBuildDriver::build(std::filesystem::path const& root, std::vector<std::filesystem::path>& objects)
+    {
+        modules.clear();
+        compiled_count=up_to_date_count=0;
+
+        std::error_code ec;
+        std::filesystem::create_directories(build_dir, ec);
+
+        std::unordered_map<std::string, Module> previous;
+        loadState(previous);
+        if(!discover(root, previous))
+            return false;
+
+        std::string triple, cpu;
+        VCompiler::resolveTarget(options.target, triple, cpu);
+
+        bool success=true;
+        std::vector<std::size_t> stale;
+        // A module can not be compiled when the interface of something it imports could not be built
+        std::vector<bool> broken(modules.size(), false);
+        for(std::size_t i=0; i<modules.size(); ++i)
+        {
+            auto& module=modules[i];
+            if(module.library && module.has_entry)
+            {
+                std::cout << "Module " << module.source.string() << " is imported, it can not have a main function or top level statements" << std::endl;
+                return false;
+            }
+
+            for(auto j : module.imports)
+                broken[i]=broken[i] || broken[j];
+            if(broken[i])
+            {
+                module.built_key="";
+                success=false;
+                continue;
+            }
+
+            // The interface only changes with the declarations and the interfaces they refer to
+            if(module.library)
+            {
+                std::string material=toHex(module.decl_hash);
+                for(auto j : module.imports)
+                {
+                    material+='\n';
+                    material+=modules[j].id;
+                    material+=' ';
+                    material+=toHex(modules[j].interface_hash);
+                }
+
+                // A file that was damaged since is built again too, only its header is read
+                auto interface_key=toHex(hashText(material));
+                bool valid=(interface_key==module.interface_key && std::filesystem::exists(getInterfacePath(module), ec)
+                    && VModuleInterface(proto::SourceBuffer::fromFile(getInterfacePath(module).string())).isValid());
+                if(!valid)
+                {
+                    std::string diagnostics;
+                    module.interface_key="";
+                    if(!buildInterface(module, diagnostics))
+                    {
+                        std::cout << "--- " << module.source.string() << std::endl << diagnostics << std::endl;
+                        broken[i]=true;
+                        module.built_key="";
+                        success=false;
+                        continue;
+                    }
+                    module.interface_key=interface_key;
+                }
+            }
+
+            // What the object depends on, what it imports is only seen through its interface
+            std::string material=module.library?"library\n":"program\n";
+            material+=toHex(module.source_hash);
+            for(auto j : module.imports)
+            {
+                material+='\n';
+                material+=modules[j].id;
+                material+=' ';
+                material+=toHex(modules[j].interface_hash);
+            }
+            module.key=VObjectCache::makeKey(material, triple, cpu, options.opt_level, options.enable_lto);
+
+            if(module.key!=module.built_key || !std::filesystem::exists(getObjectPath(module), ec))
+                stale.push_back(i);
+        }
+        up_to_date_count=std::count(broken.begin(), broken.end(), false)-stale.size();
+
+        std::vector<std::string> diagnostics(stale.size());
+        std::vector<char> compiled(stale.size(), false);
+        if(!stale.empty())
+        {
+            std::unique_ptr<VCompilerSession> own_session;
+            auto* session=options.session;
+            if(!session)
+            {
+                own_session=std::make_unique<VCompilerSession>();
+                session=own_session.get();
+            }
+
+            unsigned int threads=options.threads;
+            if(threads==0)
+                threads=proto::ThreadPool::getDefaultThreadCount();
+            threads=(unsigned int)std::min<std::size_t>(threads, stale.size());
+
+            proto::ThreadPool pool(threads);
+            std::vector<std::thread::id> workers(pool.size());
+            pool.forEach(stale.size(), [&](std::size_t i, unsigned int worker)
+            {
+                workers[worker]=std::this_thread::get_id();
+                compiled[i]=compile(modules[stale[i]], session, diagnostics[i]);
+            });
+
+            // The calling thread is worker 0 and keeps its context
+            for(unsigned int worker=1; worker<workers.size(); ++worker)
+            {
+                if(workers[worker]!=std::thread::id())
+                    session->releaseContext(workers[worker]);
+            }
+        }
+
+        for(std::size_t i=0; i<stale.size(); ++i)
+        {
+            auto& module=modules[stale[i]];
+            if(!diagnostics[i].empty())
+                std::cout << "--- " << module.source.string() << std::endl << diagnostics[i] << std::endl;
+
+            // A module that failed is compiled again next time whatever changes
+            module.built_key=compiled[i] ? module.key : "";
+            compiled_count+=compiled[i];
+            success=success && compiled[i];
+        }
+
+        saveState();
+
+        objects.clear();
+        for(auto const& module : modules)
+            objects.push_back(getObjectPath(module));
+        return success;
+    }
+
+    std::size_t VBuildDriver::getCompiledCount() const
+    {
+        return compiled_count;
+    }
+    std::size_t VBuildDriver::getUpToDateCount() const
+    {
+        return up_to_date_count;
+    }
+}
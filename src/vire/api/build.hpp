@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "vire/config/config.hpp"
+#include "vire/v_compiler/session.hpp"
+
+namespace vire
+{
+
+struct BuildOptions
+{
+    std::string target="sys";
+    Optimization opt_level=Optimization::O0;
+    bool enable_lto=false;
+    // How many modules are compiled at once at most, 0 is one per hardware thread
+    unsigned int threads=0;
+    // Where target machines come from, a build makes a session of its own without one
+    VCompilerSession* session=nullptr;
+};
+
+// VBuildDriver - Builds a program made of modules that import each other into an object per module.
+// Importers only see the interfaces of what they import, so every module that has to be compiled
+// can be compiled at the same time as the others. A module is compiled again when its source, the
+// interface of something it imports or the options changed since the last build. Interfaces are
+// built first, one module after the other in the order they are imported in, as each is verified
+// against the ones it imports. The build directory keeps the objects, the interfaces and what the
+// last build saw of each source: a source with the same size and modification time is not read
+// again, one that was only touched is not compiled again
+class VBuildDriver
+{
+    struct Module
+    {
+        std::filesystem::path source;
+        // Names the module's files in the build directory
+        std::string id;
+
+        std::uintmax_t size=0;
+        std::int64_t mtime=0;
+        std::uint64_t source_hash=0;
+        // Of its ModuleScan declarations and of the interface built from them
+        std::uint64_t decl_hash=0;
+        std::uint64_t interface_hash=0;
+        bool has_entry=false;
+        std::vector<std::string> import_names;
+
+        // Indexes of the modules it imports, directly and through others, in build order
+        std::vector<std::size_t> imports;
+        bool library=false;
+        // What its interface was built from, empty if it has none
+        std::string interface_key;
+        // Only held when the source was scanned in this build
+        std::string declarations;
+        bool scanned=false;
+        std::string key;
+        // The key its object was built with, empty if it has none
+        std::string built_key;
+    };
+
+    std::filesystem::path build_dir;
+    BuildOptions options;
+    std::vector<Module> modules;
+    std::size_t compiled_count=0;
+    std::size_t up_to_date_count=0;
+private:
+    std::filesystem::path getStatePath() const;
+    std::filesystem::path getInterfacePath(Module const& module) const;
+    std::filesystem::path getObjectPath(Module const& module) const;
+
+    void loadState(std::unordered_map<std::string, Module>& previous) const;
+    bool saveState() const;
+    bool discover(std::filesystem::path const& root, std::unordered_map<std::string, Module> const& previous);
+    bool buildInterface(Module& module, std::string& diagnostics) const;
+    bool compile(Module const& module, VCompilerSession* session, std::string& diagnostics) const;
+public:
+    VBuildDriver(std::filesystem::path build_dir, BuildOptions options=BuildOptions());
+
+    // Builds `root` and every module it imports, directly or not. `objects` gets the object of every
+    // module in the order they were imported in, the root's last. Returns false if a module could
+    // not be compiled, the ones that were are kept for the next build
+    bool build(std::filesystem::path const& root, std::vector<std::filesystem::path>& objects);
+
+    // Of the last build
+    std::size_t getCompiledCount() const;
+    std::size_t getUpToDateCount() const;
+};
+
+}
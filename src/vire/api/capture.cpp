@@ -0,0 +1,76 @@
+#include "capture.hpp"
+
+#include <iostream>
+#include <mutex>
+#include <ostream>
+#include <streambuf>
+#include <utility>
+
+namespace vire
+{
+    static thread_local std::string* capture_target=nullptr;
+
+    // Takes std::cout's place for good once anything is captured. It has no buffer of its own, every
+    // write comes through here and goes to the thread's capture or on to the original buffer
+    class CaptureBuffer : public std::streambuf
+    {
+        std::streambuf* original;
+    public:
+        CaptureBuffer(std::streambuf* original) : original(original) {}
+    protected:
+        int_type overflow(int_type c) override
+        {
+            if(traits_type::eq_int_type(c, traits_type::eof()))
+                return traits_type::not_eof(c);
+            if(capture_target)
+            {
+                capture_target->push_back(traits_type::to_char_type(c));
+                return c;
+            }
+            return original->sputc(traits_type::to_char_type(c));
+        }
+        std::streamsize xsputn(char const* s, std::streamsize n) override
+        {
+            if(capture_target)
+            {
+                capture_target->append(s, n);
+                return n;
+            }
+            return original->sputn(s, n);
+        }
+        int sync() override
+        {
+            return capture_target?0:original->pubsync();
+        }
+    };
+
+    static void installCaptureBuffer()
+    {
+        static std::once_flag installed;
+        std::call_once(installed, []
+        {
+            // Never freed, std::cout is still flushed through it after static objects are destroyed
+            std::cout.rdbuf(new CaptureBuffer(std::cout.rdbuf()));
+        });
+    }
+
+    VOutputCapture::VOutputCapture()
+    : previous(capture_target)
+    {
+        installCaptureBuffer();
+        capture_target=&text;
+    }
+    VOutputCapture::~VOutputCapture()
+    {
+        capture_target=previous;
+    }
+
+    std::string const& VOutputCapture::getText() const
+    {
+        return text;
+    }
+    std::string VOutputCapture::take()
+    {
+        return std::exchange(text, std::string());
+    }
+}
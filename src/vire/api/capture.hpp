@@ -0,0 +1,27 @@
+#pragma once
+
+#include <string>
+
+namespace vire
+{
+
+// VOutputCapture - The compiler prints its diagnostics to std::cout. While one of these is alive,
+// what its thread prints is kept in it instead, other threads still print as usual. Captures on a
+// thread nest, the innermost gets the output
+class VOutputCapture
+{
+    std::string text;
+    std::string* previous;
+public:
+    VOutputCapture();
+    ~VOutputCapture();
+
+    VOutputCapture(VOutputCapture const&)=delete;
+    VOutputCapture& operator=(VOutputCapture const&)=delete;
+
+    std::string const& getText() const;
+    // Returns what was captured so far and starts over
+    std::string take();
+};
+
+}
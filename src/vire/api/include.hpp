@@ -1,3 +1,7 @@
 #pragma once
 
-#include "VApi.hpp"
\ No newline at end of file
+#include "VApi.hpp"
+#include "capture.hpp"
+#include "module.hpp"
+#include "interface.hpp"
+#include "build.hpp"
\ No newline at end of file
@@ -0,0 +1,653 @@
+#include "interface.hpp"
+
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <ostream>
+#include <unordered_map>
+#include <utility>
+
+#include "vire/errors/include.hpp"
+#include "vire/parse/include.hpp"
+#include "vire/v_analyzer/include.hpp"
+
+#include "capture.hpp"
+
+namespace vire
+{
+    namespace
+    {
+        // Every record is made of 32-bit fields in the byte order of the machine that wrote it, the
+        // magic tells a file from another byte order apart
+        enum SectionKind
+        {
+            section_strings,
+            section_string_data,
+            section_types,
+            section_fields,
+            section_records,
+            section_functions,
+            section_methods,
+            section_classes,
+            section_sizes,
+            section_count,
+        };
+        struct Section
+        {
+            std::uint32_t offset;
+            std::uint32_t count;
+        };
+        struct Header
+        {
+            char magic[4];
+            std::uint32_t version;
+            Section sections[section_count];
+        };
+
+        struct StringEntry
+        {
+            std::uint32_t offset;
+            std::uint32_t size;
+        };
+        // An array has a `child` and a `length`, named voids and custom types a `name`
+        struct TypeEntry
+        {
+            std::uint32_t kind;
+            std::uint32_t name;
+            std::uint32_t child;
+            std::uint32_t length;
+        };
+        // A member or argument, `record` is 1 past the index of a nested struct or union or 0
+        struct FieldEntry
+        {
+            std::uint32_t name;
+            std::uint32_t type;
+            std::uint32_t record;
+        };
+        // A struct or union, the arguments are the constructor's without `self`
+        struct RecordEntry
+        {
+            std::uint32_t name;
+            std::uint32_t flags;
+            std::uint32_t first_member;
+            std::uint32_t member_count;
+            std::uint32_t first_arg;
+            std::uint32_t arg_count;
+        };
+        struct FunctionEntry
+        {
+            std::uint32_t name;
+            std::uint32_t return_type;
+            std::uint32_t first_arg;
+            std::uint32_t arg_count;
+        };
+        struct ClassEntry
+        {
+            std::uint32_t name;
+            std::uint32_t parent;
+            std::uint32_t first_member;
+            std::uint32_t member_count;
+            std::uint32_t first_method;
+            std::uint32_t method_count;
+        };
+        struct SizeEntry
+        {
+            std::uint32_t name;
+            std::uint32_t size;
+        };
+
+        constexpr char interface_magic[4]={'V', 'I', 'F', 1};
+        constexpr std::uint32_t record_union=1;
+        constexpr std::uint32_t record_nested=2;
+        constexpr std::uint32_t record_constructor=4;
+
+        constexpr std::size_t entry_sizes[section_count]=
+        {
+            sizeof(StringEntry), 1, sizeof(TypeEntry), sizeof(FieldEntry), sizeof(RecordEntry),
+            sizeof(FunctionEntry), sizeof(FunctionEntry), sizeof(ClassEntry), sizeof(SizeEntry),
+        };
+
+        class InterfaceWriter
+        {
+            std::string string_data;
+            std::vector<StringEntry> strings;
+            std::unordered_map<std::string, std::uint32_t> string_ids;
+            std::vector<TypeEntry> types;
+            std::unordered_map<types::Base*, std::uint32_t> type_ids;
+            std::vector<FieldEntry> fields;
+            std::vector<RecordEntry> records;
+            std::vector<FunctionEntry> functions;
+            std::vector<FunctionEntry> methods;
+            std::vector<ClassEntry> classes;
+            std::vector<SizeEntry> sizes;
+
+            template<typename T>
+            static void append(std::string& out, std::vector<T> const& entries)
+            {
+                out.append((char const*)entries.data(), entries.size()*sizeof(T));
+            }
+        public:
+            std::uint32_t addString(std::string const& text)
+            {
+                auto it=string_ids.find(text);
+                if(it!=string_ids.end())
+                    return it->second;
+
+                std::uint32_t id=strings.size();
+                strings.push_back(StringEntry{(std::uint32_t)string_data.size(), (std::uint32_t)text.size()});
+                string_data+=text;
+                string_ids.emplace(text, id);
+                return id;
+            }
+            // Children before their arrays, a type only refers to the ones before it
+            std::uint32_t addType(types::Base* type)
+            {
+                auto it=type_ids.find(type);
+                if(it!=type_ids.end())
+                    return it->second;
+
+                TypeEntry entry{(std::uint32_t)type->getType(), 0, 0, 0};
+                switch(type->getType())
+                {
+                case types::EType::Array:
+                {
+                    auto* array=(types::Array*)type;
+                    entry.child=addType(array->getChild());
+                    entry.length=array->getLength();
+                    break;
+                }
+                case types::EType::Void:
+                    entry.name=addString(((types::Void*)type)->getName());
+                    break;
+                case types::EType::Custom:
+                    entry.name=addString(((types::Custom*)type)->getName());
+                    break;
+                default:
+                    break;
+                }
+
+                std::uint32_t id=types.size();
+                types.push_back(entry);
+                type_ids.emplace(type, id);
+                return id;
+            }
+            // The fields are kept together, nested records are written before them
+            template<typename Var>
+            std::pair<std::uint32_t, std::uint32_t> addFields(std::vector<Var> const& vars, std::size_t skip=0)
+            {
+                std::vector<FieldEntry> entries;
+                for(std::size_t i=skip; i<vars.size(); ++i)
+                {
+                    auto const& var=vars[i];
+                    entries.push_back(FieldEntry{addString(var->getIName().name), addType(var->getType()), 0});
+                }
+                std::uint32_t first=fields.size();
+                fields.insert(fields.end(), entries.begin(), entries.end());
+                return std::make_pair(first, (std::uint32_t)entries.size());
+            }
+            std::uint32_t addRecord(TypeAST* record, bool nested)
+            {
+                std::vector<FieldEntry> members;
+                for(auto* member : record->getMembersValues())
+                {
+                    if(member->asttype==ast_struct || member->asttype==ast_union)
+                    {
+                        auto* child=(TypeAST*)member;
+                        auto child_record=addRecord(child, true);
+                        members.push_back(FieldEntry{records[child_record].name, addType(child->getType()), child_record+1});
+                    }
+                    else
+                    {
+                        auto* var=(VariableDefAST*)member;
+                        members.push_back(FieldEntry{addString(var->getIName().name), addType(var->getType()), 0});
+                    }
+                }
+
+                // The analyzer prefixes nested records when it verifies them, and would again on import
+                std::string name=record->getIName().name;
+                if(nested && !name.empty() && name[0]=='_')
+                    name.erase(0, 1);
+
+                RecordEntry entry{addString(name), 0, (std::uint32_t)fields.size(), (std::uint32_t)members.size(), 0, 0};
+                fields.insert(fields.end(), members.begin(), members.end());
+
+                if(record->asttype==ast_union)
+                    entry.flags|=record_union;
+                if(nested)
+                    entry.flags|=record_nested;
+
+                if(record->asttype==ast_struct)
+                {
+                    // Once verified a constructor takes `self` first
+                    auto* constructor=((StructExprAST*)record)->getConstructor();
+                    if(constructor && !nested)
+                    {
+                        auto args=addFields(constructor->getArgs(), 1);
+                        entry.flags|=record_constructor;
+                        entry.first_arg=args.first;
+                        entry.arg_count=args.second;
+                    }
+
+                    if(auto size=types::getContext().getTypeSize(record->getName()))
+                        sizes.push_back(SizeEntry{addString(record->getName()), (std::uint32_t)size});
+                }
+
+                std::uint32_t id=records.size();
+                records.push_back(entry);
+                return id;
+            }
+            FunctionEntry makeFunction(FunctionBaseAST const* function)
+            {
+                auto args=addFields(function->getArgs(), function->doesRequireSelfRef());
+                return FunctionEntry{addString(function->getIName().name), addType(function->getReturnType()), args.first, args.second};
+            }
+            void addFunction(FunctionBaseAST const* function)
+            {
+                functions.push_back(makeFunction(function));
+            }
+            void addClass(ClassAST const* class_)
+            {
+                auto members=addFields(class_->getMembers());
+
+                ClassEntry entry{addString(class_->getIName().name), addString(class_->getParentIName().name),
+                    members.first, members.second, (std::uint32_t)methods.size(), 0};
+                for(auto const* method : class_->getFunctions())
+                    methods.push_back(makeFunction(method));
+                entry.method_count=methods.size()-entry.first_method;
+                classes.push_back(entry);
+            }
+
+            std::string finish()
+            {
+                Header header;
+                std::memcpy(header.magic, interface_magic, sizeof(header.magic));
+                header.version=VModuleInterface::version;
+
+                std::size_t counts[section_count]=
+                {
+                    strings.size(), string_data.size(), types.size(), fields.size(), records.size(),
+                    functions.size(), methods.size(), classes.size(), sizes.size(),
+                };
+                std::uint32_t offset=sizeof(Header);
+                for(int i=0; i<section_count; ++i)
+                {
+                    // Keeps every section 4 byte aligned
+                    offset=(offset+3) & ~3u;
+                    header.sections[i]=Section{offset, (std::uint32_t)counts[i]};
+                    offset+=counts[i]*entry_sizes[i];
+                }
+
+                std::string out;
+                out.reserve(offset);
+                out.append((char const*)&header, sizeof(header));
+                auto pad=[&out](int section, Header const& header)
+                {
+                    out.resize(header.sections[section].offset, '\0');
+                };
+                pad(section_strings, header);        append(out, strings);
+                pad(section_string_data, header);    out+=string_data;
+                pad(section_types, header);          append(out, types);
+                pad(section_fields, header);         append(out, fields);
+                pad(section_records, header);        append(out, records);
+                pad(section_functions, header);      append(out, functions);
+                pad(section_methods, header);        append(out, methods);
+                pad(section_classes, header);        append(out, classes);
+                pad(section_sizes, header);          append(out, sizes);
+                return out;
+            }
+        };
+
+        class InterfaceReader
+        {
+            std::string_view data;
+            Header header;
+        public:
+            bool open(std::string_view bytes)
+            {
+                data=bytes;
+                if(data.size()<sizeof(Header))
+                    return false;
+                std::memcpy(&header, data.data(), sizeof(Header));
+                if(std::memcmp(header.magic, interface_magic, sizeof(header.magic))!=0 || header.version!=VModuleInterface::version)
+                    return false;
+
+                for(int i=0; i<section_count; ++i)
+                {
+                    auto const& section=header.sections[i];
+                    if((std::uint64_t)section.offset+(std::uint64_t)section.count*entry_sizes[i]>data.size())
+                        return false;
+                }
+                return true;
+            }
+
+            std::uint32_t count(SectionKind section) const
+            {
+                return header.sections[section].count;
+            }
+            template<typename T>
+            bool get(SectionKind section, std::uint32_t index, T& entry) const
+            {
+                if(index>=header.sections[section].count)
+                    return false;
+                std::memcpy(&entry, data.data()+header.sections[section].offset+(std::size_t)index*sizeof(T), sizeof(T));
+                return true;
+            }
+            // `offset` is where the text starts in the data
+            bool getString(std::uint32_t index, std::string_view& text, std::uint32_t& offset) const
+            {
+                StringEntry entry;
+                if(!get(section_strings, index, entry))
+                    return false;
+                if((std::uint64_t)entry.offset+entry.size>header.sections[section_string_data].count)
+                    return false;
+
+                offset=header.sections[section_string_data].offset+entry.offset;
+                text=data.substr(offset, entry.size);
+                return true;
+            }
+        };
+    }
+
+    VModuleInterface::VModuleInterface(std::shared_ptr<const proto::SourceBuffer> data)
+    : data(std::move(data)), valid(false)
+    {
+        InterfaceReader reader;
+        valid=this->data && reader.open(this->data->view());
+    }
+
+    std::string VModuleInterface::write(std::vector<FunctionBaseAST*> const& functions, std::vector<ExprAST*> const& union_structs,
+        std::vector<ClassAST*> const& classes)
+    {
+        InterfaceWriter writer;
+        for(auto* record : union_structs)
+            writer.addRecord((TypeAST*)record, false);
+        for(auto* function : functions)
+            writer.addFunction(function);
+        for(auto* class_ : classes)
+            writer.addClass(class_);
+        return writer.finish();
+    }
+
+    std::unique_ptr<ModuleAST> VModuleInterface::instantiate(proto::SourceLocation start) const
+    {
+        InterfaceReader reader;
+        if(!valid || !reader.open(data->view()))
+            return nullptr;
+
+        auto arena=std::make_unique<proto::Arena>();
+        proto::ArenaScope arena_scope(arena.get());
+        auto& context=types::getContext();
+
+        auto makeToken=[&](std::uint32_t index, std::unique_ptr<VToken>& token)
+        {
+            std::string_view text;
+            std::uint32_t offset;
+            if(!reader.getString(index, text, offset))
+                return false;
+            token=VToken::construct(text, tok_id, start.getOffset(offset));
+            return true;
+        };
+
+        std::vector<types::Base*> resolved(reader.count(section_types));
+        for(std::uint32_t i=0; i<resolved.size(); ++i)
+        {
+            TypeEntry entry;
+            reader.get(section_types, i, entry);
+
+            std::string_view name;
+            std::uint32_t offset;
+            switch((types::EType)entry.kind)
+            {
+            case types::EType::Array:
+                if(entry.child>=i)
+                    return nullptr;
+                resolved[i]=context.getArray(resolved[entry.child], entry.length);
+                break;
+            // Left for the analyzer to resolve, as the parser does
+            case types::EType::Void:
+            case types::EType::Custom:
+                if(!reader.getString(entry.name, name, offset))
+                    return nullptr;
+                resolved[i]=context.getVoid(std::string(name));
+                break;
+            case types::EType::Char:
+            case types::EType::Short:
+            case types::EType::Int:
+            case types::EType::Long:
+            case types::EType::Float:
+            case types::EType::Double:
+            case types::EType::Bool:
+            case types::EType::Any:
+                resolved[i]=context.get((types::EType)entry.kind);
+                break;
+            default:
+                return nullptr;
+            }
+        }
+
+        for(std::uint32_t i=0; i<reader.count(section_sizes); ++i)
+        {
+            SizeEntry entry;
+            std::string_view name;
+            std::uint32_t offset;
+            reader.get(section_sizes, i, entry);
+            if(!reader.getString(entry.name, name, offset))
+                return nullptr;
+            context.addTypeSizeToMap(std::string(name), entry.size);
+        }
+
+        auto makeVariable=[&](std::uint32_t index, bool is_const, std::unique_ptr<VariableDefAST>& var)
+        {
+            FieldEntry field;
+            std::unique_ptr<VToken> name;
+            if(!reader.get(section_fields, index, field) || field.type>=resolved.size() || !makeToken(field.name, name))
+                return false;
+            var=std::make_unique<VariableDefAST>(*name, resolved[field.type], nullptr, is_const, false);
+            return true;
+        };
+        // Arguments are constant, as the parser makes them
+        auto makeArgs=[&](std::uint32_t first, std::uint32_t count, std::vector<std::unique_ptr<VariableDefAST>>& args)
+        {
+            for(std::uint32_t i=0; i<count; ++i)
+            {
+                std::unique_ptr<VariableDefAST> arg;
+                if(!makeVariable(first+i, true, arg))
+                    return false;
+                args.push_back(std::move(arg));
+            }
+            return true;
+        };
+        auto makePrototype=[&](FunctionEntry const& entry)
+        {
+            std::unique_ptr<VToken> name;
+            std::vector<std::unique_ptr<VariableDefAST>> args;
+            if(entry.return_type>=resolved.size() || !makeToken(entry.name, name) || !makeArgs(entry.first_arg, entry.arg_count, args))
+                return std::unique_ptr<PrototypeAST>();
+            return std::make_unique<PrototypeAST>(std::move(name), std::move(args), resolved[entry.return_type]);
+        };
+
+        // `depth` bounds the nesting, records that contain themselves are rejected
+        std::function<std::unique_ptr<ExprAST>(std::uint32_t, std::uint32_t)> makeRecord;
+        makeRecord=[&](std::uint32_t index, std::uint32_t depth) -> std::unique_ptr<ExprAST>
+        {
+            RecordEntry entry;
+            std::unique_ptr<VToken> name;
+            if(depth>reader.count(section_records) || !reader.get(section_records, index, entry) || !makeToken(entry.name, name))
+                return nullptr;
+
+            INameExprMap members;
+            std::vector<proto::IName> order;
+            for(std::uint32_t i=0; i<entry.member_count; ++i)
+            {
+                FieldEntry field;
+                if(!reader.get(section_fields, entry.first_member+i, field))
+                    return nullptr;
+
+                std::unique_ptr<ExprAST> member;
+                if(field.record)
+                {
+                    member=makeRecord(field.record-1, depth+1);
+                }
+                else
+                {
+                    std::unique_ptr<VariableDefAST> var;
+                    if(makeVariable(entry.first_member+i, false, var))
+                        member=std::move(var);
+                }
+                if(!member)
+                    return nullptr;
+
+                std::string_view member_name;
+                std::uint32_t offset;
+                reader.getString(field.name, member_name, offset);
+                order.push_back(proto::IName(std::string(member_name)));
+                members.insert(std::make_pair(order.back(), std::move(member)));
+            }
+
+            if(entry.flags & record_union)
+                return std::make_unique<UnionExprAST>(std::move(members), std::move(name), order);
+
+            // Only the signature of the constructor, its body is in the module the struct is from
+            std::unique_ptr<FunctionAST> constructor;
+            if(entry.flags & record_constructor)
+            {
+                std::vector<std::unique_ptr<VariableDefAST>> args;
+                if(!makeArgs(entry.first_arg, entry.arg_count, args))
+                    return nullptr;
+                auto proto=std::make_unique<PrototypeAST>(VToken::construct("", tok_id), std::move(args), types::construct("void"), true, true);
+                constructor=std::make_unique<FunctionAST>(std::move(proto), std::vector<std::unique_ptr<ExprAST>>(), true, true);
+            }
+
+            auto struct_=std::make_unique<StructExprAST>(std::move(members), std::move(constructor), std::move(name), order);
+            struct_->setImported(true);
+            return struct_;
+        };
+
+        std::vector<std::unique_ptr<ExprAST>> union_structs;
+        for(std::uint32_t i=0; i<reader.count(section_records); ++i)
+        {
+            RecordEntry entry;
+            reader.get(section_records, i, entry);
+            if(entry.flags & record_nested)
+                continue;
+
+            auto record=makeRecord(i, 0);
+            if(!record)
+                return nullptr;
+            union_structs.push_back(std::move(record));
+        }
+
+        std::vector<std::unique_ptr<FunctionBaseAST>> functions;
+        for(std::uint32_t i=0; i<reader.count(section_functions); ++i)
+        {
+            FunctionEntry entry;
+            reader.get(section_functions, i, entry);
+            auto proto=makePrototype(entry);
+            if(!proto)
+                return nullptr;
+            functions.push_back(std::move(proto));
+        }
+
+        std::vector<std::unique_ptr<ClassAST>> classes;
+        for(std::uint32_t i=0; i<reader.count(section_classes); ++i)
+        {
+            ClassEntry entry;
+            std::unique_ptr<VToken> name, parent;
+            reader.get(section_classes, i, entry);
+            if(!makeToken(entry.name, name) || !makeToken(entry.parent, parent))
+                return nullptr;
+
+            std::vector<std::unique_ptr<VariableDefAST>> members;
+            for(std::uint32_t j=0; j<entry.member_count; ++j)
+            {
+                std::unique_ptr<VariableDefAST> member;
+                if(!makeVariable(entry.first_member+j, false, member))
+                    return nullptr;
+                members.push_back(std::move(member));
+            }
+
+            std::vector<std::unique_ptr<FunctionBaseAST>> methods;
+            for(std::uint32_t j=0; j<entry.method_count; ++j)
+            {
+                FunctionEntry method;
+                if(!reader.get(section_methods, entry.first_method+j, method))
+                    return nullptr;
+                auto proto=makePrototype(method);
+                if(!proto)
+                    return nullptr;
+                methods.push_back(std::move(proto));
+            }
+
+            classes.push_back(std::make_unique<ClassAST>(std::move(name), std::move(methods), std::move(members), std::move(parent)));
+        }
+
+        return std::make_unique<ModuleAST>(std::vector<std::unique_ptr<ExprAST>>(), std::move(functions), std::move(classes),
+            std::move(union_structs), std::move(arena));
+    }
+
+    bool importInterfaces(ModuleAST* module, std::vector<ModuleInterface> const& interfaces, proto::SourceManager* sources,
+        types::TypeContext* type_context)
+    {
+        types::TypeContextScope type_scope(type_context);
+
+        // Each interface goes in front of the ones after it
+        for(auto it=interfaces.rbegin(); it!=interfaces.rend(); ++it)
+        {
+            VModuleInterface interface(it->data);
+            std::unique_ptr<ModuleAST> declarations;
+            if(interface.isValid())
+                declarations=interface.instantiate(sources->addBuffer(it->data, it->name));
+            if(!declarations)
+            {
+                std::cout << "The interface of " << it->name << " is not valid, it has to be built again" << std::endl;
+                return false;
+            }
+            module->mergeInterface(std::move(declarations));
+        }
+        return true;
+    }
+
+    bool buildInterface(std::string const& name, std::string declarations, std::vector<ModuleInterface> const& imports,
+        std::string& output, std::string& error)
+    {
+        VOutputCapture printed;
+
+        proto::SourceManager sources;
+        types::TypeContext type_context;
+        errors::ErrorBuilder ebuilder("This program");
+
+        auto src=proto::SourceBuffer::fromString(std::move(declarations));
+        auto start=sources.addBuffer(src, name);
+        VParser parser(std::make_unique<VLexer>(src, &ebuilder, start), nullptr, true, &type_context);
+        VAnalyzer analyzer(&ebuilder, &sources, &type_context);
+        analyzer.setThreadCount(1);
+
+        auto ast=parser.ParseSourceModule();
+        if(!ast)
+        {
+            error=printed.take()+"Could not parse the declarations of "+name;
+            return false;
+        }
+
+        // The module's own, the nodes stay where they are when the analyzer takes the module
+        std::vector<FunctionBaseAST*> functions;
+        std::vector<ExprAST*> union_structs;
+        std::vector<ClassAST*> classes;
+        for(auto const& function : ast->getFunctions())
+            functions.push_back(function.get());
+        for(auto const& record : ast->getUnionStructs())
+            union_structs.push_back(record.get());
+        for(auto const& class_ : ast->getClasses())
+            classes.push_back(class_.get());
+
+        if(!importInterfaces(ast.get(), imports, &sources, &type_context) || !analyzer.verifySourceModule(std::move(ast)))
+        {
+            error=printed.take()+"The declarations of "+name+" are not valid";
+            return false;
+        }
+
+        types::TypeContextScope type_scope(&type_context);
+        output=VModuleInterface::write(functions, union_structs, classes);
+        return true;
+    }
+}
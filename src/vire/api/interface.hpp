@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "vire/proto/file.hpp"
+#include "vire/proto/source.hpp"
+#include "vire/ast/include.hpp"
+
+namespace vire
+{
+
+// ModuleInterface - The interface of a module an api imports, `name` is what errors in it are
+// reported under. `data` is what VModuleInterface::write made, usually a mapping of the file
+struct ModuleInterface
+{
+    std::string name;
+    std::shared_ptr<const proto::SourceBuffer> data;
+};
+
+// VModuleInterface - What importers see of a module as the analyzer sees it once the module is
+// verified: the prototypes of its functions, the members and constructors of its structs, unions
+// and classes and the sizes of its types. It is stored as flat arrays of fixed size records that
+// refer to each other and to the names by index, so a file can be mapped and read in place.
+// Importers get declarations made from it directly, nothing is lexed or parsed
+class VModuleInterface
+{
+public:
+    static constexpr std::uint32_t version=1;
+private:
+    std::shared_ptr<const proto::SourceBuffer> data;
+    bool valid;
+public:
+    explicit VModuleInterface(std::shared_ptr<const proto::SourceBuffer> data);
+
+    // The header and every section fit in the data, records are checked as they are read
+    bool isValid() const { return valid; }
+
+    // The interface of the verified declarations given, the module's own and not what it imported
+    static std::string write(std::vector<FunctionBaseAST*> const& functions, std::vector<ExprAST*> const& union_structs,
+        std::vector<ClassAST*> const& classes);
+
+    // Declarations in the current type context, as the parser would have made them. Its structs are
+    // marked imported. `start` is the location the SourceManager gave the data, names are located in
+    // it. Returns nullptr if a record refers to something that is not there
+    std::unique_ptr<ModuleAST> instantiate(proto::SourceLocation start) const;
+};
+
+// Puts the declarations of `interfaces`, in order, in front of `module`'s own. The data is added to
+// `sources`, which keeps it alive as long as the declarations are. Returns false, saying why, if an
+// interface is not valid
+bool importInterfaces(ModuleAST* module, std::vector<ModuleInterface> const& interfaces, proto::SourceManager* sources,
+    types::TypeContext* type_context);
+
+// Verifies `declarations`, the ModuleScan of a module named `name`, against the interfaces of
+// everything it imports and writes its interface to `output`. Returns false, with what is wrong in
+// `error`, if the declarations are not valid
+bool buildInterface(std::string const& name, std::string declarations, std::vector<ModuleInterface> const& imports,
+    std::string& output, std::string& error);
+
+}
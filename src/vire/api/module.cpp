@@ -0,0 +1,198 @@
+#include "module.hpp"
+
+#include <functional>
+#include <unordered_map>
+
+#include "vire/errors/include.hpp"
+#include "vire/lex/include.hpp"
+
+namespace vire
+{
+    ModuleScan scanModule(std::shared_ptr<const proto::SourceBuffer> source)
+    {
+        ModuleScan scan;
+
+        // The parser reports what is wrong with the source, errors found here are dropped
+        errors::ErrorBuilder ebuilder;
+        VLexer lexer(source, &ebuilder);
+        VTokenTable tokens;
+        lexer.tokenize(tokens);
+
+        auto text=source->view();
+        auto offset=[&](std::size_t indx)
+        {
+            return (std::size_t)(tokens.loc(indx).offset-lexer.getStart().offset);
+        };
+        auto find=[&](std::size_t indx, int kind)
+        {
+            while(tokens.kind(indx)!=kind && tokens.kind(indx)!=tok_eof)
+                ++indx;
+            return indx;
+        };
+        // From an opening brace to the token after the brace that closes it
+        auto skipBlock=[&](std::size_t indx)
+        {
+            if(tokens.kind(indx)!=tok_lbrace)
+                return indx;
+
+            int depth=0;
+            do
+            {
+                if(tokens.kind(indx)==tok_lbrace)
+                    ++depth;
+                else if(tokens.kind(indx)==tok_rbrace)
+                    --depth;
+                ++indx;
+            } while(depth>0 && tokens.kind(indx)!=tok_eof);
+            return indx;
+        };
+        auto skipStatement=[&](std::size_t indx)
+        {
+            indx=find(indx, tok_semicol);
+            return tokens.kind(indx)==tok_eof ? indx : indx+1;
+        };
+
+        std::size_t indx=0;
+        while(tokens.kind(indx)!=tok_eof)
+        {
+            switch(tokens.kind(indx))
+            {
+            case tok_import:
+                if(tokens.kind(indx+1)==tok_str)
+                    scan.imports.emplace_back(tokens.text(indx+1));
+                indx=skipStatement(indx);
+                break;
+            case tok_struct:
+            case tok_union:
+            case tok_class:
+            {
+                // Copied as written, constructors and methods and all
+                auto begin=offset(indx);
+                indx=skipBlock(find(indx, tok_lbrace));
+                auto end=offset(indx-1)+tokens.text(indx-1).size();
+                scan.declarations.append(text.substr(begin, end-begin));
+                scan.declarations+='\n';
+                break;
+            }
+            case tok_func:
+            {
+                auto body=find(indx, tok_lbrace);
+                if(tokens.kind(indx+1)==tok_id && tokens.text(indx+1)=="main")
+                {
+                    scan.has_entry=true;
+                }
+                else
+                {
+                    // Rebuilt from the tokens, comments in the header can not swallow the semicolon
+                    scan.declarations+="proto";
+                    for(auto i=indx+1; i<body; ++i)
+                    {
+                        scan.declarations+=' ';
+                        scan.declarations.append(tokens.text(i));
+                    }
+                    scan.declarations+=";\n";
+                }
+                indx=skipBlock(body);
+                break;
+            }
+            case tok_extern:
+            case tok_proto:
+                indx=skipStatement(indx);
+                break;
+            case tok_semicol:
+                ++indx;
+                break;
+            default:
+                scan.has_entry=true;
+                indx=tokens.kind(indx)==tok_lbrace ? skipBlock(indx) : indx+1;
+                break;
+            }
+        }
+
+        return scan;
+    }
+
+    std::filesystem::path resolveImport(std::filesystem::path const& importer, std::string const& path)
+    {
+        return (importer.parent_path()/path).lexically_normal();
+    }
+
+    bool collectImports(std::filesystem::path const& importer, std::vector<std::string> const& imports,
+        std::vector<ModuleInterface>& interfaces, std::string& error)
+    {
+        enum class State { Visiting, Done };
+        std::unordered_map<std::string, State> states;
+        // Where in `interfaces` what each module imports is, directly or not
+        std::unordered_map<std::string, std::vector<bool>> imported;
+
+        std::function<bool(std::filesystem::path const&, std::vector<std::string> const&, std::vector<bool>&)> visit;
+        visit=[&](std::filesystem::path const& from, std::vector<std::string> const& names, std::vector<bool>& seen)
+        {
+            for(auto const& name : names)
+            {
+                auto path=resolveImport(from, name);
+                auto key=path.string();
+
+                auto state=states.find(key);
+                if(state!=states.end())
+                {
+                    if(state->second==State::Done)
+                    {
+                        auto const& through=imported[key];
+                        seen.resize(interfaces.size(), false);
+                        for(std::size_t i=0; i<through.size(); ++i)
+                            seen[i]=seen[i] || through[i];
+                        continue;
+                    }
+                    error="Module "+key+" imports itself through "+from.string();
+                    return false;
+                }
+
+                std::error_code ec;
+                if(!std::filesystem::is_regular_file(path, ec))
+                {
+                    error="Module "+key+" imported by "+from.string()+" does not exist";
+                    return false;
+                }
+
+                auto scan=scanModule(proto::SourceBuffer::fromFile(key));
+                if(scan.has_entry)
+                {
+                    error="Module "+key+" is imported, it can not have a main function or top level statements";
+                    return false;
+                }
+
+                states[key]=State::Visiting;
+                std::vector<bool> own;
+                if(!visit(path, scan.imports, own))
+                    return false;
+                states[key]=State::Done;
+
+                // Only sees what it imports itself, as it does when it is compiled
+                std::vector<ModuleInterface> visible;
+                for(std::size_t i=0; i<own.size(); ++i)
+                {
+                    if(own[i])
+                        visible.push_back(interfaces[i]);
+                }
+                std::string data;
+                if(!buildInterface(key, std::move(scan.declarations), visible, data, error))
+                    return false;
+
+                own.resize(interfaces.size()+1, false);
+                own[interfaces.size()]=true;
+                seen.resize(own.size(), false);
+                for(std::size_t i=0; i<own.size(); ++i)
+                    seen[i]=seen[i] || own[i];
+                imported[key]=std::move(own);
+
+                interfaces.push_back(ModuleInterface{key, proto::SourceBuffer::fromString(std::move(data))});
+            }
+            return true;
+        };
+
+        states[importer.lexically_normal().string()]=State::Visiting;
+        std::vector<bool> seen;
+        return visit(importer, imports, seen);
+    }
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "vire/proto/file.hpp"
+
+#include "interface.hpp"
+
+namespace vire
+{
+
+// ModuleScan - What other modules need to know of a module, read from its tokens without parsing it
+struct ModuleScan
+{
+    // Paths as written in the `import` statements, relative to the module's own directory
+    std::vector<std::string> imports;
+    // Source with only what importers see, the module's structs, unions and classes as written and a
+    // `proto` for each of its functions. Its interface is built from it, see buildInterface
+    std::string declarations;
+    // It defines `main` or has statements at the top level, a module that is imported can not
+    bool has_entry=false;
+};
+
+// Function bodies are skipped by matching braces, nothing in them is looked at
+ModuleScan scanModule(std::shared_ptr<const proto::SourceBuffer> source);
+
+// Where `import` statement `path` in the module at `importer` points to
+std::filesystem::path resolveImport(std::filesystem::path const& importer, std::string const& path);
+
+// The interfaces of everything `imports` names, directly or through other modules, each after the
+// modules it imports. They are built in memory, the build driver keeps them in files instead.
+// Returns false, saying why in `error`, if a module is missing, is not valid or modules import each
+// other
+bool collectImports(std::filesystem::path const& importer, std::vector<std::string> const& imports,
+    std::vector<ModuleInterface>& interfaces, std::string& error);
+
+}
@@ -14,7 +14,7 @@
 namespace vire
 {
 
-class ClassAST
+class ClassAST : public proto::ArenaNode
 {
     proto::IName name;
     proto::IName parent;
@@ -25,7 +25,7 @@ class ClassAST
 public:
     ClassAST(std::unique_ptr<VToken> name_token, std::vector<std::unique_ptr<FunctionBaseAST>> funcs
     , std::vector<std::unique_ptr<VariableDefAST>> vars, std::unique_ptr<VToken> parent_token)
-    : name(name_token->value), parent(parent_token->value), name_token(std::move(name_token)), parent_token(std::move(parent_token))
+    : name(std::string(name_token->value)), parent(std::string(parent_token->value)), name_token(std::move(name_token)), parent_token(std::move(parent_token))
     {
         unsigned int it=0;
         for(it=0; it<funcs.size(); it++)
@@ -74,16 +74,19 @@ public:
 
     std::string const& getParent() const {return parent.get();}
     std::string const& getName() const {return name.get();}
+    proto::IName const& getIName() const {return name;}
+    proto::IName const& getParentIName() const {return parent;}
+    VToken* const getNameToken() const {return name_token.get();}
+    VToken* const getParentToken() const {return parent_token.get();}
 };
 
 class NewExprAST : public ExprAST
 {
     proto::IName class_name;
-    std::unique_ptr<VToken> class_name_token;
     std::vector<std::unique_ptr<ExprAST>> args;
 public:
-    NewExprAST(std::unique_ptr<VToken> class_name_token, std::vector<std::unique_ptr<ExprAST>> args)
-    : class_name(class_name_token->value), class_name_token(std::move(class_name_token)), args(std::move(args)), ExprAST("",ast_new) {};
+    NewExprAST(VToken const& class_name_token, std::vector<std::unique_ptr<ExprAST>> args)
+    : class_name(std::string(class_name_token.value)), args(std::move(args)), ExprAST("",ast_new,class_name_token.loc) {};
 
     std::string const& getName() const {return class_name.get();}
     std::vector<std::unique_ptr<ExprAST>> const& getArgs() {return args;}
@@ -92,10 +95,9 @@ public:
 class DeleteExprAST : public ExprAST
 {
     proto::IName var_name;
-    std::unique_ptr<VToken> var_name_token;
 public:
-    DeleteExprAST(std::unique_ptr<VToken> var_name_token) 
-    : var_name(var_name_token->value), var_name_token(std::move(var_name_token)), ExprAST("",ast_delete) 
+    DeleteExprAST(VToken const& var_name_token) 
+    : var_name(std::string(var_name_token.value)), ExprAST("",ast_delete,var_name_token.loc) 
     {}
 
     std::string const& getName() const {return var_name.get();}
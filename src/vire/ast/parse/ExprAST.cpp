@@ -10,35 +10,37 @@
 #include "ASTType.hpp"
 
 #include "vire/proto/iname.hpp"
+#include "vire/proto/source.hpp"
+#include "vire/proto/arena.hpp"
 
 namespace vire
 {
 
-class ExprAST
+class ExprAST : public proto::ArenaNode
 {
 protected:
-    std::unique_ptr<types::Base> type;
-    std::unique_ptr<VToken> token;
+    types::Base* type;
+    proto::SourceLocation loc;
 public:
     int asttype;
-    ExprAST(const std::string& type, int asttype, std::unique_ptr<VToken> token=nullptr)
-    : asttype(asttype), token(std::move(token)), type(types::construct(type))
+    ExprAST(const std::string& type, int asttype, proto::SourceLocation loc=proto::SourceLocation())
+    : asttype(asttype), loc(loc), type(types::construct(type))
     {}
 
-    ExprAST(std::unique_ptr<types::Base> type, int asttype, std::unique_ptr<VToken> token=nullptr)
-    : asttype(asttype), token(std::move(token)), type(std::move(type))
+    ExprAST(types::Base* type, int asttype, proto::SourceLocation loc=proto::SourceLocation())
+    : asttype(asttype), loc(loc), type(type)
     {}
 
     virtual ~ExprAST() = default;
 
     virtual std::unique_ptr<ExprAST> copyAST() const
     {
-        return std::make_unique<ExprAST>(types::copyType(type.get()), asttype, VToken::construct(token.get()));
+        return std::make_unique<ExprAST>(type, asttype, loc);
     }
 
     virtual types::Base* getType() const 
     {
-        return type.get(); 
+        return type; 
     }
 
     virtual bool refreshType()
@@ -60,38 +62,27 @@ public:
 
         return false;
     }
-    virtual void setType(std::unique_ptr<types::Base> t)
+    virtual void setType(types::Base* t)
     {
-        bool refreshed=refreshType(t.get());
+        bool refreshed=refreshType(t);
         if(!refreshed)
         {
-            type=std::move(t);
+            type=t;
         }
     }
     virtual void setType(std::string const& newtype) 
     {
         setType(types::construct(newtype)); 
     }
-    virtual void setType(types::Base* t)
-    {
-        setType(std::unique_ptr<types::Base>(t));
-    }
 
-    virtual const std::size_t& getLine()    const 
-    {
-        return token->line;
-    }
-    virtual const std::size_t& getCharpos() const 
-    {
-        return token->charpos;
-    } 
-    virtual void setToken(std::unique_ptr<VToken> token) 
+    // Line and column are looked up through the SourceManager that owns the source
+    proto::SourceLocation getLoc() const
     {
-        this->token.reset(); this->token=std::move(token);
+        return loc;
     }
-    virtual VToken* const getToken()     const
+    void setLoc(proto::SourceLocation new_loc)
     {
-        return token.get();
+        loc=new_loc;
     }
 };
 
@@ -18,11 +18,10 @@ class ReturnExprAST;
 class CallExprAST : public ExprAST
 {
     proto::IName callee;
-    std::unique_ptr<VToken> callee_token;
     std::vector<std::unique_ptr<ExprAST>> args;
 public:
-    CallExprAST(std::unique_ptr<VToken> callee_token, std::vector<std::unique_ptr<ExprAST>> args)
-    : callee(callee_token->value), callee_token(std::move(callee_token)), args(std::move(args)), ExprAST("void",ast_call)
+    CallExprAST(VToken const& callee_token, std::vector<std::unique_ptr<ExprAST>> args)
+    : callee(std::string(callee_token.value)), args(std::move(args)), ExprAST("void",ast_call,callee_token.loc)
     {}
 
     proto::IName const& getIName() const
@@ -33,14 +32,6 @@ public:
     {
         return callee.get();
     }
-    VToken* const getToken() const
-    {
-        return callee_token.get();
-    }
-    std::unique_ptr<VToken> moveToken()
-    {
-        return std::move(callee_token);
-    }
 
     std::vector<std::unique_ptr<ExprAST>> const& getArgs() const 
     {
@@ -57,24 +48,20 @@ public:
 };
 
 // FunctionBaseAST - Base Class for the functions
-class FunctionBaseAST
+class FunctionBaseAST : public proto::ArenaNode
 {
 protected:
-    std::unique_ptr<types::Base> return_type;
+    types::Base* return_type;
 public:
     FunctionBaseAST(std::string return_name)
     :   return_type(types::construct(return_name))
     {}
     FunctionBaseAST(types::Base* type)
-    :   return_type(types::copyType(type))
-    {}
-    FunctionBaseAST(std::unique_ptr<types::Base> type)
-    : return_type(std::move(type))
+    :   return_type(type)
     {}
     
-    types::Base* getReturnType() const { return return_type.get(); }
-    void setReturnType(std::unique_ptr<types::Base> t) { this->return_type=std::move(t); }
-    void setReturnType(types::Base* t) { this->return_type=types::copyType(t); }
+    types::Base* getReturnType() const { return return_type; }
+    void setReturnType(types::Base* t) { this->return_type=t; }
 
     virtual proto::IName const& getIName() const = 0;
 
@@ -113,9 +100,9 @@ class PrototypeAST : public FunctionBaseAST
 public:
     int asttype;
 
-    PrototypeAST(std::unique_ptr<VToken> name, std::vector<std::unique_ptr<VariableDefAST>> args, std::unique_ptr<types::Base> return_type, bool requires_selfref=false, bool is_constructor=false)
-    : FunctionBaseAST(std::move(return_type)), args(std::move(args)), asttype(ast_proto), requires_selfref(requires_selfref), is_constructor(is_constructor),
-    name(name->value), name_token(std::move(name))
+    PrototypeAST(std::unique_ptr<VToken> name, std::vector<std::unique_ptr<VariableDefAST>> args, types::Base* return_type, bool requires_selfref=false, bool is_constructor=false)
+    : FunctionBaseAST(return_type), args(std::move(args)), asttype(ast_proto), requires_selfref(requires_selfref), is_constructor(is_constructor),
+    name(std::string(name->value)), name_token(std::move(name))
     {}
 
     proto::IName const& getIName()    const { return name; }
@@ -181,6 +168,8 @@ class FunctionAST : public FunctionBaseAST
     std::vector<ReturnExprAST*> return_stms;
     std::unordered_map<std::string, VariableDefAST*> locals;
     std::unordered_map<std::string, unsigned int> arg_indxs;
+    proto::SourceLocation source_begin;
+    proto::SourceLocation source_end;
     bool requires_selfref;
     bool is_constructor;
 public:
@@ -207,7 +196,7 @@ public:
     VToken* const getNameToken()      const { return proto->getNameToken(); }
     std::unique_ptr<VToken> moveNameToken() { return proto->moveNameToken(); }
 
-    void setReturnType(std::unique_ptr<types::Base> type) { proto->setReturnType(types::copyType(type.get())); this->return_type=std::move(type); }
+    void setReturnType(types::Base* type) { proto->setReturnType(type); this->return_type=type; }
 
     // Block-based Functions
     void insertStatement(std::unique_ptr<ExprAST> statement) 
@@ -239,6 +228,12 @@ public:
 
     void isConstructor(bool val) { proto->isConstructor(val); }
     bool isConstructor() const { return proto->isConstructor(); }
+
+    // Where the function was written, from `func` to past its body. Functions the parser
+    // synthesizes, like constructors, have none
+    void setSourceRange(proto::SourceLocation begin, proto::SourceLocation end) { source_begin=begin; source_end=end; }
+    proto::SourceLocation getSourceBegin() const { return source_begin; }
+    proto::SourceLocation getSourceEnd()   const { return source_end; }
 };
 
 class ReturnExprAST : public ExprAST
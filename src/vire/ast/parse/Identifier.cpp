@@ -11,11 +11,9 @@ class IdentifierExprAST : public ExprAST
     proto::IName name;
 public:
     bool is_const;
-    IdentifierExprAST(std::unique_ptr<VToken> name, bool is_const=false, int asttype=ast_var) 
-    : name(name->value), ExprAST("", asttype), is_const(is_const)
-    {
-        setToken(std::move(name));
-    }
+    IdentifierExprAST(VToken const& name, bool is_const=false, int asttype=ast_var) 
+    : name(std::string(name.value)), ExprAST("", asttype, name.loc), is_const(is_const)
+    {}
 
     virtual std::string const getName() const
     {
@@ -25,11 +23,6 @@ public:
     {
         return name;
     }
-    virtual std::unique_ptr<VToken> moveToken()
-    {
-        return std::move(token);
-    }
-    
     virtual void setName(std::string const& _name)
     {
         name.setName(_name);
@@ -44,8 +37,8 @@ public:
 class VariableExprAST : public IdentifierExprAST
 {
 public:
-    VariableExprAST(std::unique_ptr<VToken> name) : 
-    IdentifierExprAST(std::move(name))
+    VariableExprAST(VToken const& name) : 
+    IdentifierExprAST(name)
     {
     } 
 };
@@ -57,19 +50,17 @@ class TypeAccessAST : public IdentifierExprAST
 public:
     TypeAccessAST(std::unique_ptr<ExprAST> _parent, std::unique_ptr<IdentifierExprAST> _child)
     : parent(std::move(_parent)), child(std::move(_child)), 
-    IdentifierExprAST(VToken::construct(""), false, ast_type_access)
+    IdentifierExprAST(VToken("", tok_id, _parent->getLoc()), false, ast_type_access)
     {
         if(child->asttype==ast_type_access)
         {
             auto* cast_child=(TypeAccessAST*)child.get();
             auto* cast_child_child=(VariableExprAST*)cast_child->getParent();
             setName(cast_child_child->getIName());
-            setToken(VToken::construct(cast_child_child->getIName().name));
         }
         else
         {
             setName(child->getIName());
-            setToken(VToken::construct(child->getIName().name));
         }
     }
 
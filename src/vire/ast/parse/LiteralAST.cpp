@@ -15,8 +15,8 @@ class IntExprAST : public ExprAST
 {
     int val;
 public:
-    IntExprAST(int val, std::unique_ptr<VToken> token) : val(val), 
-    ExprAST(types::construct(types::EType::Int), ast_int, std::move(token)) 
+    IntExprAST(int val, VToken const& token) : val(val), 
+    ExprAST(types::construct(types::EType::Int), ast_int, token.loc) 
     {}
 
     int const getValue() const 
@@ -30,8 +30,8 @@ class FloatExprAST: public ExprAST
 {
     float val;
 public:
-    FloatExprAST(float val, std::unique_ptr<VToken> token=nullptr) : val(val), 
-    ExprAST(types::construct(types::EType::Float),ast_float, std::move(token)) {}
+    FloatExprAST(float val, VToken const& token=VToken()) : val(val), 
+    ExprAST(types::construct(types::EType::Float),ast_float, token.loc) {}
 
     const float& getValue() const {return val;}
 };
@@ -41,8 +41,8 @@ class DoubleExprAST: public ExprAST
 {
     double val;
 public:
-    DoubleExprAST(double val, std::unique_ptr<VToken> token) : val(val), 
-    ExprAST(types::construct(types::EType::Double),ast_double,std::move(token)) {}
+    DoubleExprAST(double val, VToken const& token) : val(val), 
+    ExprAST(types::construct(types::EType::Double),ast_double,token.loc) {}
 
     const double& getValue() const {return val;}
 };
@@ -52,8 +52,8 @@ class CharExprAST : public ExprAST
 {
     char val;
 public:
-    CharExprAST(char val, std::unique_ptr<VToken> token=nullptr) : val(val), 
-    ExprAST(types::construct(types::EType::Char),ast_char,std::move(token)) {}
+    CharExprAST(char val, VToken const& token=VToken()) : val(val), 
+    ExprAST(types::construct(types::EType::Char),ast_char,token.loc) {}
 
     const char& getValue() const {return val;}
 };
@@ -63,8 +63,8 @@ class BoolExprAST : public ExprAST
 {
     bool val;
 public:
-    BoolExprAST(bool val, std::unique_ptr<VToken> token) : val(val),
-    ExprAST(types::construct(types::EType::Bool), ast_bool, std::move(token))
+    BoolExprAST(bool val, VToken const& token) : val(val),
+    ExprAST(types::construct(types::EType::Bool), ast_bool, token.loc)
     {}
 
     bool const getValue() const
@@ -78,7 +78,7 @@ class StrExprAST : public ExprAST
 {
     std::string val;
 public:
-    StrExprAST(const std::string& val, std::unique_ptr<VToken> token=nullptr) : val(val), ExprAST("str",ast_str,std::move(token)) {}
+    StrExprAST(const std::string& val, VToken const& token=VToken()) : val(val), ExprAST("str",ast_str,token.loc) {}
 
     const std::string& getValue() const {return val;}
 };
@@ -91,8 +91,7 @@ public:
     ArrayExprAST(std::vector<std::unique_ptr<ExprAST>> elements)
     :   elements(std::move(elements)), ExprAST("arr", ast_array) 
     {
-        auto t=std::make_unique<types::Array>(types::construct("void"), this->elements.size());
-        setType(std::move(t));
+        setType(types::getContext().getArray(types::construct("void"), this->elements.size()));
     }
 
     std::vector<std::unique_ptr<ExprAST>> const& getElements() const {return elements;}
@@ -9,28 +9,79 @@
 
 #include <vector>
 #include <memory>
+#include <iterator>
+#include <string>
+
+#include "vire/proto/arena.hpp"
+#include "vire/proto/file.hpp"
 
 namespace vire
 {
 
+// ModuleAST - The root of a parsed module. Its nodes and tokens live in `arena`, which
+// is declared before them so that it is freed, all at once, after every node has been destroyed.
+// Nodes made on other threads while analysing the module come from the arenas in `arenas`
 class ModuleAST
 {
+    // Text tokens refer to that is not in a SourceManager, like a serialized module's strings
+    std::vector<std::shared_ptr<const proto::SourceBuffer>> buffers;
+    std::unique_ptr<proto::Arena> arena;
+    std::vector<std::unique_ptr<proto::Arena>> arenas;
+
     std::vector<VariableDefAST*> PreExecutionStatementsVariables;
     std::vector<FunctionAST*> Constructors;
     std::vector<std::unique_ptr<ExprAST>> PreExecutionStatements;
     std::vector<std::unique_ptr<FunctionBaseAST>> Functions;
     std::vector<std::unique_ptr<ClassAST>> Classes;
     std::vector<std::unique_ptr<ExprAST>> UnionStructs;
+    // Paths of the modules named by `import` statements, as written
+    std::vector<std::string> Imports;
 public:
     ModuleAST(std::vector<std::unique_ptr<ExprAST>> PreExecutionStatements,
             std::vector<std::unique_ptr<FunctionBaseAST>> Functions,
             std::vector<std::unique_ptr<ClassAST>> Classes,
-            std::vector<std::unique_ptr<ExprAST>> UnionStructs)
-    :   PreExecutionStatements(std::move(PreExecutionStatements)),
+            std::vector<std::unique_ptr<ExprAST>> UnionStructs,
+            std::unique_ptr<proto::Arena> arena=nullptr)
+    :   arena(std::move(arena)),
+        PreExecutionStatements(std::move(PreExecutionStatements)),
         Functions(std::move(Functions)),
         Classes(std::move(Classes)),
         UnionStructs(std::move(UnionStructs)) {}
 
+    proto::Arena* getArena() const {
+        return arena.get();
+    }
+    void adoptArena(std::unique_ptr<proto::Arena> other) {
+        arenas.push_back(std::move(other));
+    }
+    void adoptBuffer(std::shared_ptr<const proto::SourceBuffer> buffer) {
+        buffers.push_back(std::move(buffer));
+    }
+    // Puts the functions and types of `other`, the interface of a module this one imports, before
+    // this module's own and takes over the arenas they live in
+    void mergeInterface(std::unique_ptr<ModuleAST> other) {
+        Functions.insert(Functions.begin(), std::make_move_iterator(other->Functions.begin()), std::make_move_iterator(other->Functions.end()));
+        UnionStructs.insert(UnionStructs.begin(), std::make_move_iterator(other->UnionStructs.begin()), std::make_move_iterator(other->UnionStructs.end()));
+        Classes.insert(Classes.begin(), std::make_move_iterator(other->Classes.begin()), std::make_move_iterator(other->Classes.end()));
+        other->Functions.clear();
+        other->UnionStructs.clear();
+        other->Classes.clear();
+
+        if(other->arena)
+            arenas.push_back(std::move(other->arena));
+        for(auto& other_arena : other->arenas)
+            arenas.push_back(std::move(other_arena));
+        for(auto& buffer : other->buffers)
+            buffers.push_back(std::move(buffer));
+    }
+
+    std::vector<std::string> const& getImports() const {
+        return Imports;
+    }
+    void setImports(std::vector<std::string> imports) {
+        Imports=std::move(imports);
+    }
+
     std::vector<std::unique_ptr<ExprAST>> const& getPreExecutionStatements() const {
         return PreExecutionStatements;
     }
@@ -72,6 +123,9 @@ public:
     void addConstructor(FunctionAST* constructor) {
         Constructors.push_back(constructor);
     }
+    void addClass(std::unique_ptr<ClassAST> class_) {
+        Classes.push_back(std::move(class_));
+    }
 
     void addUnionStruct(std::unique_ptr<ExprAST> union_struct)
     {
@@ -15,7 +15,7 @@ class UnaryExprAST : public ExprAST
     std::unique_ptr<ExprAST> Expr;
 public:
     UnaryExprAST(std::unique_ptr<VToken> op, std::unique_ptr<ExprAST> Expr)
-    : op(std::move(op)), Expr(std::move(Expr)), ExprAST("void",ast_unop) {}
+    : ExprAST("void",ast_unop,op->loc), op(std::move(op)), Expr(std::move(Expr)) {}
 
     VToken* const getop() const { return op.get();   }
     ExprAST* const getExpr() const { return Expr.get(); }
@@ -29,7 +29,7 @@ class BinaryExprAST : public ExprAST
 public:
 
     BinaryExprAST(std::unique_ptr<VToken> op, std::unique_ptr<ExprAST> lhs, std::unique_ptr<ExprAST> rhs)
-    : op(std::move(op)), lhs(std::move(lhs)), rhs(std::move(rhs)), ExprAST("bool",ast_binop) {}
+    : ExprAST("bool",ast_binop,op->loc), op(std::move(op)), lhs(std::move(lhs)), rhs(std::move(rhs)) {}
 
     VToken* const getOp() const {return op.get();}
     ExprAST* const getLHS() const {return lhs.get();}
@@ -56,7 +56,7 @@ public:
             case tok_div:   return nullptr;
             case tok_mod:   return nullptr;
         default:
-            return type.get();
+            return type;
         }
     }
 };
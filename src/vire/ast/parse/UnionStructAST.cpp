@@ -3,6 +3,7 @@
 #include "ASTType.hpp"
 #include "ExprAST.cpp"
 
+#include <algorithm>
 #include <memory>
 #include <vector>
 #include <map>
@@ -20,16 +21,40 @@ class TypeAST : public ExprAST
 {
     INameExprMap members;
     INameIntMap members_indx;
+    // Members in the order they are declared in, which is what the layout follows. The map's own
+    // order depends on the ids names were interned with and differs between compilations
+    std::vector<ExprAST*> members_order;
     proto::IName name;
     std::unique_ptr<VToken> name_token;
 public:
-    TypeAST(INameExprMap members, std::unique_ptr<VToken> name, int asttype=ast_type)
-    : members(std::move(members)), members_indx(INameIntMap()), name(name->value), ExprAST("void", asttype)
+    // Without an `order` the members are ordered by where they are in the source
+    TypeAST(INameExprMap members, std::unique_ptr<VToken> name, int asttype=ast_type, std::vector<proto::IName> const& order={})
+    : members(std::move(members)), members_indx(INameIntMap()), name(std::string(name->value)), ExprAST("void", asttype, name->loc)
     {
         name_token=std::move(name);
-        int i=this->members.size()-1;
-        for(auto& [iname, ptr] : this->members)
+
+        std::vector<std::pair<proto::IName, ExprAST*>> sorted;
+        sorted.reserve(this->members.size());
+        if(order.empty())
+        {
+            for(auto& [iname, ptr] : this->members)
+                sorted.push_back(std::make_pair(iname, ptr.get()));
+            std::stable_sort(sorted.begin(), sorted.end(), [](auto const& lhs, auto const& rhs)
+            {
+                return lhs.second->getLoc()<rhs.second->getLoc();
+            });
+        }
+        else
+        {
+            for(auto const& iname : order)
+                sorted.push_back(std::make_pair(iname, this->members.at(iname).get()));
+        }
+
+        int i=sorted.size()-1;
+        members_order.reserve(sorted.size());
+        for(auto const& [iname, member] : sorted)
         {
+            members_order.push_back(member);
             this->members_indx[iname]=i--;
         }
     }
@@ -53,15 +78,7 @@ public:
     }
     virtual std::vector<ExprAST*> const getMembersValues() const
     {
-        std::vector<ExprAST*> values;
-        values.reserve(members.size());
-
-        for(auto& [str,ptr]:members)
-        {
-            values.push_back(ptr.get());
-        }
-
-        return values;
+        return members_order;
     }
     virtual int const getMemberIndex(proto::IName const& name)
     {
@@ -90,8 +107,8 @@ public:
 class UnionExprAST : public TypeAST
 {
 public:
-    UnionExprAST(INameExprMap members, std::unique_ptr<VToken> name)
-    : TypeAST(std::move(members), std::move(name), ast_union)
+    UnionExprAST(INameExprMap members, std::unique_ptr<VToken> name, std::vector<proto::IName> const& order={})
+    : TypeAST(std::move(members), std::move(name), ast_union, order)
     {
     }
 };
@@ -99,9 +116,10 @@ public:
 class StructExprAST : public TypeAST
 {
     std::unique_ptr<FunctionAST> constructor;
+    bool imported=false;
 public:
-    StructExprAST(INameExprMap members, std::unique_ptr<FunctionAST> constructor, std::unique_ptr<VToken> name)
-    : TypeAST(std::move(members), std::move(name), ast_struct), constructor(std::move(constructor))
+    StructExprAST(INameExprMap members, std::unique_ptr<FunctionAST> constructor, std::unique_ptr<VToken> name, std::vector<proto::IName> const& order={})
+    : TypeAST(std::move(members), std::move(name), ast_struct, order), constructor(std::move(constructor))
     {
     }
     StructExprAST(INameExprMap members, std::unique_ptr<VToken> name)
@@ -111,6 +129,10 @@ public:
 
     FunctionAST* const getConstructor() const { return constructor.get(); }
     void setConstructor(std::unique_ptr<FunctionAST> new_constructor) { constructor=std::move(new_constructor); }
+
+    // Defined by an imported module, the module defining it compiles its constructor
+    bool isImported() const { return imported; }
+    void setImported(bool value) { imported=value; }
 };
 
 }
\ No newline at end of file
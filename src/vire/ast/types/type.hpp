@@ -5,6 +5,9 @@
 #include <iostream>
 #include <ostream>
 #include <memory>
+#include <vector>
+#include <map>
+#include <mutex>
 
 namespace vire
 {
@@ -26,8 +29,8 @@ enum class EType
     Any,
 };
 
-// Type Map
-inline std::unordered_map<std::string, EType> type_map=
+// Type Map, the builtin names every TypeContext starts out with
+inline const std::unordered_map<std::string, EType> builtin_type_map=
 {
     {"void", EType::Void},
     {"char", EType::Char},
@@ -39,7 +42,7 @@ inline std::unordered_map<std::string, EType> type_map=
     {"bool", EType::Bool},
     {"any", EType::Any},
 };
-inline std::unordered_map<EType, std::string> typestr_map=
+inline const std::unordered_map<EType, std::string> typestr_map=
 {
     {EType::Void, "void"},
     {EType::Char, "char"},
@@ -52,14 +55,13 @@ inline std::unordered_map<EType, std::string> typestr_map=
     {EType::Custom, "custom"},
     {EType::Any, "any"},
 };
-inline std::unordered_map<std::string, int> custom_type_sizes=
-{ };
-
 // Prototypes
 inline std::string getMapFromType(EType const& type);
 inline EType getTypeFromMap(std::string typestr);
 
 // Classes
+// Types are immutable and canonical, every distinct type is created once by the TypeContext
+// and AST nodes only hold non-owning pointers to it
 class Base
 {
 protected:
@@ -74,6 +76,7 @@ public:
     {
         type = EType::Void;
         size = 0;
+        precedence = 0;
         is_const = _is_const;
         is_signed = true;
     }
@@ -84,11 +87,6 @@ public:
 
     virtual unsigned int getDepth() const { return 0; }
 
-    virtual void setSize(unsigned int new_size)
-    {
-        size=new_size;
-    }
-    
     virtual bool isSame(Base* const other) const
     {
         return (getType() == other->getType()); 
@@ -102,8 +100,8 @@ public:
 inline bool isSame(Base* const a, Base* const b);
 inline bool isSame(Base* const a, const char*  b);
 
-inline std::unique_ptr<Base> construct(std::string typestr, bool create_custom=false);
-inline std::unique_ptr<Base> construct(EType const& type);
+inline Base* construct(std::string typestr, bool create_custom=false);
+inline Base* construct(EType const& type);
 inline Base* getArrayRootType(Base* const type);
 
 inline std::ostream& operator<<(std::ostream& os, Base const& type)
@@ -129,10 +127,6 @@ public:
     {
         return name;
     }
-    void setName(std::string const& _name)
-    {
-        name=_name;
-    }
 };
 
 class Char : public Base
@@ -221,21 +215,13 @@ public:
 
 class Array : public Base
 {
-    std::unique_ptr<Base> child;
+    Base* child;
     unsigned int length;
 public:
-    Array(std::unique_ptr<Base> b, int length, bool _is_const=true)
-    {
-        this->type = EType::Array;
-        this->child = std::move(b);
-        this->length = length;
-        this->size = child->getSize() * length;
-        is_const=_is_const;
-    }
     Array(Base* b, int length, bool _is_const=true)
     {
         this->type = EType::Array;
-        this->child = std::unique_ptr<Base>(b);
+        this->child = b;
         this->length = length;
         this->size = child->getSize() * length;
         is_const=_is_const;
@@ -243,19 +229,13 @@ public:
 
     Base* getChild() const 
     {
-        return child.get(); 
+        return child; 
     }
     EType getChildType() const
     {
         return child->getType();
     }
 
-    void setChild(std::unique_ptr<Base> new_child)
-    {
-        child.release();
-        child = std::move(new_child);
-    }
-
     unsigned int getDepth() const
     {
         return child->getDepth() + 1;
@@ -264,11 +244,6 @@ public:
     {
         return length;
     }
-    void setLength(unsigned int new_length)
-    {
-        length = new_length;
-        size = child->getSize() * length;
-    }
 
     bool isSame(Base* const other)
     {
@@ -276,7 +251,7 @@ public:
         {
             Array* other_array = static_cast<Array*>(other);
 
-            bool same_child = types::isSame(child.get(), other_array->getChild());
+            bool same_child = types::isSame(child, other_array->getChild());
             bool same_length = (length == other_array->getLength());
        
             bool b=false;
@@ -285,7 +260,7 @@ public:
             bool this_has_auto=false;
             if(child->getType()==EType::Array)
             {
-                this_has_auto=getArrayRootType(static_cast<Array*>(child.get()))->getType()==EType::Void;
+                this_has_auto=getArrayRootType(static_cast<Array*>(child))->getType()==EType::Void;
             }
             else
             {
@@ -341,59 +316,189 @@ public:
     }
 };
 
-// Functions
-inline bool isSame(Base* const a, Base* const b)
-{
-    if(a->getType() == b->getType())
+// TypeContext - The types of one compilation. Owns the one object of every distinct type,
+// hash-consed by kind, name and (for arrays) child and length. Nested types are interned bottom
+// up, so an array's child is already canonical and two arrays are equal exactly when their
+// pointers are. Also holds the names of the types the compilation defines and their sizes,
+// so separate compilations never see each other's structs
+class TypeContext
+{
+    std::vector<std::unique_ptr<Base>> owned;
+    std::unordered_map<EType, Base*> primitives;
+    std::unordered_map<std::string, Void*> voids;
+    std::unordered_map<std::string, Custom*> customs;
+    std::map<std::pair<Base*, unsigned int>, Array*> arrays;
+
+    std::unordered_map<std::string, EType> type_map;
+    std::unordered_map<std::string, int> custom_type_sizes;
+    std::mutex lock;
+
+    template<typename T, typename... Args>
+    T* own(Args&&... args)
+    {
+        auto type=std::make_unique<T>(std::forward<Args>(args)...);
+        auto* ptr=type.get();
+        owned.push_back(std::move(type));
+        return ptr;
+    }
+    void init()
+    {
+        primitives[EType::Char]=own<Char>();
+        primitives[EType::Short]=own<Short>();
+        primitives[EType::Int]=own<Int>();
+        primitives[EType::Long]=own<Long>();
+        primitives[EType::Float]=own<Float>();
+        primitives[EType::Double]=own<Double>();
+        primitives[EType::Bool]=own<Bool>();
+        primitives[EType::Any]=own<Any>();
+        voids[""]=own<Void>();
+
+        type_map=builtin_type_map;
+    }
+public:
+    TypeContext()
     {
-        if(a->getType() != EType::Array)
-        {
-            if(a->getType() == EType::Custom)
-            {
-                return a->isSame(b);
-            }
+        init();
+    }
 
-            return true;
-        }
-        else
-        {
-            Array* a_array = static_cast<Array*>(a);
-            
-            bool f=a_array->isSame(b);
+    TypeContext(TypeContext const&)=delete;
+    TypeContext& operator=(TypeContext const&)=delete;
 
-            return f;
-        }
+    // Primitives and `any`, every other kind needs more than its EType and gives the plain void
+    Base* get(EType type)
+    {
+        auto it=primitives.find(type);
+        if(it!=primitives.end())
+            return it->second;
+        return getVoid();
+    }
+    // A void type carries the name of a type that is not resolved yet, "" is plain void
+    Void* getVoid(std::string const& name="")
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        auto& ty=voids[name];
+        if(!ty)
+            ty=own<Void>(name);
+        return ty;
+    }
+    // The size of a custom type is fixed by whoever creates it first
+    Custom* getCustom(std::string const& name, long size)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        auto& ty=customs[name];
+        if(!ty)
+            ty=own<Custom>(name, size);
+        return ty;
+    }
+    Custom* findCustom(std::string const& name)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        auto it=customs.find(name);
+        return it==customs.end()?nullptr:it->second;
+    }
+    Array* getArray(Base* child, unsigned int length)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        auto& ty=arrays[std::make_pair(child, length)];
+        if(!ty)
+            ty=own<Array>(child, length);
+        return ty;
     }
-    return false;
-}
-inline bool isSame(Base* const a, const char* b)
-{
-    auto t=construct(b);
-    bool same=isSame(a, t.get());
-    return same;
-}
 
-inline std::unique_ptr<Base> copyType(Base* const type)
+    EType getTypeFromMap(std::string const& name) const
+    {
+        auto it=type_map.find(name);
+        return it==type_map.end()?EType::Custom:it->second;
+    }
+    bool isTypeinMap(std::string const& name) const
+    {
+        return type_map.count(name)>0;
+    }
+    void addTypeToMap(std::string const& name)
+    {
+        type_map.insert(std::make_pair(name,EType::Custom));
+    }
+
+    int getTypeSize(std::string const& name) const
+    {
+        auto it=custom_type_sizes.find(name);
+        return it==custom_type_sizes.end()?0:it->second;
+    }
+    void addTypeSizeToMap(std::string const& name, unsigned int size)
+    {
+        custom_type_sizes.insert(std::make_pair(name,size));
+    }
+
+    // Forgets every type and definition, pointers handed out before are dangling afterwards
+    void reset()
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        primitives.clear();
+        voids.clear();
+        customs.clear();
+        arrays.clear();
+        custom_type_sizes.clear();
+        owned.clear();
+        init();
+    }
+};
+
+inline thread_local TypeContext* current_context=nullptr;
+
+// TypeContextScope - Makes `context` the one types are resolved in on this thread until the
+// scope ends. The parser, analyzer and compiler each install the context they were given
+class TypeContextScope
 {
-    if(type->getType() == EType::Array)
+    TypeContext* previous;
+public:
+    explicit TypeContextScope(TypeContext* context)
+    : previous(current_context)
     {
-        Array* array = static_cast<Array*>(type);
-        return std::make_unique<Array>(copyType(array->getChild()), array->getLength());
+        current_context=context;
     }
-    else if(type->getType() == EType::Custom)
+    ~TypeContextScope()
     {
-        auto* ctype=(Custom*)type;
-        return construct(ctype->getName(), true);
+        current_context=previous;
     }
-    else if(type->getType() == EType::Void)
+
+    TypeContextScope(TypeContextScope const&)=delete;
+    TypeContextScope& operator=(TypeContextScope const&)=delete;
+};
+
+// The context of the running compilation, code running outside of any gets a process-wide one
+inline TypeContext& getContext()
+{
+    if(current_context)
+        return *current_context;
+
+    static TypeContext fallback;
+    return fallback;
+}
+
+// Functions
+inline bool isSame(Base* const a, Base* const b)
+{
+    if(a == b)
     {
-        auto* vtype=(Void*)type;
-        return std::make_unique<types::Void>(vtype->getName());
+        return true;
     }
-    else
+    if(a->getType() == b->getType())
     {
-        return construct(type->getType());
+        if(a->getType() == EType::Array)
+        {
+            // An inferred (void) element type matches any array of the same length
+            Array* a_array = static_cast<Array*>(a);
+            return a_array->isSame(b);
+        }
+
+        // Unresolved type names are only told apart once they are resolved
+        return a->getType() == EType::Void;
     }
+    return false;
+}
+inline bool isSame(Base* const a, const char* b)
+{
+    return isSame(a, construct(b));
 }
 
 inline void printAsArray(Base* const type)
@@ -418,14 +523,7 @@ inline Base* getArrayRootType(Base* const arr)
 
 inline EType getTypeFromMap(std::string typestr)
 {
-    if(type_map.contains(typestr))
-    {
-        return type_map[typestr];
-    }
-    else
-    {
-        return EType::Custom;
-    }
+    return getContext().getTypeFromMap(typestr);
 }
 inline std::string getMapFromType(EType const& type)
 {
@@ -435,7 +533,7 @@ inline std::string getMapFromType(EType const& type)
     }
     else if(typestr_map.contains(type))
     {
-        return typestr_map[type];
+        return typestr_map.at(type);
     }
     else
     {
@@ -443,68 +541,37 @@ inline std::string getMapFromType(EType const& type)
     }
 }
 
-inline std::unique_ptr<Base> construct(std::string typestr, bool create_custom)
+inline Base* construct(std::string typestr, bool create_custom)
 {
+    auto& context=getContext();
+
     EType type=getTypeFromMap(typestr);
     switch(type)
     {
-        case EType::Void:
-            return std::make_unique<Void>();
-        case EType::Char:
-            return std::make_unique<Char>();
-        case EType::Short:
-            return std::make_unique<Short>();
-        case EType::Int:
-            return std::make_unique<Int>();
-        case EType::Long:
-            return std::make_unique<Long>();
-        case EType::Float:
-            return std::make_unique<Float>();
-        case EType::Double:
-            return std::make_unique<Double>();
-        case EType::Bool:
-            return std::make_unique<Bool>();
         case EType::Custom:
         {
             if(!create_custom)
             {
                 // std::cout << "Typestr: " << typestr << std::endl;
-                return std::make_unique<Void>(typestr);
+                return context.getVoid(typestr);
             }
             
-            return std::make_unique<Custom>(typestr, custom_type_sizes.at(typestr));
+            if(auto* custom=context.findCustom(typestr))
+                return custom;
+            return context.getCustom(typestr, context.getTypeSize(typestr));
         }
-        case EType::Any:
-            return std::make_unique<Any>();
 
         default:
-            return std::make_unique<Void>();
+            return context.get(type);
     }
 }
-inline std::unique_ptr<Base> construct(EType const& type)
+inline Base* construct(EType const& type)
 {
-    switch(type)
+    if(type == EType::Any)
     {
-        case EType::Void:
-            return std::make_unique<Void>();
-        case EType::Char:
-            return std::make_unique<Char>();
-        case EType::Short:
-            return std::make_unique<Short>();
-        case EType::Int:
-            return std::make_unique<Int>();
-        case EType::Long:
-            return std::make_unique<Long>();
-        case EType::Float:
-            return std::make_unique<Float>();
-        case EType::Double:
-            return std::make_unique<Double>();
-        case EType::Bool:
-            return std::make_unique<Bool>();
-        
-        default:
-            return std::make_unique<Void>();
+        return getContext().getVoid();
     }
+    return getContext().get(type);
 }
 
 inline bool isUserDefined(EType type)
@@ -527,21 +594,16 @@ inline bool isTypeFloatingPoint(Base* type)
 
 inline void addTypeToMap(std::string name)
 {
-    type_map.insert(std::make_pair(name,EType::Custom));
+    getContext().addTypeToMap(name);
 }
 inline bool isTypeinMap(std::string name)
 {
-    if(type_map.count(name)>0)
-    {
-        return true;
-    }
-
-    return false;
+    return getContext().isTypeinMap(name);
 }
 
 inline void addTypeSizeToMap(std::string name, unsigned int size)
 {
-    custom_type_sizes.insert(std::make_pair(name,size));
+    getContext().addTypeSizeToMap(name, size);
 }
 
 inline bool isNumericType(EType type)
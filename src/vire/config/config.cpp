@@ -51,19 +51,22 @@ namespace vire
         KeywordTokenMap["except"]=tok_except;
         KeywordTokenMap["unsafe"]=tok_unsafe;
         KeywordTokenMap["constructor"]=tok_constructor;
+        KeywordTokenMap["import"]=tok_import;
         KeywordTokenMap_end=KeywordTokenMap.end();
     }
     
-    int Config::getBinopPrecedence(std::string const& tok)
+    int Config::getBinopPrecedence(std::string_view tok)
     {
-        if(BinopPrecendence.contains(tok))
-            return BinopPrecendence.at(tok);
+        // Operators fit in the small-string buffer, so this does not allocate
+        auto it=BinopPrecendence.find(std::string(tok));
+        if(it!=BinopPrecendence.end())
+            return it->second;
         else
             return -1;
     }
-    int Config::getKeywordToken(std::string const& keyw)
+    int Config::getKeywordToken(std::string_view keyw)
     {
-        auto* keyword=Perfect_Hash::hash_keyword_to_token(keyw.c_str(), keyw.length());
+        auto* keyword=Perfect_Hash::hash_keyword_to_token(keyw.data(), keyw.length());
         if(keyword)
             return keyword->KeywordCode;
 
@@ -2,6 +2,7 @@
 
 #include <unordered_map>
 #include <string>
+#include <string_view>
 #include <array>
 
 #ifdef VIRE_USE_EMCC
@@ -58,8 +59,8 @@ public:
     void installDefaultBinops(); // default binops
     void installDefaultKeywords(); // default keywords
 
-    int getBinopPrecedence(std::string const& tok);
-    int getKeywordToken(std::string const& keyw);
+    int getBinopPrecedence(std::string_view tok);
+    int getKeywordToken(std::string_view keyw);
 };
 
 }
\ No newline at end of file
@@ -5,4 +5,5 @@ add_library(
     ${SRC_DIR}/src/vire/errors/builder.cpp
 )
 
+target_link_libraries(vire-error-builder PRIVATE vire-proto-file)
 target_link_libraries(VIRELANG PRIVATE vire-error-builder)
\ No newline at end of file
@@ -23,18 +23,12 @@ namespace errors
 
 
     std::string ErrorBuilder::constructCodePosition
-    (const std::string& input, std::size_t line, std::size_t column, int column_len)
+    (proto::SourceManager const& sources, proto::SourceLocation loc, int column_len)
     {
         std::string result;
         
-        std::string code(input);
-        std::vector<std::string> lines;
-        std::size_t pos=0;
-        while((pos=code.find("\n"))!=std::string::npos)
-        {
-            lines.push_back(code.substr(0, pos));
-            code.erase(0, pos+1);
-        }
+        std::size_t line=sources.getLine(loc);
+        std::size_t column=sources.getColumn(loc);
 
         int start_pos=0;
         int end_pos=line+1;
@@ -50,13 +44,13 @@ namespace errors
             if(i!=end_pos-1)
             {
                 result+=dull_tag;
-                result+=lines[i];
+                result+=sources.getLineText(loc, i);
                 result+=reset_tag;
             }
             else
             {
                 result+=red_tag;
-                result+=lines[i];
+                result+=sources.getLineText(loc, i);
                 result+=reset_tag;
             }
             result+="\n";
@@ -72,10 +66,10 @@ namespace errors
 
     /*
     template<>
-    void ErrorBuilder::addError<lex_unknown_char>(const std::string& code, char _char, char fix, std::size_t line, std::size_t column)
+    void ErrorBuilder::addError<lex_unknown_char>(proto::SourceManager const& sources, char _char, char fix, proto::SourceLocation loc)
     {
         std::string error;
-        error+=constructCodePosition(code, line, column, 1);
+        error+=constructCodePosition(sources, loc, 1);
         error+="\n";
 
         error.append(red_tag);
@@ -108,10 +102,10 @@ namespace errors
     
     template<>
     void ErrorBuilder::addError<analyze_requires_type>(
-    const std::string& code, unsigned char islet, const std::string& var_name, std::size_t line, std::size_t column)
+    proto::SourceManager const& sources, unsigned char islet, const std::string& var_name, proto::SourceLocation loc)
     {
         std::string error;
-        error+=constructCodePosition(code, line, column, 1);
+        error+=constructCodePosition(sources, loc, 1);
         error+="\n";
 
         error.append(red_tag);
@@ -126,7 +120,7 @@ namespace errors
         error.append("\n");
         error.append(green_tag);
 
-        error.append(std::to_string(line+1));
+        error.append(std::to_string(sources.getLine(loc)+1));
         error.append(" | ");
         if(islet)   error.append("let ");
         else   error.append("const ");
@@ -2,6 +2,9 @@
 
 #include <vector>
 #include <string>
+#include <string_view>
+
+#include "vire/proto/source.hpp"
 
 namespace vire
 {
@@ -31,18 +34,18 @@ public:
     void setPrefix(const std::string& newprefix) {prefix=newprefix;}
 
     std::string constructCodePosition
-    (const std::string& input, std::size_t line, std::size_t column, int column_len=1);
+    (proto::SourceManager const& sources, proto::SourceLocation loc, int column_len=1);
 
     template<errortypes X>
     void addError();
 
     template<errortypes X>
-    void addError(const std::string& code, char _char, char fix='\0', std::size_t line=0, std::size_t column=0); // <errortypes::lex_unknown_char>
+    void addError(proto::SourceManager const& sources, char _char, char fix='\0', proto::SourceLocation loc=proto::SourceLocation()); // <errortypes::lex_unknown_char>
 
 
 
     template<errortypes X>
-    void addError(const std::string& code, unsigned char islet, const std::string& varname="my_var", std::size_t line=0, std::size_t column=0); // <errortypes::analyzer_requires_type>
+    void addError(proto::SourceManager const& sources, unsigned char islet, const std::string& varname="my_var", proto::SourceLocation loc=proto::SourceLocation()); // <errortypes::analyzer_requires_type>
 
     void showErrors();
 };
@@ -2,4 +2,6 @@
 
 #include "lexer.cpp"
 #include "token.cpp"
+#include "token_table.cpp"
+#include "scan.cpp"
 #include "token.hpp"
\ No newline at end of file
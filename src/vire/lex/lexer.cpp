@@ -3,15 +3,20 @@
 #include <iostream>
 #include <ostream> // cout, endl
 #include <string> // string
+#include <string_view> // string_view
 #include <memory> // unique_ptr
 #include <cctype> // isspace
 #include <cstddef> // size_t
 
 #include "token.hpp"
 #include "token.cpp"
+#include "token_table.cpp"
+#include "scan.cpp"
 
 #include "vire/errors/include.hpp"
 #include "vire/config/config.hpp"
+#include "vire/proto/file.hpp"
+#include "vire/proto/source.hpp"
 
 namespace vire
 {
@@ -21,19 +26,25 @@ class VLexer
 protected:
     char cur;
     std::size_t indx;
-    std::size_t line;
-    std::size_t charpos;
+    std::size_t tok_start; // index the current token starts at
     errors::ErrorBuilder* builder; // error builder
     std::unique_ptr<Config> config;
+    std::shared_ptr<const proto::SourceBuffer> source; // keeps `code` alive
+    proto::SourceLocation start; // location of `code[0]`
 public:
     bool jit;
-    std::string code;
+    std::string_view code;
     std::size_t len;
 
     VLexer(std::string code, errors::ErrorBuilder* builder)
-    : builder(builder), jit(false)
+    : VLexer(proto::SourceBuffer::fromString(std::move(code)), builder)
+    {}
+    // `start` is the location the SourceManager gave `source`
+    VLexer(std::shared_ptr<const proto::SourceBuffer> source, errors::ErrorBuilder* builder, 
+        proto::SourceLocation start=proto::SourceLocation(proto::SourceManager::first_offset))
+    : builder(builder), source(std::move(source)), start(start), jit(false)
     {
-        this->code=code;
+        this->code=this->source->view();
         config=std::make_unique<Config>();
         config->installDefaultBinops();
         config->installDefaultKeywords();
@@ -44,12 +55,16 @@ public:
     {
         return config.get();
     }
+    proto::SourceLocation getStart() const
+    {
+        return start;
+    }
 
     void reset()
     {
         this->cur=' ';
         this->indx=-1;
-        this->line=0;
+        this->tok_start=0;
 
         if(!jit)
         {
@@ -57,11 +72,9 @@ public:
         }
         else
         {
-            this->code="";
+            this->code=std::string_view();
             this->len=0;
         }
-
-        this->charpos=-1;
     }
     char getNext(char move_amt=0)
     {
@@ -69,57 +82,112 @@ public:
             return EOF;
         
         this->indx+=move_amt+1;
-        this->charpos++;
         
-        return this->code.at(this->indx);
+        return this->code[this->indx];
     }
     void advanceNext(char move_amt=0)
     {
         this->cur=getNext(move_amt);
     }
+    // Same as calling advanceNext() `n` times, returns the number of characters actually moved over
+    std::size_t advanceBy(std::size_t n)
+    {
+        if(n==0)    return 0;
+
+        std::size_t remaining=this->len-1-this->indx;
+        if(n>remaining)
+        {
+            this->indx+=remaining;
+            this->cur=EOF;
+            return remaining;
+        }
+
+        this->indx+=n;
+        this->cur=this->code[this->indx];
+        return n;
+    }
 
     char peekNext(char amt)
     {
         if(this->indx+amt>this->len-1)  return EOF;
 
-        return this->code.at(this->indx+amt);
+        return this->code[this->indx+amt];
     }
 
-    std::string gatherId()
+    // Continues lexing at `offset`, as if everything before it had been read
+    void seek(std::size_t offset)
     {
-        std::string id="";
-
-        while(isalnum(this->cur) || this->cur=='_')
+        this->indx=offset;
+        this->tok_start=offset;
+        this->cur=offset<this->len ? this->code[offset] : EOF;
+    }
+    // Moves up to the `}` that closes the `depth` blocks that are open without making any tokens,
+    // strings and characters are stepped over so that braces in them do not count. Returns false
+    // if the source ends first
+    bool skipBlock(unsigned int depth)
+    {
+        skipWhitespace();
+        while(this->cur!=EOF)
         {
-            if(this->cur==EOF)
-                break;
-            id+=this->cur;
-            advanceNext();   
+            advanceBy(scan::find<scan::Brace>(here(), end()));
+            switch(this->cur)
+            {
+                case '{': ++depth; break;
+                case '}': if(--depth==0) return true; break;
+                case '\"': advanceNext(); advanceBy(scan::find<scan::Quote>(here(), end())); break;
+                case '\'': advanceBy(2); break; // what gatherChar() reads, the quote, one character and a quote
+                default: break;
+            }
+            advanceNext();
         }
+        return false;
+    }
+
+    // Returns a span of `len` characters of the source starting at `start`
+    std::string_view slice(std::size_t start, std::size_t len) const
+    {
+        return code.substr(start, len);
+    }
+
+    // Pointer to the current character in `code`, and the end of `code`
+    const char* here() const { return this->code.data()+this->indx; }
+    const char* end() const { return this->code.data()+this->len; }
+
+    void skipWhitespace()
+    {
+        if(this->indx==(std::size_t)-1) // the space reset() leaves in `cur` is not part of `code`
+            advanceNext();
+        
+        if(isspace(this->cur))
+            advanceBy(scan::span<scan::Space>(here(), end()));
+    }
+
+    std::string_view gatherId()
+    {
+        std::size_t start=this->indx;
+        std::size_t idlen=scan::span<scan::IdChar>(here(), end());
+        advanceBy(idlen);
 
-        return id;
+        return slice(start, idlen);
     }
-    std::unique_ptr<VToken> gatherNum()
+    VToken gatherNum()
     {
-        std::string numstr;
+        std::size_t start=this->indx, numlen=0;
         int ttype;
 
-        while(isdigit(this->cur))
-        {
-            numstr+=this->cur;
-            advanceNext();
-        }
+        numlen=scan::span<scan::Digit>(here(), end());
+        advanceBy(numlen);
 
         ttype=tok_int;
 
         if(this->cur=='.')
         {
             advanceNext();
-            numstr+=".";
+            ++numlen;
         }
         else
         {
-            return makeTokenInplace(numstr, ttype);
+            return makeTokenInplace(slice(start, numlen), ttype);
         }
 
         if(!isdigit(this->cur))
@@ -127,10 +195,11 @@ public:
             std::cout << "Expected integer literal after decimal point" << std::endl;
         }
 
-        while(isdigit(this->cur))
+        if(this->cur!=EOF)
         {
-            numstr+=this->cur;
-            advanceNext();
+            std::size_t frac=scan::span<scan::Digit>(here(), end());
+            numlen+=frac;
+            advanceBy(frac);
         }
 
         if(this->cur=='f' || this->cur=='F')
@@ -148,79 +217,87 @@ public:
             ttype=tok_float;
         }
 
-        return makeTokenInplace(numstr,ttype);
+        return makeTokenInplace(slice(start, numlen),ttype);
     }
-    std::unique_ptr<VToken> gatherChar()
+    VToken gatherChar()
     {
-        std::string ch;
         advanceNext(); // eat `'`
         
-        ch+=this->cur; // set ch to char
+        auto ch=slice(this->indx, 1); // set ch to char
         
         advanceNext(); // eat the char
         advanceNext(); // eat the `'`
 
         return makeTokenInplace(ch, tok_char);
     }
-    std::unique_ptr<VToken> gatherStr()
+    VToken gatherStr()
     {
-        std::string str="";
         advanceNext(); // consume the start d-quote
+        if(this->cur==EOF)
+            return makeInvalidToken('\"');
 
-        while(this->cur!='\"')
-        {
-            str+=this->cur;
-            advanceNext();
+        std::size_t start=this->indx;
+        std::size_t slen=scan::find<scan::Quote>(here(), end());
+        advanceBy(slen);
 
-            if(this->cur==EOF)
-            {
-                // builder->addError<errors::lex_unknown_char>(code, ' ', '\0', line, charpos);
-                return nullptr;
-            }
+        if(this->cur!='\"')
+        {
+            // builder->addError<errors::lex_unknown_char>(sources, ' ', '\0', locOf(tok_start));
+            return makeInvalidToken('\"');
         }
 
+        auto str=slice(start, slen);
         advanceNext(); // consume the end d-quote
 
         return makeTokenInplace(str, tok_str);
     }
 
-    std::unique_ptr<VToken> makeTokenInplace(std::string value, int type)
+    proto::SourceLocation locOf(std::size_t indx) const
     {
-        auto tok=std::make_unique<VToken>(value, type, this->line, this->charpos);
-        return std::move(tok);
+        return start.getOffset(indx);
     }
-    std::unique_ptr<VToken> makeToken(std::string value, int type, char move=0)
+    // Tokens are located where their text starts, empty ones where the token started
+    VToken makeTokenInplace(std::string_view value, int type)
     {
-        this->cur=this->getNext(move);
-        auto tok=this->makeTokenInplace(value,type);
-
-        return std::move(tok);
+        std::size_t at=value.empty() ? this->tok_start : value.data()-this->code.data();
+        return VToken(value, type, locOf(at));
     }
-    std::unique_ptr<VToken> makeToken(const char* value, int type, char move=0)
+    // Makes a token spanning the current character and the next `move` characters
+    VToken makeToken(int type, char move=0)
     {
+        auto value=slice(this->indx, move+1);
         this->cur=this->getNext(move);
-        auto tok=this->makeTokenInplace(std::string(value),type);
 
-        return std::move(tok);
+        return makeTokenInplace(value, type);
+    }
+    // Invalid tokens carry the offending character as their (non-negative) type
+    VToken makeInvalidToken(char ch)
+    {
+        return makeTokenInplace(std::string_view(), (unsigned char)ch);
     }
 
-    std::unique_ptr<VToken> getToken()
+    // Lexes the rest of the source into `table`, which always ends with a tok_eof. Lexing stops at
+    // the first invalid token, the parser reports it and nothing after it is read
+    void tokenize(VTokenTable& table)
     {
-        while(isspace(this->cur))
+        table.reset(code, start);
+        table.reserve(len/4+1); // rough guess, most tokens are a few characters plus a space
+
+        VToken tok;
+        do
         {
-            if(this->cur=='\n' || this->cur=='\r')
-            {
-                ++this->line;
-                this->charpos=0;
-            }
-            else
-            {
-                
-                ++this->charpos;
-            }
-            
-            advanceNext();
-        }
+            tok=getToken();
+            table.push(tok);
+        } while(tok.type!=tok_eof && !tok.invalid);
+
+        if(tok.invalid)
+            table.push(makeTokenInplace(std::string_view(), tok_eof));
+    }
+
+    VToken getToken()
+    {
+        skipWhitespace();
+        this->tok_start=(this->cur==EOF) ? this->len : this->indx;
         // Checks
         if(isalpha(this->cur) || this->cur=='_')
         {
@@ -236,91 +313,86 @@ public:
 
         switch(this->cur)
         {
-            case ';': return makeToken(";",tok_semicol);
+            case ';': return makeToken(tok_semicol);
 
-            case '{': return makeToken("{",tok_lbrace);
-            case '}': return makeToken("}",tok_rbrace);
-            case '[': return makeToken("[",tok_lbrack);
-            case ']': return makeToken("]",tok_rbrack);
-            case '(': return makeToken("(",tok_lparen);
-            case ')': return makeToken(")",tok_rparen);
-            case ':': return makeToken(":",tok_colon);
-            case ',': return makeToken(",",tok_comma);
+            case '{': return makeToken(tok_lbrace);
+            case '}': return makeToken(tok_rbrace);
+            case '[': return makeToken(tok_lbrack);
+            case ']': return makeToken(tok_rbrack);
+            case '(': return makeToken(tok_lparen);
+            case ')': return makeToken(tok_rparen);
+            case ':': return makeToken(tok_colon);
+            case ',': return makeToken(tok_comma);
 
             case '=': {
-                if(peek=='=') return makeToken("==",tok_dequal,1);
-                return makeToken("=",tok_equal);
+                if(peek=='=') return makeToken(tok_dequal,1);
+                return makeToken(tok_equal);
             }
 
             case '+': {
-                if(peek=='+') return makeToken("++",tok_incr,1);
-                else if(peek=='=') return makeToken("+=",tok_pluseq,1);
-                return makeToken("+",tok_plus);
+                if(peek=='+') return makeToken(tok_incr,1);
+                else if(peek=='=') return makeToken(tok_pluseq,1);
+                return makeToken(tok_plus);
             }
             case '-': {
-                if(peek=='-') return makeToken("--",tok_decr,1);
-                else if(peek=='>') return makeToken("->",tok_rarrow,1);
-                else if(peek=='=') return makeToken("-=",tok_minuseq,1);
-                return makeToken("-",tok_minus);
+                if(peek=='-') return makeToken(tok_decr,1);
+                else if(peek=='>') return makeToken(tok_rarrow,1);
+                else if(peek=='=') return makeToken(tok_minuseq,1);
+                return makeToken(tok_minus);
             }
             case '*': {
-                if(peek=='=') return makeToken("*=",tok_muleq,1);
-                return makeToken("*",tok_mul);
+                if(peek=='=') return makeToken(tok_muleq,1);
+                return makeToken(tok_mul);
             }
             case '/': {
-                if(peek=='=') return makeToken("/=",tok_diveq,1);
-                return makeToken("/",tok_div);
+                if(peek=='=') return makeToken(tok_diveq,1);
+                return makeToken(tok_div);
             }
             case '%': {
-                if(peek=='=') return makeToken("%=",tok_modeq,1);
-                return makeToken("%",tok_mod);
+                if(peek=='=') return makeToken(tok_modeq,1);
+                return makeToken(tok_mod);
             }
 
             case '|': {
-                if(peek=='|') return makeToken("||",tok_or,1);
-                return nullptr;
+                if(peek=='|') return makeToken(tok_or,1);
+                auto tok=makeInvalidToken(this->cur);
+                advanceNext();
+                return tok;
             }
 
             case '&': {
-                if(peek=='&') return makeToken("&&",tok_and,1);
-                return makeToken("&",tok_reference);
+                if(peek=='&') return makeToken(tok_and,1);
+                return makeToken(tok_reference);
             }
 
             case '<':{
-                if(peek=='=')   return makeToken("<=",tok_lesseq,1);
-                return makeToken("<",tok_lessthan);
+                if(peek=='=')   return makeToken(tok_lesseq,1);
+                return makeToken(tok_lessthan);
             }
             case '>':{
-                if(peek=='=')   return makeToken(">=",tok_moreeq,1);
-                return makeToken(">",tok_morethan);
+                if(peek=='=')   return makeToken(tok_moreeq,1);
+                return makeToken(tok_morethan);
             }
             case '!':{
-                if(peek=='=')   return makeToken("!=",tok_nequal,1);
-                return makeToken("!",tok_not);
+                if(peek=='=')   return makeToken(tok_nequal,1);
+                return makeToken(tok_not);
             }
 
-            case '.': return makeToken(".",tok_dot);
+            case '.': return makeToken(tok_dot);
 
             case '\'': return gatherChar();
             case '"':  return gatherStr();
 
-            case EOF: return makeToken("",tok_eof);
+            case EOF: return makeTokenInplace(std::string_view(), tok_eof);
 
             default: {
-                // builder->addError<errors::lex_unknown_char>(this->code, this->cur,' ', this->line, this->charpos);
+                // builder->addError<errors::lex_unknown_char>(sources, this->cur,' ', locOf(tok_start));
+                auto tok=makeInvalidToken(this->cur);
                 advanceNext();
-                return nullptr;
+                return tok;
             }
         }
     }
-    std::unique_ptr<VToken> getToken(std::string str)
-    {
-        auto old_str=code;
-        code=str;
-        auto tkn=getToken();
-        old_str=code;
-        return std::move(tkn);
-    }
 };
 
 }
\ No newline at end of file
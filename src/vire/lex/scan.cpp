@@ -0,0 +1,140 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace vire
+{
+// Character class scanning for the lexer, each routine classifies a whole block of bytes at a
+// time (32 with AVX2, 16 with SSE2) and finishes the tail with the scalar test.
+// The ISA is picked at compile time, targets without either (wasm) only use the scalar loop.
+// Defining VIRE_SCAN_SCALAR keeps to the scalar loop on x86 too, to measure one against the other.
+namespace scan
+{
+
+#if defined(__AVX2__)
+    using block_t=__m256i;
+    constexpr std::size_t block_size=32;
+    constexpr std::uint32_t full_mask=0xFFFFFFFF;
+
+    inline block_t load(const char* p) { return _mm256_loadu_si256((const __m256i*)p); }
+    inline block_t splat(char c) { return _mm256_set1_epi8(c); }
+    inline block_t eq(block_t x, char c) { return _mm256_cmpeq_epi8(x, splat(c)); }
+    inline block_t any(block_t a, block_t b) { return _mm256_or_si256(a, b); }
+    inline std::uint32_t bits(block_t mask) { return (std::uint32_t)_mm256_movemask_epi8(mask); }
+
+    // Bytes in [lo, hi], shifted so that the range starts at -128 and compared as signed
+    inline block_t inRange(block_t x, char lo, char hi)
+    {
+        auto shifted=_mm256_add_epi8(x, splat((char)(-128-lo)));
+        return _mm256_cmpgt_epi8(splat((char)(-128+(hi-lo)+1)), shifted);
+    }
+#elif defined(__SSE2__)
+    using block_t=__m128i;
+    constexpr std::size_t block_size=16;
+    constexpr std::uint32_t full_mask=0xFFFF;
+
+    inline block_t load(const char* p) { return _mm_loadu_si128((const __m128i*)p); }
+    inline block_t splat(char c) { return _mm_set1_epi8(c); }
+    inline block_t eq(block_t x, char c) { return _mm_cmpeq_epi8(x, splat(c)); }
+    inline block_t any(block_t a, block_t b) { return _mm_or_si128(a, b); }
+    inline std::uint32_t bits(block_t mask) { return (std::uint32_t)_mm_movemask_epi8(mask); }
+
+    inline block_t inRange(block_t x, char lo, char hi)
+    {
+        auto shifted=_mm_add_epi8(x, splat((char)(-128-lo)));
+        return _mm_cmplt_epi8(shifted, splat((char)(-128+(hi-lo)+1)));
+    }
+#else
+    constexpr std::size_t block_size=0;
+#endif
+
+#if (defined(__AVX2__) || defined(__SSE2__)) && !defined(VIRE_SCAN_SCALAR)
+    #define VIRE_SCAN_BLOCKS
+#endif
+
+    // The classes only accept ASCII, which is also what the <cctype> checks did in the C locale
+    struct IdChar
+    {
+        static bool test(unsigned char c) { return (unsigned char)((c|0x20)-'a')<26 || (unsigned char)(c-'0')<10 || c=='_'; }
+#ifdef VIRE_SCAN_BLOCKS
+        static block_t block(block_t x) { return any(any(inRange(any(x, splat(0x20)), 'a', 'z'), inRange(x, '0', '9')), eq(x, '_')); }
+#endif
+    };
+    struct Digit
+    {
+        static bool test(unsigned char c) { return (unsigned char)(c-'0')<10; }
+#ifdef VIRE_SCAN_BLOCKS
+        static block_t block(block_t x) { return inRange(x, '0', '9'); }
+#endif
+    };
+    struct Space
+    {
+        static bool test(unsigned char c) { return c==' ' || (unsigned char)(c-'\t')<5; }
+#ifdef VIRE_SCAN_BLOCKS
+        static block_t block(block_t x) { return any(eq(x, ' '), inRange(x, '\t', '\r')); }
+#endif
+    };
+    struct Quote
+    {
+        static bool test(unsigned char c) { return c=='\"'; }
+#ifdef VIRE_SCAN_BLOCKS
+        static block_t block(block_t x) { return eq(x, '\"'); }
+#endif
+    };
+    // What changes the nesting of a block, quotes start literals whose braces do not count
+    struct Brace
+    {
+        static bool test(unsigned char c) { return c=='{' || c=='}' || c=='\"' || c=='\''; }
+#ifdef VIRE_SCAN_BLOCKS
+        static block_t block(block_t x) { return any(any(eq(x, '{'), eq(x, '}')), any(eq(x, '\"'), eq(x, '\''))); }
+#endif
+    };
+
+    // Number of leading characters in [p, end) that belong to `Class`
+    template<typename Class>
+    inline std::size_t span(const char* p, const char* end)
+    {
+        const char* start=p;
+#ifdef VIRE_SCAN_BLOCKS
+        while((std::size_t)(end-p)>=block_size)
+        {
+            auto mask=bits(Class::block(load(p)));
+            if(mask!=full_mask)
+                return (p-start)+std::countr_one(mask);
+            p+=block_size;
+        }
+#endif
+        while(p<end && Class::test(*p))
+            ++p;
+        return p-start;
+    }
+
+    // Offset of the first character in [p, end) that belongs to `Class`, `end-p` if there is none
+    template<typename Class>
+    inline std::size_t find(const char* p, const char* end)
+    {
+        const char* start=p;
+#ifdef VIRE_SCAN_BLOCKS
+        while((std::size_t)(end-p)>=block_size)
+        {
+            auto mask=bits(Class::block(load(p)));
+            if(mask)
+                return (p-start)+std::countr_zero(mask);
+            p+=block_size;
+        }
+#endif
+        while(p<end && !Class::test(*p))
+            ++p;
+        return p-start;
+    }
+
+}
+}
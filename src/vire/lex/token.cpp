@@ -3,46 +3,43 @@
 #include <iostream>
 #include <ostream>
 #include <string>
+#include <string_view>
 #include <memory>
+#include <type_traits>
 
 #include "token.hpp"
+#include "vire/proto/source.hpp"
+#include "vire/proto/arena.hpp"
 
 namespace vire
 {
-class VToken
+// VToken - A lexed token, `value` is a span into the lexer's source buffer (or a static string
+// for synthesized tokens), so tokens are trivially copyable and never own heap memory.
+// Line and column are not stored, they are looked up from `loc` through the SourceManager.
+// Tokens kept by the AST are allocated from the module's arena
+class VToken : public proto::ArenaNode
 {
 public:
     int type;
-    std::string value;
+    proto::SourceLocation loc;
+    std::string_view value;
     char invalid;
 
-    std::size_t line;
-    std::size_t charpos;
+    VToken()
+    : type(tok_eof), loc(), value(), invalid(0)
+    {}
+    VToken(std::string_view value, int type, proto::SourceLocation loc=proto::SourceLocation()) 
+    : value(value), type(type), loc(loc), invalid(type>=0)
+    {}
 
-    VToken(std::string const& value, int type) 
-    : value(value), type(type), line(0), charpos(0)
+    // `_name` is not copied, it must outlive the token
+    static std::unique_ptr<VToken> construct(std::string_view _name, int _type=tok_id, proto::SourceLocation _loc=proto::SourceLocation())
     {
-        if(type>=0)
-        {
-            this->invalid=1;
-        }
-    }
-    VToken(std::string const& value, int type, std::size_t line, std::size_t charpos) 
-    : value(value), type(type), line(line), charpos(charpos)
-    {
-        if(type>=0)
-        {
-            this->invalid=1;
-        }
-    }
-
-    static std::unique_ptr<VToken> construct(std::string const& _name, int _type=tok_id, std::size_t _line=0, std::size_t _charpos=0)
-    {
-        return std::make_unique<VToken>(_name, _type, _line, _charpos);
+        return std::make_unique<VToken>(_name, _type, _loc);
     }
     static std::unique_ptr<VToken> construct(VToken* token)
     {
-        return construct(token->value, token->type, token->line, token->charpos);
+        return std::make_unique<VToken>(*token);
     }
 
     inline friend std::ostream& operator<<(std::ostream& os, const VToken& tok);
@@ -50,6 +47,8 @@ public:
     inline friend bool operator==(const VToken& lhs, const token& rhs);
 };
 
+static_assert(std::is_trivially_copyable_v<VToken>, "VToken must stay trivially copyable");
+
 inline bool operator==(const VToken& lhs, const VToken& rhs)
 {
     return lhs.type==rhs.type;
@@ -155,6 +154,8 @@ static const char* tokToStr(int tok)
 
         case tok_as: return "tok_as";
 
+        case tok_import: return "tok_import";
+
         default: return "unknown";
     }
 }
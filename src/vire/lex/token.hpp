@@ -99,6 +99,8 @@ enum token
     tok_constructor=-68,
 
     tok_as=-69,
+
+    tok_import=-70,
 };
 
 static const char* tokToStr(int tok);
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <string_view>
+
+#include "token.hpp"
+#include "token.cpp"
+
+namespace vire
+{
+// VTokenTable - A whole module's worth of tokens, stored as a struct of arrays so the parser
+// can walk (and look ahead through) them by index. Token text is kept as an offset/length pair
+// into the source buffer, which must outlive the table. Offsets are relative to `start`, the
+// location of the buffer's first character, so they double as the tokens' source locations
+// (a token's location is where its text starts)
+class VTokenTable
+{
+    std::string_view source;
+    proto::SourceLocation start;
+
+    std::vector<int> kinds;
+    std::vector<std::uint32_t> offsets;
+    std::vector<std::uint32_t> lengths;
+public:
+    VTokenTable() {}
+    VTokenTable(std::string_view source, proto::SourceLocation start) : source(source), start(start) {}
+
+    void reset(std::string_view source, proto::SourceLocation start)
+    {
+        this->source=source;
+        this->start=start;
+        kinds.clear();
+        offsets.clear();
+        lengths.clear();
+    }
+
+    void reserve(std::size_t n)
+    {
+        kinds.reserve(n);
+        offsets.reserve(n);
+        lengths.reserve(n);
+    }
+
+    void push(VToken const& tok)
+    {
+        kinds.push_back(tok.type);
+        offsets.push_back(tok.loc.offset-start.offset);
+        lengths.push_back(tok.value.size());
+    }
+
+    std::size_t size() const { return kinds.size(); }
+    bool empty() const { return kinds.empty(); }
+
+    int kind(std::size_t indx) const { return kinds[indx]; }
+    proto::SourceLocation loc(std::size_t indx) const { return start.getOffset(offsets[indx]); }
+    std::string_view text(std::size_t indx) const { return source.substr(offsets[indx], lengths[indx]); }
+
+    // Rebuilds the token at `indx`, this is just a few loads since VToken is trivially copyable
+    VToken get(std::size_t indx) const
+    {
+        return VToken(text(indx), kinds[indx], loc(indx));
+    }
+};
+
+}
@@ -6,6 +6,9 @@ add_library(
 
     ${SRC_DIR}/src/vire/parse/parser.hpp
     ${SRC_DIR}/src/vire/parse/parser.cpp
+
+    ${SRC_DIR}/src/vire/parse/serialize.hpp
+    ${SRC_DIR}/src/vire/parse/serialize.cpp
 )
 
 target_link_libraries(VIRELANG PRIVATE vire-parser)
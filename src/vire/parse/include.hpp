@@ -1,4 +1,5 @@
 #pragma once
 
 #include "parser.hpp"
-#include "keyword_hash.hpp"
\ No newline at end of file
+#include "keyword_hash.hpp"
+#include "serialize.hpp"
\ No newline at end of file
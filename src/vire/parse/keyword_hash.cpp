@@ -18,7 +18,7 @@ Perfect_Hash::hash (const char *str, size_t len)
       42, 42, 42, 42, 42, 42, 42, 42, 42, 42,
       42, 42, 42, 42, 42, 42, 42,  5, 30,  0,
       25,  0,  5, 42, 42,  0, 42, 42, 10, 42,
-       0, 10, 10, 42,  5, 15, 10, 10, 30, 25,
+       0, 10, 19, 42,  5, 15, 10, 10, 30, 25,
       42,  5, 42, 42, 42, 42, 42, 42, 42, 42,
       42, 42, 42, 42, 42, 42, 42, 42, 42, 42,
       42, 42, 42, 42, 42, 42, 42, 42, 42, 42,
@@ -91,8 +91,8 @@ static const struct KeywordCode wordlist[] =
     {"let", KeywordTokenCode::kw_let},
 #line 30 "keywords.gperf"
     {"true", KeywordTokenCode::kw_true},
-#line 45 "keywords.gperf"
-    {"proto", KeywordTokenCode::kw_proto},
+#line 51 "keywords.gperf"
+    {"import", KeywordTokenCode::kw_import},
 #line 37 "keywords.gperf"
     {"struct", KeywordTokenCode::kw_struct},
 #line 33 "keywords.gperf"
@@ -103,6 +103,8 @@ static const struct KeywordCode wordlist[] =
     {"unsafe", KeywordTokenCode::kw_unsafe},
 #line 23 "keywords.gperf"
     {"and", KeywordTokenCode::kw_and},
+#line 45 "keywords.gperf"
+    {"proto", KeywordTokenCode::kw_proto},
 #line 42 "keywords.gperf"
     {"break", KeywordTokenCode::kw_break},
 #line 27 "keywords.gperf"
@@ -115,7 +117,7 @@ static const signed char lookup[] =
   {
     -1, -1,  0, -1, -1,  1,  2,  3,  4,  5,  6,  7,  8,  9,
     -1, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, -1,
-    22, -1, 23, 24, -1, 25, -1, 26, -1, -1, 27, -1, -1, 28
+    22, -1, 23, 24, -1, 25, 26, 27, -1, -1, 28, -1, -1, 29
   };
 
 int fast_compare( const char *ptr0, const char *ptr1){
@@ -137,7 +139,7 @@ Perfect_Hash::hash_keyword_to_token (const char *str, size_t len)
             {
               const char *s = wordlist[index].Keyword;
 
-              if (*str == *s && !strcmp (str + 1, s + 1))
+              if (*str == *s && !strncmp (str + 1, s + 1, len - 1) && s[len] == '\0')
                 return &wordlist[index];
             }
         }
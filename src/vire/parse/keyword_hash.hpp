@@ -1,5 +1,5 @@
 /* C++ code produced by gperf version 3.1 */
-/* Command-line: gperf -CGD -L C++ -N hash_keyword_to_token -K Keyword -t keywords.gperf  */
+/* Command-line: gperf -CGDc -L C++ -N hash_keyword_to_token -K Keyword -t keywords.gperf  */
 /* Computed positions: -k'1,3' */
 
 #if !((' ' == 32) && ('!' == 33) && ('"' == 34) && ('#' == 35) \
@@ -49,7 +49,7 @@ struct KeywordCode
     int KeywordCode;
 };
 
-#define TOTAL_KEYWORDS 29
+#define TOTAL_KEYWORDS 30
 #define MIN_WORD_LENGTH 2
 #define MAX_WORD_LENGTH 11
 #define MIN_HASH_VALUE 2
@@ -64,6 +64,6 @@ public:
   static const struct KeywordCode *hash_keyword_to_token (const char *str, size_t len);
 };
 
-#line 51 "keywords.gperf"
+#line 52 "keywords.gperf"
 
 }
\ No newline at end of file
@@ -39,6 +39,7 @@ struct KeywordTokenCode
         kw_except=tok_except,
         kw_unsafe=tok_unsafe,
         kw_constructor=tok_constructor,
+        kw_import=tok_import,
     };
 };
 
@@ -1,15 +1,30 @@
 #include "parser.hpp"
 
-#define ERR_OUT stdout
+#include <cstdio>
+#include <iostream>
+#include <ostream>
 
 namespace vire
 {
+    // Through std::cout like the analyzer's and compiler's diagnostics, so whoever takes those takes these too
+    static void printError(const char* str, std::va_list args)
+    {
+        std::va_list copy;
+        va_copy(copy, args);
+        int size=std::vsnprintf(nullptr, 0, str, copy);
+        va_end(copy);
+
+        std::string message(size>0?size:0, '\0');
+        if(size>0)
+            std::vsnprintf(message.data(), size+1, str, args);
+        std::cout << "Parse Error: " << message;
+    }
+
     std::unique_ptr<ExprAST> VParser::LogError(const char* str,...)
     {
         std::va_list args;
         va_start(args,str);
-        fprintf(ERR_OUT,"Parse Error: ");
-        std::vfprintf(ERR_OUT,str,args);
+        printError(str, args);
         va_end(args);
         return nullptr;
     }
@@ -17,8 +32,7 @@ namespace vire
     {
         std::va_list args;
         va_start(args,str);
-        fprintf(ERR_OUT,"Parse Error: ");
-        std::vfprintf(ERR_OUT,str,args);
+        printError(str, args);
         va_end(args);
         return nullptr;
     }
@@ -26,8 +40,7 @@ namespace vire
     {
         std::va_list args;
         va_start(args,str);
-        fprintf(ERR_OUT,"Parse Error: ");
-        std::vfprintf(ERR_OUT,str,args);
+        printError(str, args);
         va_end(args);
         return nullptr;
     }
@@ -35,8 +48,7 @@ namespace vire
     {
         std::va_list args;
         va_start(args,str);
-        fprintf(ERR_OUT,"Parse Error: ");
-        std::vfprintf(ERR_OUT,str,args);
+        printError(str, args);
         va_end(args);
         return nullptr;
     }
@@ -44,8 +56,7 @@ namespace vire
     {
         std::va_list args;
         va_start(args,str);
-        fprintf(ERR_OUT,"Parse Error: ");
-        std::vfprintf(ERR_OUT,str,args);
+        printError(str, args);
         va_end(args);
         return std::vector<std::unique_ptr<ExprAST>>();
     }
@@ -53,24 +64,23 @@ namespace vire
     {
         std::va_list args;
         va_start(args,str);
-        fprintf(ERR_OUT,"Parse Error: ");
-        std::vfprintf(ERR_OUT,str,args);
+        printError(str, args);
         va_end(args);
         return std::pair<std::unordered_map<proto::IName, std::unique_ptr<ExprAST>>, std::unique_ptr<FunctionAST>>();
     }
 
     void VParser::getNextToken(bool first_token)
     {
-        if(current_token && current_token->type==tok_eof && !first_token)
+        if(current_token.type==tok_eof && !first_token)
         {
             LogError("End of file\n");
             return;
         }
 
-        current_token.reset();
-        current_token=lexer->getToken();
+        if(!first_token) ++tok_indx;
+        current_token=tokenAt(tok_indx);
 
-        if(!current_token)
+        if(current_token.invalid)
         {
             LogError("Invalid Token Detected\n");
             getNextToken();
@@ -78,10 +88,10 @@ namespace vire
     }
     void VParser::getNextToken(int toktype)
     {  
-        if(current_token->type!=toktype)
+        if(current_token.type!=toktype)
         {
-            LogError("Current token type %s does not match type %s, Current token: `%s`\n",
-            tokToStr(current_token->type), tokToStr(toktype), current_token->value.c_str());
+            LogError("Current token type %s does not match type %s, Current token: `%.*s`\n",
+            tokToStr(current_token.type), tokToStr(toktype), (int)current_token.value.size(), current_token.value.data());
             parse_success=false;
         }
         
@@ -89,41 +99,96 @@ namespace vire
     }
     std::unique_ptr<VToken> VParser::copyCurrentToken()
     {
-        return std::make_unique<VToken>(current_token->value, current_token->type, current_token->line, current_token->charpos);
+        return std::make_unique<VToken>(current_token);
+    }
+    void VParser::fillTokens(std::size_t indx)
+    {
+        while(tokens.size()<=indx && (tokens.empty() || tokens.kind(tokens.size()-1)!=tok_eof))
+            tokens.push(lexer->getToken());
+    }
+    VToken VParser::tokenAt(std::size_t indx)
+    {
+        fillTokens(indx);
+        
+        // Everything past the end reads as the trailing eof
+        if(indx>=tokens.size())
+            indx=tokens.size()-1;
+        
+        return tokens.get(indx);
+    }
+    VToken VParser::peekToken(std::size_t k)
+    {
+        return tokenAt(tok_indx+k);
+    }
+    int VParser::peekType(std::size_t k)
+    {
+        fillTokens(tok_indx+k);
+        
+        if(tok_indx+k>=tokens.size())
+            return tok_eof;
+        
+        return tokens.kind(tok_indx+k);
+    }
+    // Moves past the block the current `{` opens, only what a lookahead already read is lexed
+    void VParser::skipBlock()
+    {
+        unsigned int depth=0;
+        for(std::size_t indx=tok_indx; indx<tokens.size(); ++indx)
+        {
+            int kind=tokens.kind(indx);
+            if(kind==tok_lbrace)
+                ++depth;
+            else if(kind==tok_rbrace && --depth==0)
+            {
+                tok_indx=indx;
+                current_token=tokens.get(indx);
+                getNextToken(tok_rbrace);
+                return;
+            }
+            else if(kind==tok_eof)
+                break;
+        }
+
+        // The lexer stops on the closing `}`, or the end of the source which getNextToken reports
+        if(tokens.kind(tokens.size()-1)!=tok_eof)
+            lexer->skipBlock(depth);
+        tok_indx=tokens.size()-1;
+        getNextToken();
+        getNextToken(tok_rbrace);
     }
 
-    std::unique_ptr<types::Base> VParser::ParseTypeIdentifier()
+    types::Base* VParser::ParseTypeIdentifier()
     {
-        auto main_type_tok=copyCurrentToken();
-        auto main_type=types::construct(main_type_tok->value);
+        auto main_type_tok=current_token;
+        auto* main_type=types::construct(std::string(main_type_tok.value));
         getNextToken(tok_id);
 
-        while(current_token->type==tok_lbrack)
+        // A plain (non array) unresolved type keeps its prefixed name until the analyzer resolves it
+        if(current_token.type!=tok_lbrack && main_type->getType() == types::EType::Void)
+        {
+            main_type=types::getContext().getVoid(proto::IName(std::string(main_type_tok.value)).get());
+        }
+
+        while(current_token.type==tok_lbrack)
         {
             getNextToken();
-            auto arr_num=std::stoi(current_token->value);
+            auto arr_num=std::stoi(std::string(current_token.value));
             getNextToken(tok_int);
 
-            auto main_type_child=std::move(main_type);
-            main_type=std::make_unique<types::Array>(std::move(main_type_child), arr_num);
+            main_type=types::getContext().getArray(main_type, arr_num);
             getNextToken(tok_rbrack);
         }
 
-        if(main_type->getType() == types::EType::Void)
-        {
-            ((types::Void*)main_type.get())->setName(proto::IName(main_type_tok->value).get());
-        }
-
-        return std::move(main_type);
+        return main_type;
     }
     std::vector<std::unique_ptr<ExprAST>> VParser::ParseBlock()
     {
         getNextToken(tok_lbrace); // consume '{'
 
         std::vector<std::unique_ptr<ExprAST>> stms;
-        while(current_token->type!=tok_rbrace)
+        while(current_token.type!=tok_rbrace)
         {
-            if(current_token->type==tok_eof)
+            if(current_token.type==tok_eof)
             {
                 parse_success=false;
                 return LogErrorVP("Expected '}', found end of file");
@@ -132,7 +197,7 @@ namespace vire
             auto stm=ParsePrimary();
             while(!stm)
             {
-                if(current_token->type==tok_eof)
+                if(current_token.type==tok_eof)
                 {
                     parse_success=false;
                     return LogErrorVP("Expected statement, found end of file");
@@ -164,12 +229,12 @@ namespace vire
 
     std::unique_ptr<ExprAST> VParser::ParsePrimary()
     {
-        switch(current_token->type)
+        switch(current_token.type)
         {
             default:
             {
                 parse_success=false;
-                return LogError("Unknown token `%s` found when expecting statement, value: %s\n",tokToStr(current_token->type),current_token->value.c_str());
+                return LogError("Unknown token `%s` found when expecting statement, value: %.*s\n",tokToStr(current_token.type),(int)current_token.value.size(),current_token.value.data());
             }
             
             case tok_id: return ParseIdExpr();
@@ -225,26 +290,26 @@ namespace vire
 
     std::unique_ptr<ExprAST> VParser::ParseIdExpr(bool include_assign)
     {
-        auto id_name=copyCurrentToken();
+        auto id_name=current_token;
 
         getNextToken(tok_id);
         
         std::unique_ptr<ExprAST> expr;
-        if(current_token->type!=tok_lparen) // if it is not a function call
+        if(current_token.type!=tok_lparen) // if it is not a function call
         {
             expr=std::make_unique<VariableExprAST>(std::move(id_name));
             
-            while(current_token->type==tok_dot || current_token->type==tok_lbrack)
+            while(current_token.type==tok_dot || current_token.type==tok_lbrack)
             {
-                if(current_token->type==tok_dot)
+                if(current_token.type==tok_dot)
                 {
                     expr=ParseClassAccess(std::move(expr));
                 }
                 
-                if(current_token->type==tok_lbrack)
+                if(current_token.type==tok_lbrack)
                 {
                     std::vector<std::unique_ptr<ExprAST>> indices;
-                    while(current_token->type == tok_lbrack)
+                    while(current_token.type == tok_lbrack)
                     {
                         getNextToken();
                         auto index=ParseExpression();
@@ -263,24 +328,24 @@ namespace vire
 
             if(include_assign)
             {
-                if(current_token->type==tok_equal)
+                if(current_token.type==tok_equal)
                 {
                     return ParseVariableAssign(std::move(expr));
                 }
-                else if(current_token->type==tok_pluseq
-                    || current_token->type==tok_minuseq
-                    || current_token->type==tok_muleq
-                    || current_token->type==tok_diveq
-                    || current_token->type==tok_modeq
+                else if(current_token.type==tok_pluseq
+                    || current_token.type==tok_minuseq
+                    || current_token.type==tok_muleq
+                    || current_token.type==tok_diveq
+                    || current_token.type==tok_modeq
                 )
                 {
                     return ParseShorthandVariableAssign(std::move(expr));
                 }
             }
             
-            if(current_token->type==tok_incr || current_token->type==tok_decr)
+            if(current_token.type==tok_incr || current_token.type==tok_decr)
             {
-                bool is_increment=(current_token->type==tok_incr);
+                bool is_increment=(current_token.type==tok_incr);
                 getNextToken();
                 expr=std::make_unique<IncrementDecrementAST>(std::move(expr), false, is_increment);
             }
@@ -291,7 +356,7 @@ namespace vire
         getNextToken(tok_lparen); // consume '('
 
         std::vector<std::unique_ptr<ExprAST>> args;
-        if(current_token->type != tok_rparen)
+        if(current_token.type != tok_rparen)
         {
             while(1)
             {
@@ -302,10 +367,10 @@ namespace vire
                 else
                     return nullptr;
                 
-                if(current_token->type==tok_rparen)
+                if(current_token.type==tok_rparen)
                     break;
                 
-                if(current_token->type!=tok_comma)
+                if(current_token.type!=tok_comma)
                     return LogError("Expected ')' or ',' in function call arg list");
                 
                 getNextToken(tok_comma);
@@ -314,13 +379,15 @@ namespace vire
 
         getNextToken(tok_rparen); // consume ')'
 
+        if(lazy_bodies)
+            called.push_back(id_name.value);
         expr=std::make_unique<CallExprAST>(std::move(id_name),std::move(args));
         
         return std::move(expr);
     }
     std::unique_ptr<ExprAST> VParser::ParseIncrementDecrementExpr()
     {
-        bool is_increment=(current_token->type==tok_incr);
+        bool is_increment=(current_token.type==tok_incr);
         getNextToken();
 
         auto expr=ParsePrimary();
@@ -330,24 +397,24 @@ namespace vire
 
     std::unique_ptr<ExprAST> VParser::ParseNumberExpr()
     {
-        auto token=copyCurrentToken();
+        auto token=current_token;
 
-        if(token->type==tok_int)
+        if(token.type==tok_int)
         {
-            int num=std::stoi(token->value);
+            int num=std::stoi(std::string(token.value));
             auto result=std::make_unique<IntExprAST>(num, std::move(token));
             getNextToken(tok_int);
             return std::move(result);
         }
-        else if(token->type==tok_float)
+        else if(token.type==tok_float)
         {
-            auto result=std::make_unique<FloatExprAST>(std::stof(current_token->value),std::move(token));
+            auto result=std::make_unique<FloatExprAST>(std::stof(std::string(current_token.value)),std::move(token));
             getNextToken(tok_float);
             return std::move(result);
         }
-        else if(token->type==tok_double)
+        else if(token.type==tok_double)
         {
-            auto result=std::make_unique<DoubleExprAST>(std::stod(current_token->value),std::move(token));
+            auto result=std::make_unique<DoubleExprAST>(std::stod(std::string(current_token.value)),std::move(token));
             getNextToken(tok_double);
             return std::move(result);
         }
@@ -356,24 +423,24 @@ namespace vire
     }
     std::unique_ptr<ExprAST> VParser::ParseStrExpr()
     {
-        auto token=copyCurrentToken();
-        if(current_token->type==tok_char)
+        auto token=current_token;
+        if(current_token.type==tok_char)
         {
-            auto result=std::make_unique<CharExprAST>(current_token->value.at(0),std::move(token));
+            auto result=std::make_unique<CharExprAST>(current_token.value.at(0),std::move(token));
             getNextToken(tok_char);
             return std::move(result);
         }
         else // assume the tok is tok_str
         {
-            auto result=std::make_unique<StrExprAST>(std::string(current_token->value),std::move(token));
+            auto result=std::make_unique<StrExprAST>(std::string(current_token.value),std::move(token));
             getNextToken(tok_str);
             return result;
         }
     }
     std::unique_ptr<ExprAST> VParser::ParseBoolExpr()
     {
-        auto token=copyCurrentToken();
-        if(current_token->type==tok_true)
+        auto token=current_token;
+        if(current_token.type==tok_true)
         {
             getNextToken();
             return std::make_unique<BoolExprAST>(true, std::move(token));
@@ -390,17 +457,17 @@ namespace vire
 
         std::vector<std::unique_ptr<ExprAST>> Elements;
         
-        if(current_token->type!=tok_rbrack)
+        if(current_token.type!=tok_rbrack)
         {
             while(1)
             {
                 auto elm=ParseExpression();
                 Elements.push_back(std::move(elm));
 
-                if(current_token->type==tok_rbrack)
+                if(current_token.type==tok_rbrack)
                     break;
                 
-                if(current_token->type!=tok_comma)
+                if(current_token.type!=tok_comma)
                     return LogError("Expected ']' or ',' in array def");
                 
                 getNextToken(tok_comma);
@@ -418,7 +485,7 @@ namespace vire
         if(!stm)
             return nullptr;
 
-        if(current_token->type==tok_as)
+        if(current_token.type==tok_as)
         {
             getNextToken();
             auto type=ParseTypeIdentifier();
@@ -429,7 +496,7 @@ namespace vire
             stm=ParseBinopExpr(0 , std::move(stm));
         }
         
-        if(current_token->type!=tok_rparen)
+        if(current_token.type!=tok_rparen)
             return LogError("Expected ')' left-parenthesis");
         
         getNextToken(tok_rparen); // consume ')'
@@ -440,11 +507,11 @@ namespace vire
     {
         while(1)
         {  
-            int prec=config->getBinopPrecedence(current_token->value);
+            int prec=config->getBinopPrecedence(current_token.value);
  
-            if(prec<ExprPrec && !(current_token->type==tok_and || current_token->type==tok_or))
+            if(prec<ExprPrec && !(current_token.type==tok_and || current_token.type==tok_or))
                 return LHS;
-            else if(current_token->type==tok_and || current_token->type==tok_or)
+            else if(current_token.type==tok_and || current_token.type==tok_or)
             {
                 auto binop=copyCurrentToken();
                 getNextToken();
@@ -459,7 +526,7 @@ namespace vire
             if(!RHS)
                 return nullptr;
             
-            int nextprec=config->getBinopPrecedence(current_token->value.c_str());
+            int nextprec=config->getBinopPrecedence(current_token.value);
             if(prec<nextprec)
             {
                 RHS=ParseBinopExpr(prec+1,std::move(RHS));
@@ -468,7 +535,7 @@ namespace vire
             }
 
             LHS=std::make_unique<BinaryExprAST>(std::move(binop), std::move(LHS), std::move(RHS));
-            if(current_token->type==tok_eof)
+            if(current_token.type==tok_eof)
             {
                 return std::move(LHS);
             }
@@ -479,9 +546,9 @@ namespace vire
     { 
         bool isconst=false;
         bool islet=true;
-        if(current_token->type==tok_const)
+        if(current_token.type==tok_const)
             isconst=true;
-        if(current_token->type==tok_let)
+        if(current_token.type==tok_let)
             islet=true;
         
         if(!isconst && !islet) 
@@ -489,59 +556,39 @@ namespace vire
         else
             getNextToken(); // consume `let` / `const`
 
-        auto var_name=copyCurrentToken();
+        auto var_name=current_token;
         getNextToken(tok_id);
 
-        bool is_array=false;
-        std::unique_ptr<types::Base> type;
-        types::Array* type_ref;
-
-        if(current_token->type==tok_lbrack)
+        // Types are built bottom up, so the dimensions are collected before the element type
+        std::vector<unsigned int> dims;
+        while(current_token.type==tok_lbrack)
         {
-            is_array=true;
             getNextToken(tok_lbrack);
-            type=std::make_unique<types::Array>(std::make_unique<types::Void>(), std::stoi(current_token->value));
-            type_ref=(types::Array*)type.get();
+            dims.push_back(std::stoi(std::string(current_token.value)));
             getNextToken(tok_int);
             getNextToken(tok_rbrack);
-            while(current_token->type==tok_lbrack)
-            {
-                getNextToken(tok_lbrack);
-                type=std::make_unique<types::Array>(std::move(type), std::stoi(current_token->value));
-                getNextToken(tok_int);
-                getNextToken(tok_rbrack);
-            }
         }
+        bool is_array=!dims.empty();
 
-        if(is_array)
+        types::Base* type;
+        if(current_token.type==tok_colon)
         {
-            if(current_token->type==tok_colon)
-            {
-                getNextToken(tok_colon);
-                type_ref->setChild(ParseTypeIdentifier());
-            }
-            else
-            {
-                // Automatic type inference
-                type_ref->setChild(types::construct("void"));
-            }
+            getNextToken(tok_colon);
+            type=ParseTypeIdentifier();
         }
         else
         {
-            if(current_token->type==tok_colon)
-            {
-                getNextToken(tok_colon);
-                type=ParseTypeIdentifier();
-            }
-            else
-            {
-                // Automatic type inference
-                type=types::construct("void");
-            }
+            // Automatic type inference
+            type=types::construct("void");
+        }
+
+        for(auto dim : dims)
+        {
+            type=types::getContext().getArray(type, dim);
         }
 
         std::unique_ptr<ExprAST> value=nullptr;
-        if(current_token->type==tok_equal)
+        if(current_token.type==tok_equal)
         {
             getNextToken(tok_equal);
             if(is_array)
@@ -553,16 +600,16 @@ namespace vire
         if(is_array && value!=nullptr)
         {
             auto* vtype=(types::Array*)value->getType();
-            auto* stype=(types::Array*)type.get();
+            auto* stype=(types::Array*)type;
             
             if(vtype->getLength() <= stype->getLength())
             {
-                vtype->setLength(stype->getLength());
+                value->setType(types::getContext().getArray(vtype->getChild(), stype->getLength()));
             }
 
         }
 
-        return std::make_unique<VariableDefAST>(std::move(var_name), std::move(type), std::move(value), isconst, islet);
+        return std::make_unique<VariableDefAST>(std::move(var_name), type, std::move(value), isconst, islet);
     }
     std::unique_ptr<ExprAST> VParser::ParseVariableAssign(std::unique_ptr<ExprAST> expr)
     {
@@ -573,38 +620,38 @@ namespace vire
     }
     std::unique_ptr<ExprAST> VParser::ParseShorthandVariableAssign(std::unique_ptr<ExprAST> var)
     {
-        auto token=copyCurrentToken();
+        auto token=current_token;
         getNextToken();
 
         auto expr=ParseExpression();
 
         std::unique_ptr<VToken> sym;
 
-        switch(token->type)
+        switch(token.type)
         {
             case tok_pluseq: 
             {
-                sym=VToken::construct("+", tok_plus, token->line, token->charpos);
+                sym=VToken::construct("+", tok_plus, token.loc);
                 break;
             }
             case tok_minuseq:
             {
-                sym=VToken::construct("-", tok_minus, token->line, token->charpos);
+                sym=VToken::construct("-", tok_minus, token.loc);
                 break;
             }
             case tok_muleq:
             {
-                sym=VToken::construct("*", tok_mul, token->line, token->charpos);
+                sym=VToken::construct("*", tok_mul, token.loc);
                 break;
             }
             case tok_diveq:
             {
-                sym=VToken::construct("/", tok_div, token->line, token->charpos);
+                sym=VToken::construct("/", tok_div, token.loc);
                 break;
             }
             case tok_modeq:
             {
-                sym=VToken::construct("%", tok_mod, token->line, token->charpos);
+                sym=VToken::construct("%", tok_mod, token.loc);
                 break;
             }
 
@@ -648,13 +695,13 @@ namespace vire
     std::unique_ptr<ExprAST> VParser::ParseBreakContinue()
     {
         bool is_break=1;
-        if(current_token->type==tok_continue) is_break=0;
+        if(current_token.type==tok_continue) is_break=0;
 
         getNextToken();
 
         bool has_stm=0;
         std::unique_ptr<ExprAST> stm;
-        if(current_token->type!=tok_semicol)
+        if(current_token.type!=tok_semicol)
         {
             has_stm=1;
             stm=ParsePrimary();
@@ -674,22 +721,22 @@ namespace vire
 
     std::unique_ptr<PrototypeAST> VParser::ParsePrototype()
     {
-        if(current_token->type!=tok_id)
+        if(current_token.type!=tok_id)
             return LogErrorP("Expected function name in prototype");
         
         std::unique_ptr<VToken> fn_name=copyCurrentToken();
         getNextToken(tok_id);
 
-        if(current_token->type!=tok_lparen)
+        if(current_token.type!=tok_lparen)
             return LogErrorP("Expected '(' in prototype after name");
         getNextToken(); // consume '('
 
         std::vector<std::unique_ptr<VariableDefAST>> args;
-        while(current_token->type==tok_id)
+        while(current_token.type==tok_id)
         {
-            std::unique_ptr<VToken> var_name=copyCurrentToken();
+            VToken var_name=current_token;
             getNextToken(tok_id); // consume id
-            if(current_token->type!=tok_colon) 
+            if(current_token.type!=tok_colon) 
                 return LogErrorP("Expected ':' for type specifier after arg name");
             getNextToken(tok_colon); // consume colon
 
@@ -698,7 +745,7 @@ namespace vire
             
             args.push_back(std::move(var));
 
-            if(current_token->type!=tok_comma)
+            if(current_token.type!=tok_comma)
             {
                 break;
             }
@@ -707,8 +754,8 @@ namespace vire
 
         getNextToken(tok_rparen);
 
-        std::unique_ptr<types::Base> return_type;
-        if(current_token->type==tok_colon || current_token->type==tok_returns)
+        types::Base* return_type;
+        if(current_token.type==tok_colon || current_token.type==tok_returns)
         {
             getNextToken();
             return_type=ParseTypeIdentifier();
@@ -718,7 +765,7 @@ namespace vire
             return_type=types::construct(types::EType::Void);
         }
 
-        return std::make_unique<PrototypeAST>(std::move(fn_name), std::move(args), std::move(return_type));
+        return std::make_unique<PrototypeAST>(std::move(fn_name), std::move(args), return_type);
     }
     std::unique_ptr<PrototypeAST> VParser::ParseProto()
     {
@@ -733,6 +780,7 @@ namespace vire
     }
     std::unique_ptr<FunctionAST> VParser::ParseFunction()
     {
+        auto begin=current_token.loc;
         getNextToken(tok_func); // eat `func`
 
         auto proto=ParsePrototype();
@@ -742,7 +790,86 @@ namespace vire
     
         auto stms=ParseBlock();
         
-        return std::make_unique<FunctionAST>(std::move(proto), std::move(stms));
+        auto func=std::make_unique<FunctionAST>(std::move(proto), std::move(stms));
+        func->setSourceRange(begin, current_token.loc);
+        return func;
+    }
+    // ParseFunction() up to the body, which is skipped. The function goes in `slot` once its body is parsed
+    void VParser::DeferFunction(std::size_t slot)
+    {
+        auto begin=current_token.loc;
+        getNextToken(tok_func); // eat `func`
+
+        auto proto=ParsePrototype();
+        if(!proto)  return;
+
+        if(current_token.type!=tok_lbrace)
+        {
+            getNextToken(tok_lbrace); // reports it
+            return;
+        }
+
+        std::size_t offset=current_token.loc.offset-lexer->getStart().offset;
+        skipBlock();
+        deferred_bodies.push_back(DeferredBody{std::move(proto), begin, offset, slot});
+    }
+    // Parses the skipped bodies that are needed, see setLazyBodies(), and drops the other functions
+    void VParser::ParseNeededBodies(std::vector<std::unique_ptr<FunctionBaseAST>>& functions)
+    {
+        if(deferred_bodies.empty())
+            return;
+
+        std::unordered_multimap<std::string_view, std::size_t> by_name;
+        by_name.reserve(deferred_bodies.size());
+        for(std::size_t i=0; i<deferred_bodies.size(); ++i)
+            by_name.emplace(deferred_bodies[i].proto->getNameToken()->value, i);
+
+        // Each body is lexed on its own from where it starts, the module's tokens are no longer needed
+        auto parseBody=[&](DeferredBody& body)
+        {
+            tokens.reset(lexer->code, lexer->getStart());
+            lexer->seek(body.offset);
+            tok_indx=0;
+            getNextToken(true);
+
+            current_func_name=&body.proto->getIName();
+            auto stms=ParseBlock();
+
+            auto func=std::make_unique<FunctionAST>(std::move(body.proto), std::move(stms));
+            func->setSourceRange(body.begin, current_token.loc);
+            functions[body.slot]=std::move(func);
+        };
+        auto need=[&](std::string_view name)
+        {
+            auto range=by_name.equal_range(name);
+            for(auto it=range.first; it!=range.second; ++it)
+            {
+                auto& body=deferred_bodies[it->second];
+                if(body.proto)
+                    parseBody(body);
+            }
+        };
+
+        // `called` starts with what the top-level statements call, which is all a script without a
+        // `main` runs. Parsing a body adds what it calls
+        need("main");
+        for(std::size_t i=0; i<called.size(); ++i)
+            need(called[i]);
+
+        // What nothing needs is left out, keeping the order of the rest
+        std::size_t kept=0;
+        std::size_t next_deferred=0;
+        for(std::size_t slot=0; slot<functions.size(); ++slot)
+        {
+            bool was_deferred=next_deferred<deferred_bodies.size() && deferred_bodies[next_deferred].slot==slot;
+            if(was_deferred)
+                ++next_deferred;
+            if(was_deferred && !functions[slot])
+                continue;
+            functions[kept++]=std::move(functions[slot]);
+        }
+        functions.resize(kept);
+        deferred_bodies.clear();
     }
     std::unique_ptr<ExprAST> VParser::ParseReturn()
     {
@@ -760,10 +887,10 @@ namespace vire
         auto mthenStm=ParseBlock();
 
         std::vector<std::unique_ptr<IfThenExpr>> elseStms;
-        while(current_token->type==tok_else)
+        while(current_token.type==tok_else)
         {
             getNextToken(tok_else);
-            if(current_token->type==tok_if)
+            if(current_token.type==tok_if)
             {
                 getNextToken(tok_if);
                 getNextToken(tok_lparen);
@@ -790,20 +917,20 @@ namespace vire
         getNextToken(tok_id);
 
         std::unique_ptr<VToken> Parent;
-        if(current_token->type==tok_lparen)
+        if(current_token.type==tok_lparen)
         {
             getNextToken(tok_lparen);
             Parent=copyCurrentToken();
             getNextToken(tok_id);
             getNextToken(tok_rparen);
         }
-        else if(current_token->type==tok_colon)
+        else if(current_token.type==tok_colon)
         {
             getNextToken(tok_colon);
             Parent=copyCurrentToken();
             getNextToken(tok_id);
         }
-        else if(current_token->type==tok_extends)
+        else if(current_token.type==tok_extends)
         {
             getNextToken(tok_extends);
             Parent=copyCurrentToken();
@@ -814,22 +941,22 @@ namespace vire
 
         std::vector<std::unique_ptr<FunctionBaseAST>> funcs;
         std::vector<std::unique_ptr<VariableDefAST>> vars;
-        while(current_token->type!=tok_rbrace)
+        while(current_token.type!=tok_rbrace)
         {
-            if(current_token->type==tok_eof) return LogErrorC("Expected '}' found end of file");
+            if(current_token.type==tok_eof) return LogErrorC("Expected '}' found end of file");
 
-            if(current_token->type==tok_func)
+            if(current_token.type==tok_func)
             {
                 auto func=ParseFunction();
                 funcs.push_back(std::move(func));
             }
-            else if(current_token->type==tok_proto)
+            else if(current_token.type==tok_proto)
             {
                 auto proto=ParseFunction();
                 funcs.push_back(std::move(proto));
                 getNextToken(tok_semicol);
             }
-            else if(current_token->type==tok_vardef || current_token->type==tok_const || current_token->type==tok_let)
+            else if(current_token.type==tok_vardef || current_token.type==tok_const || current_token.type==tok_let)
             {
                 auto var=ParseVariableDef();
                 auto varCast=cast_static<VariableDefAST>(std::move(var));
@@ -846,19 +973,13 @@ namespace vire
     {
         getNextToken(tok_new); // consume `new`
         
+        auto id_name=current_token;
         auto id_expr=ParseIdExpr();
 
         std::vector<std::unique_ptr<ExprAST>> args;
-        std::unique_ptr<VToken> id_name;
-        if(id_expr->asttype==ast_var)
-        {
-            std::unique_ptr<VariableExprAST> var(static_cast<VariableExprAST*>(id_expr.release()));
-            id_name=var->moveToken();
-        }
-        else if(id_expr->asttype==ast_call)
+        if(id_expr->asttype==ast_call)
         {
             std::unique_ptr<CallExprAST> call(static_cast<CallExprAST*>(id_expr.release()));
-            id_name=call->moveToken();
             args=call->moveArgs();
         }
 
@@ -868,7 +989,7 @@ namespace vire
     {
         getNextToken(tok_delete);
 
-        auto id_name=copyCurrentToken();
+        auto id_name=current_token;
         getNextToken(tok_id);
 
         return std::make_unique<DeleteExprAST>(std::move(id_name));
@@ -897,9 +1018,9 @@ namespace vire
         getNextToken(tok_lparen);
 
         std::vector<std::unique_ptr<VariableDefAST>> args;
-        while(current_token->type==tok_id)
+        while(current_token.type==tok_id)
         {
-            auto var_name=copyCurrentToken();
+            auto var_name=current_token;
             getNextToken(tok_id);
             getNextToken(tok_colon);
             
@@ -921,35 +1042,35 @@ namespace vire
         std::unordered_map<proto::IName, std::unique_ptr<ExprAST>> members;
 
         bool found_constructor=false;
-        while(current_token->type!=tok_rbrace)
+        while(current_token.type!=tok_rbrace)
         {
-            if(current_token->type==tok_eof) return LogErrorPB("Expected '}' found end of file");
+            if(current_token.type==tok_eof) return LogErrorPB("Expected '}' found end of file");
 
             std::unique_ptr<ExprAST> member;
             std::string member_name;
-            if(current_token->type==tok_union)
+            if(current_token.type==tok_union)
             {
                 member=ParseUnion();
                 member_name=((UnionExprAST*)member.get())->getIName().name;
             }
-            else if(current_token->type==tok_struct)
+            else if(current_token.type==tok_struct)
             {
                 member=ParseStruct();
                 member_name=((StructExprAST*)member.get())->getIName().name;
             }
-            else if(current_token->type==tok_id)
+            else if(current_token.type==tok_id)
             {
-                auto type=copyCurrentToken();
+                auto type=current_token;
                 getNextToken(tok_id);
 
-                auto name=copyCurrentToken();
+                auto name=current_token;
                 getNextToken(tok_id);
                 getNextToken(tok_semicol);
 
-                member_name=name->value;
-                member=std::make_unique<VariableDefAST>(std::move(name), types::construct(type->value), nullptr);
+                member_name=name.value;
+                member=std::make_unique<VariableDefAST>(std::move(name), types::construct(std::string(type.value)), nullptr);
             }
-            else if(current_token->type==tok_constructor)
+            else if(current_token.type==tok_constructor)
             {
                 auto cons=ParseConstructor();
                 if(found_constructor) std::cout << "Already encountered constructor, multiple constructors yet to be added" << std::endl;
@@ -958,7 +1079,7 @@ namespace vire
             }
             else
             {
-                std::cout << "Invalid Token: " << current_token->value << std::endl;
+                std::cout << "Invalid Token: " << current_token.value << std::endl;
                 break;
             }
             
@@ -975,7 +1096,7 @@ namespace vire
 
         char is_anonymous=1;
         std::unique_ptr<VToken> name;
-        if(current_token->type==tok_id)
+        if(current_token.type==tok_id)
         {
             is_anonymous=0;
             name=copyCurrentToken();
@@ -991,7 +1112,7 @@ namespace vire
 
         char is_anonymous=1;
         std::unique_ptr<VToken> name;
-        if(current_token->type==tok_id)
+        if(current_token.type==tok_id)
         {
             is_anonymous=0;
             name=copyCurrentToken();
@@ -1022,7 +1143,22 @@ namespace vire
 
     std::unique_ptr<ModuleAST> VParser::ParseSourceModule()
     {
+        // Every node parsed below comes from the module's arena, the arena is declared before
+        // the node vectors so that it outlives them when parsing fails
+        auto arena=std::make_unique<proto::Arena>();
+        proto::ArenaScope arena_scope(arena.get());
+        types::TypeContextScope type_scope(type_context);
+
         lexer->reset();
+        deferred_bodies.clear();
+        called.clear();
+
+        tok_indx=0;
+        // Skipping a body has to leave it unlexed
+        if(prelex && !lazy_bodies)
+            lexer->tokenize(tokens);
+        else
+            tokens.reset(lexer->code, lexer->getStart());
 
         getNextToken(true); // load the first token
         parse_success=true;
@@ -1031,36 +1167,53 @@ namespace vire
         std::vector<std::unique_ptr<FunctionBaseAST>> Functions;
         std::vector<std::unique_ptr<ClassAST>> Classes;
         std::vector<std::unique_ptr<ExprAST>> StructUnionDefs;
-        while(current_token->type!=tok_eof)
+        std::vector<std::string> Imports;
+        while(current_token.type!=tok_eof)
         {
-            if(current_token->type==tok_class)
+            if(current_token.type==tok_import)
+            {
+                getNextToken(tok_import); // consume `import`
+                if(current_token.type==tok_str)
+                    Imports.push_back(std::string(current_token.value));
+                getNextToken(tok_str);
+                getNextToken(tok_semicol);
+            }
+            else if(current_token.type==tok_class)
             {
                 auto class_ast=ParseClass();
                 Classes.push_back(std::move(class_ast));
             }
-            else if(current_token->type==tok_func)
+            else if(current_token.type==tok_func)
             {
-                auto func_ast=ParseFunction();
-                Functions.push_back(std::move(func_ast));
+                if(lazy_bodies)
+                {
+                    Functions.push_back(nullptr);
+                    DeferFunction(Functions.size()-1);
+                }
+                else
+                {
+                    auto func_ast=ParseFunction();
+                    Functions.push_back(std::move(func_ast));
+                }
             }
-            else if(current_token->type==tok_proto)
+            else if(current_token.type==tok_proto)
             {
                 auto proto_ast=ParseProto();
                 getNextToken(tok_semicol);
                 Functions.push_back(std::move(proto_ast));
             }
-            else if(current_token->type==tok_extern)
+            else if(current_token.type==tok_extern)
             {
                 auto extern_ast=ParseExtern();
                 getNextToken(tok_semicol);
                 Functions.push_back(std::move(extern_ast));
             }
-            else if(current_token->type==tok_struct)
+            else if(current_token.type==tok_struct)
             {
                 auto struct_ast=ParseStruct();
                 StructUnionDefs.push_back(std::move(struct_ast));
             }
-            else if(current_token->type==tok_union)
+            else if(current_token.type==tok_union)
             {
                 auto union_ast=ParseUnion();
                 StructUnionDefs.push_back(std::move(union_ast));
@@ -1080,11 +1233,17 @@ namespace vire
             }
         }
         
+        // After an error the bodies could be anywhere
+        if(parse_success)
+            ParseNeededBodies(Functions);
+
         if(!parse_success)
         {
             return nullptr;
         }
 
-        return std::make_unique<ModuleAST>(std::move(PreExecutionStatements),std::move(Functions),std::move(Classes),std::move(StructUnionDefs));
+        auto module=std::make_unique<ModuleAST>(std::move(PreExecutionStatements),std::move(Functions),std::move(Classes),std::move(StructUnionDefs),std::move(arena));
+        module->setImports(std::move(Imports));
+        return module;
     }
 }
\ No newline at end of file
@@ -18,17 +18,46 @@ class VParser
     std::unique_ptr<VLexer> lexer;
     Config* config;
     bool parse_success;
+
+    // Tokens are read out of `tokens` by index, with `prelex` the whole module is lexed
+    // up front, otherwise the table is filled lazily as the parser (or a lookahead) needs it
+    VTokenTable tokens;
+    std::size_t tok_indx;
+    bool prelex;
+
+    // Types parsed by this parser are interned here, nullptr uses the process-wide context
+    types::TypeContext* type_context;
+
+    // DeferredBody - A top-level function whose body was skipped, `offset` is where its `{` is in
+    // the source and `slot` where the function goes among the module's functions
+    struct DeferredBody
+    {
+        std::unique_ptr<PrototypeAST> proto;
+        proto::SourceLocation begin;
+        std::size_t offset;
+        std::size_t slot;
+    };
+    bool lazy_bodies;
+    std::vector<DeferredBody> deferred_bodies;
+    // Names of the functions called by what was parsed so far, kept only with `lazy_bodies`
+    std::vector<std::string_view> called;
+
+    void fillTokens(std::size_t indx);
+    VToken tokenAt(std::size_t indx);
+    void skipBlock();
+    void DeferFunction(std::size_t slot);
+    void ParseNeededBodies(std::vector<std::unique_ptr<FunctionBaseAST>>& functions);
 public:
-    std::unique_ptr<VToken> current_token;
+    VToken current_token;
     const proto::IName* current_func_name;
 
-    VParser(VLexer* _lexer, Config* _config=nullptr)
-    : lexer(_lexer), current_token() {
+    VParser(VLexer* _lexer, Config* _config=nullptr, bool prelex=false, types::TypeContext* type_context=nullptr)
+    : lexer(_lexer), tok_indx(0), prelex(prelex), type_context(type_context), lazy_bodies(false), current_token() {
         if(_config) config=_config;
         else config=lexer->getConfig();
     }
-    VParser(std::unique_ptr<VLexer> _lexer, Config* _config=nullptr) 
-    : lexer(std::move(_lexer)), current_token(std::make_unique<VToken>("",tok_eof)) {
+    VParser(std::unique_ptr<VLexer> _lexer, Config* _config=nullptr, bool prelex=false, types::TypeContext* type_context=nullptr) 
+    : lexer(std::move(_lexer)), tok_indx(0), prelex(prelex), type_context(type_context), lazy_bodies(false), current_token("",tok_eof) {
         if(_config) config=_config;
         else config=lexer->getConfig();
     }
@@ -43,8 +72,11 @@ public:
     void getNextToken(bool first_token=false);
     void getNextToken(int toktype);
     std::unique_ptr<VToken> copyCurrentToken();
+    // Returns the token `k` places after the current one without consuming anything
+    VToken peekToken(std::size_t k=1);
+    int peekType(std::size_t k=1);
 
-    std::unique_ptr<types::Base> ParseTypeIdentifier();
+    types::Base* ParseTypeIdentifier();
     std::vector<std::unique_ptr<ExprAST>> ParseBlock();
 
     std::unique_ptr<ExprAST> ParsePrimary();
@@ -93,6 +125,11 @@ public:
     std::unique_ptr<ExprAST> ParseReference();
 
     std::unique_ptr<ModuleAST> ParseSourceModule();
+
+    // Skips the bodies of top-level functions and parses only those of `main` and of what the
+    // parsed code calls, top-level statements included. The others are left out of the module and
+    // so are any errors in them. Tokens are then lexed as they are needed, even with `prelex`
+    void setLazyBodies(bool lazy) { lazy_bodies=lazy; }
 };
 
 }
\ No newline at end of file
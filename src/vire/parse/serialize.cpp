@@ -0,0 +1,1077 @@
+#include "serialize.hpp"
+
+#include <cstring>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "vire/proto/hash.hpp"
+
+#ifndef VIRE_VERSION
+#define VIRE_VERSION "unknown"
+#endif
+
+namespace vire
+{
+    namespace
+    {
+        enum SectionKind
+        {
+            section_strings,
+            section_string_data,
+            section_types,
+            section_words,
+            section_count,
+        };
+        struct Section
+        {
+            std::uint32_t offset;
+            std::uint32_t count;
+        };
+        struct Header
+        {
+            char magic[4];
+            std::uint32_t version;
+            Section sections[section_count];
+        };
+        struct StringEntry
+        {
+            std::uint32_t offset;
+            std::uint32_t size;
+        };
+        // An array has a `child` and a `length`, a custom type its size in `length`
+        struct TypeEntry
+        {
+            std::uint32_t kind;
+            std::uint32_t name;
+            std::uint32_t child;
+            std::uint32_t length;
+        };
+
+        // Which FunctionBaseAST follows
+        enum FunctionKind
+        {
+            function_none,
+            function_proto,
+            function_extern,
+            function_definition,
+        };
+
+        constexpr char ast_magic[4]={'V', 'A', 'S', 'T'};
+        constexpr std::size_t entry_sizes[section_count]=
+        {
+            sizeof(StringEntry), 1, sizeof(TypeEntry), sizeof(std::uint32_t),
+        };
+        // A node without a type, the parser leaves none of those but the data may have one
+        constexpr std::uint32_t no_type=0xFFFFFFFF;
+        // Deeper than any source the parser could take, keeps bad data from overflowing the stack
+        constexpr unsigned int max_depth=4096;
+
+        class ASTWriter
+        {
+            proto::SourceLocation start;
+            std::string string_data;
+            std::vector<StringEntry> strings;
+            std::unordered_map<std::string, std::uint32_t> string_ids;
+            std::vector<TypeEntry> types;
+            std::unordered_map<types::Base*, std::uint32_t> type_ids;
+            std::vector<std::uint32_t> words;
+            bool valid=true;
+
+            template<typename T>
+            static void append(std::string& out, std::vector<T> const& entries)
+            {
+                out.append((char const*)entries.data(), entries.size()*sizeof(T));
+            }
+
+            std::uint32_t addString(std::string_view text)
+            {
+                auto it=string_ids.find(std::string(text));
+                if(it!=string_ids.end())
+                    return it->second;
+
+                std::uint32_t id=strings.size();
+                strings.push_back(StringEntry{(std::uint32_t)string_data.size(), (std::uint32_t)text.size()});
+                string_data.append(text);
+                string_ids.emplace(std::string(text), id);
+                return id;
+            }
+            std::uint32_t addType(types::Base* type)
+            {
+                if(!type)
+                    return no_type;
+                auto it=type_ids.find(type);
+                if(it!=type_ids.end())
+                    return it->second;
+
+                TypeEntry entry{(std::uint32_t)type->getType(), 0, 0, 0};
+                switch(type->getType())
+                {
+                case types::EType::Array:
+                {
+                    auto* array=(types::Array*)type;
+                    entry.child=addType(array->getChild());
+                    entry.length=array->getLength();
+                    break;
+                }
+                case types::EType::Void:
+                    entry.name=addString(((types::Void*)type)->getName());
+                    break;
+                case types::EType::Custom:
+                    entry.name=addString(((types::Custom*)type)->getName());
+                    entry.length=(std::int32_t)type->getSize();
+                    break;
+                default:
+                    break;
+                }
+
+                std::uint32_t id=types.size();
+                types.push_back(entry);
+                type_ids.emplace(type, id);
+                return id;
+            }
+
+            void word(std::uint32_t value) { words.push_back(value); }
+            void flag(bool value) { words.push_back(value); }
+            void string(std::string_view text) { words.push_back(addString(text)); }
+            void type(types::Base* type) { words.push_back(addType(type)); }
+            // 1 past the offset from the start of the source, 0 is no location
+            void location(proto::SourceLocation loc)
+            {
+                words.push_back(loc.isValid() && start.offset<=loc.offset ? loc.offset-start.offset+1 : 0);
+            }
+            void token(VToken const* token)
+            {
+                flag(token!=nullptr);
+                if(!token)
+                    return;
+                word((std::uint32_t)token->type);
+                string(token->value);
+                location(token->loc);
+            }
+        public:
+            explicit ASTWriter(proto::SourceLocation start)
+            : start(start)
+            {   }
+
+            bool isValid() const { return valid; }
+
+            void exprs(std::vector<std::unique_ptr<ExprAST>> const& list)
+            {
+                word(list.size());
+                for(auto const& expr : list)
+                    this->expr(expr.get());
+            }
+            // A tag, 1 past the asttype or 0 for none, the location and the type and then what
+            // the kind of node holds
+            void expr(ExprAST* expr)
+            {
+                if(!expr)
+                {
+                    word(0);
+                    return;
+                }
+                word(expr->asttype+1);
+                location(expr->getLoc());
+                type(expr->getType());
+
+                switch(expr->asttype)
+                {
+                case ast_var:
+                {
+                    auto* var=(IdentifierExprAST*)expr;
+                    string(var->getIName().name);
+                    flag(var->is_const);
+                    break;
+                }
+                case ast_type_access:
+                {
+                    auto* access=(TypeAccessAST*)expr;
+                    this->expr(access->getParent());
+                    this->expr(access->getChild());
+                    break;
+                }
+                case ast_vardef:
+                {
+                    auto* def=(VariableDefAST*)expr;
+                    string(def->getIName().name);
+                    flag(def->isConst());
+                    flag(def->isLet());
+                    this->expr(def->getValue());
+                    break;
+                }
+                case ast_varassign:
+                {
+                    auto* assign=(VariableAssignAST*)expr;
+                    this->expr(assign->getLHS());
+                    this->expr(assign->getRHS());
+                    token(assign->getShorthandOperator());
+                    break;
+                }
+                case ast_for:
+                {
+                    auto* for_=(ForExprAST*)expr;
+                    this->expr(for_->getInit());
+                    this->expr(for_->getCond());
+                    this->expr(for_->getIncr());
+                    exprs(for_->getBody());
+                    break;
+                }
+                case ast_while:
+                {
+                    auto* while_=(WhileExprAST*)expr;
+                    this->expr(while_->getCond());
+                    exprs(while_->getBody());
+                    break;
+                }
+                case ast_int:
+                    word((std::uint32_t)((IntExprAST*)expr)->getValue());
+                    break;
+                case ast_float:
+                {
+                    std::uint32_t bits;
+                    float value=((FloatExprAST*)expr)->getValue();
+                    std::memcpy(&bits, &value, sizeof(bits));
+                    word(bits);
+                    break;
+                }
+                case ast_double:
+                {
+                    std::uint32_t bits[2];
+                    double value=((DoubleExprAST*)expr)->getValue();
+                    std::memcpy(bits, &value, sizeof(bits));
+                    word(bits[0]);
+                    word(bits[1]);
+                    break;
+                }
+                case ast_char:
+                    word((unsigned char)((CharExprAST*)expr)->getValue());
+                    break;
+                case ast_bool:
+                    flag(((BoolExprAST*)expr)->getValue());
+                    break;
+                case ast_str:
+                    string(((StrExprAST*)expr)->getValue());
+                    break;
+                case ast_array:
+                    exprs(((ArrayExprAST*)expr)->getElements());
+                    break;
+                case ast_call:
+                {
+                    auto* call=(CallExprAST*)expr;
+                    string(call->getIName().name);
+                    exprs(call->getArgs());
+                    break;
+                }
+                case ast_unop:
+                {
+                    auto* unop=(UnaryExprAST*)expr;
+                    token(unop->getop());
+                    this->expr(unop->getExpr());
+                    break;
+                }
+                case ast_binop:
+                {
+                    auto* binop=(BinaryExprAST*)expr;
+                    token(binop->getOp());
+                    this->expr(binop->getLHS());
+                    this->expr(binop->getRHS());
+                    break;
+                }
+                case ast_incrdecr:
+                {
+                    auto* incrdecr=(IncrementDecrementAST*)expr;
+                    this->expr(incrdecr->getExpr());
+                    flag(incrdecr->isPre());
+                    flag(incrdecr->isIncrement());
+                    break;
+                }
+                case ast_cast:
+                {
+                    auto* cast=(CastExprAST*)expr;
+                    this->expr(cast->getExpr());
+                    type(cast->getDestType());
+                    flag(cast->isNonUserDefined());
+                    break;
+                }
+                case ast_array_access:
+                {
+                    auto* access=(VariableArrayAccessAST*)expr;
+                    this->expr(access->getExpr());
+                    exprs(access->getIndices());
+                    break;
+                }
+                case ast_return:
+                {
+                    auto* ret=(ReturnExprAST*)expr;
+                    this->expr(ret->getValue());
+                    string(ret->getIName().name);
+                    break;
+                }
+                case ast_break:
+                {
+                    auto* break_=(BreakExprAST*)expr;
+                    flag(break_->is_after);
+                    this->expr(break_->getAfterBreak());
+                    break;
+                }
+                case ast_continue:
+                {
+                    auto* continue_=(ContinueExprAST*)expr;
+                    flag(continue_->is_after);
+                    this->expr(continue_->getAfterCont());
+                    break;
+                }
+                case ast_if:
+                {
+                    auto* ifthen=(IfThenExpr*)expr;
+                    this->expr(ifthen->getCondition());
+                    exprs(ifthen->getThenBlock());
+                    break;
+                }
+                case ast_ifelse:
+                {
+                    auto* if_=(IfExprAST*)expr;
+                    this->expr(if_->getIfThen());
+                    word(if_->getElifLadder().size());
+                    for(auto const& elif : if_->getElifLadder())
+                        this->expr(elif.get());
+                    break;
+                }
+                case ast_new:
+                {
+                    auto* new_=(NewExprAST*)expr;
+                    string(new_->getName());
+                    exprs(new_->getArgs());
+                    break;
+                }
+                case ast_delete:
+                    string(((DeleteExprAST*)expr)->getName());
+                    break;
+                case ast_unsafe:
+                    exprs(((UnsafeExprAST*)expr)->getBody());
+                    break;
+                case ast_reference:
+                    this->expr(((ReferenceExprAST*)expr)->getVariable());
+                    break;
+                case ast_struct:
+                case ast_union:
+                {
+                    // Members in the order they are laid out, each with the name it is found by
+                    auto* record=(TypeAST*)expr;
+                    string(record->getIName().name);
+                    auto members=record->getMembersValues();
+                    word(members.size());
+                    for(auto* member : members)
+                    {
+                        if(member->asttype==ast_vardef)
+                            string(((VariableDefAST*)member)->getIName().name);
+                        else
+                            string(((TypeAST*)member)->getIName().name);
+                        this->expr(member);
+                    }
+                    if(expr->asttype==ast_struct)
+                        function(((StructExprAST*)expr)->getConstructor());
+                    break;
+                }
+                default:
+                    valid=false;
+                    break;
+                }
+            }
+
+            void prototype(PrototypeAST const* proto)
+            {
+                token(proto->getNameToken());
+                word(proto->getArgs().size());
+                for(auto const& arg : proto->getArgs())
+                    expr(arg.get());
+                type(proto->getReturnType());
+                flag(proto->doesRequireSelfRef());
+                flag(proto->isConstructor());
+            }
+            void function(FunctionBaseAST const* function)
+            {
+                if(!function)
+                {
+                    word(function_none);
+                }
+                else if(function->is_extern())
+                {
+                    word(function_extern);
+                    prototype(((ExternAST const*)function)->getProto());
+                }
+                else if(function->is_proto())
+                {
+                    word(function_proto);
+                    prototype((PrototypeAST const*)function);
+                }
+                else
+                {
+                    auto const* definition=(FunctionAST const*)function;
+                    word(function_definition);
+                    prototype(definition->getProto());
+                    exprs(definition->getBody());
+                    location(definition->getSourceBegin());
+                    location(definition->getSourceEnd());
+                }
+            }
+            void class_(ClassAST const* class_)
+            {
+                token(class_->getNameToken());
+                token(class_->getParentToken());
+
+                auto functions=class_->getFunctions();
+                word(functions.size());
+                for(auto const* function : functions)
+                    this->function(function);
+
+                auto members=class_->getMembers();
+                word(members.size());
+                for(auto const* member : members)
+                    expr((ExprAST*)member);
+            }
+            void module(ModuleAST const& module)
+            {
+                exprs(module.getPreExecutionStatements());
+
+                word(module.getFunctions().size());
+                for(auto const& function : module.getFunctions())
+                    this->function(function.get());
+
+                word(module.getClasses().size());
+                for(auto const& class_ : module.getClasses())
+                    this->class_(class_.get());
+
+                exprs(module.getUnionStructs());
+
+                word(module.getImports().size());
+                for(auto const& path : module.getImports())
+                    string(path);
+            }
+
+            std::string finish()
+            {
+                Header header;
+                std::memcpy(header.magic, ast_magic, sizeof(header.magic));
+                header.version=VSerializedModule::version;
+
+                std::size_t counts[section_count]={strings.size(), string_data.size(), types.size(), words.size()};
+                std::uint32_t offset=sizeof(Header);
+                for(int i=0; i<section_count; ++i)
+                {
+                    // Keeps every section 4 byte aligned
+                    offset=(offset+3) & ~3u;
+                    header.sections[i]=Section{offset, (std::uint32_t)counts[i]};
+                    offset+=counts[i]*entry_sizes[i];
+                }
+
+                std::string out;
+                out.reserve(offset);
+                out.append((char const*)&header, sizeof(header));
+                out.resize(header.sections[section_strings].offset, '\0');       append(out, strings);
+                out.resize(header.sections[section_string_data].offset, '\0');   out+=string_data;
+                out.resize(header.sections[section_types].offset, '\0');         append(out, types);
+                out.resize(header.sections[section_words].offset, '\0');         append(out, words);
+                return out;
+            }
+        };
+
+        class ASTReader
+        {
+            std::string_view data;
+            Header header;
+            proto::SourceLocation start;
+            std::vector<types::Base*> resolved;
+            std::uint32_t pos=0;
+            unsigned int depth=0;
+            bool failed=false;
+
+            // Every read after a failure gives 0, which is checked for once a node is complete
+            std::uint32_t next()
+            {
+                if(failed || pos>=header.sections[section_words].count)
+                {
+                    failed=true;
+                    return 0;
+                }
+                std::uint32_t value;
+                std::memcpy(&value, data.data()+header.sections[section_words].offset+(std::size_t)pos*sizeof(value), sizeof(value));
+                ++pos;
+                return value;
+            }
+            // A list of `count` things that take at least a word each
+            std::uint32_t count()
+            {
+                auto value=next();
+                if(value>header.sections[section_words].count-pos)
+                {
+                    failed=true;
+                    return 0;
+                }
+                return value;
+            }
+            bool stringAt(std::uint32_t index, std::string_view& text) const
+            {
+                StringEntry entry;
+                if(index>=header.sections[section_strings].count)
+                    return false;
+                std::memcpy(&entry, data.data()+header.sections[section_strings].offset+(std::size_t)index*sizeof(entry), sizeof(entry));
+                if((std::uint64_t)entry.offset+entry.size>header.sections[section_string_data].count)
+                    return false;
+                text=data.substr(header.sections[section_string_data].offset+entry.offset, entry.size);
+                return true;
+            }
+            std::string_view string()
+            {
+                std::string_view text;
+                auto index=next();
+                if(!failed && !stringAt(index, text))
+                    failed=true;
+                return text;
+            }
+            types::Base* type()
+            {
+                auto index=next();
+                if(index==no_type)
+                    return nullptr;
+                if(index>=resolved.size())
+                {
+                    failed=true;
+                    return nullptr;
+                }
+                return resolved[index];
+            }
+            proto::SourceLocation location()
+            {
+                auto offset=next();
+                return offset ? start.getOffset(offset-1) : proto::SourceLocation();
+            }
+            std::unique_ptr<VToken> token()
+            {
+                if(!next())
+                    return nullptr;
+                int kind=(int)next();
+                auto text=string();
+                auto loc=location();
+                return failed ? nullptr : VToken::construct(text, kind, loc);
+            }
+
+            template<typename T>
+            std::unique_ptr<T> required(std::unique_ptr<T> node)
+            {
+                if(!node)
+                    failed=true;
+                return node;
+            }
+            template<typename T>
+            std::unique_ptr<T> expect(std::unique_ptr<ExprAST> node, int asttype)
+            {
+                if(!node || node->asttype!=asttype)
+                {
+                    failed=true;
+                    return nullptr;
+                }
+                return cast_static<T>(std::move(node));
+            }
+            bool exprs(std::vector<std::unique_ptr<ExprAST>>& list)
+            {
+                auto size=count();
+                list.reserve(size);
+                for(std::uint32_t i=0; i<size && !failed; ++i)
+                    list.push_back(required(expr()));
+                return !failed;
+            }
+
+            // `node_type` is what the node had, a variable is made with it
+            std::unique_ptr<ExprAST> node(int asttype, proto::SourceLocation loc, types::Base* node_type)
+            {
+                switch(asttype)
+                {
+                case ast_var:
+                {
+                    auto name=string();
+                    bool is_const=next();
+                    if(failed)
+                        return nullptr;
+                    auto var=std::make_unique<VariableExprAST>(VToken(name, tok_id, loc));
+                    var->is_const=is_const;
+                    return var;
+                }
+                case ast_type_access:
+                {
+                    auto parent=required(expr());
+                    auto child=required(expr());
+                    if(failed || !(child->asttype==ast_var || child->asttype==ast_call || child->asttype==ast_type_access))
+                        return nullptr;
+                    return std::make_unique<TypeAccessAST>(std::move(parent), cast_static<IdentifierExprAST>(std::move(child)));
+                }
+                case ast_vardef:
+                {
+                    auto name=string();
+                    bool is_const=next();
+                    bool is_let=next();
+                    auto value=expr();
+                    if(failed || !node_type)
+                        return nullptr;
+                    return std::make_unique<VariableDefAST>(VToken(name, tok_id, loc), node_type, std::move(value), is_const, is_let);
+                }
+                case ast_varassign:
+                {
+                    auto lhs=required(expr());
+                    auto rhs=required(expr());
+                    auto shorthand=token();
+                    if(failed)
+                        return nullptr;
+                    return std::make_unique<VariableAssignAST>(std::move(lhs), std::move(rhs), std::move(shorthand));
+                }
+                case ast_for:
+                {
+                    auto init=expr();
+                    auto cond=expr();
+                    auto incr=expr();
+                    std::vector<std::unique_ptr<ExprAST>> body;
+                    if(!exprs(body))
+                        return nullptr;
+                    return std::make_unique<ForExprAST>(std::move(init), std::move(cond), std::move(incr), std::move(body));
+                }
+                case ast_while:
+                {
+                    auto cond=required(expr());
+                    std::vector<std::unique_ptr<ExprAST>> body;
+                    if(!exprs(body))
+                        return nullptr;
+                    return std::make_unique<WhileExprAST>(std::move(cond), std::move(body));
+                }
+                case ast_int:
+                    return std::make_unique<IntExprAST>((int)next(), VToken("", tok_int, loc));
+                case ast_float:
+                {
+                    std::uint32_t bits=next();
+                    float value;
+                    std::memcpy(&value, &bits, sizeof(value));
+                    return std::make_unique<FloatExprAST>(value, VToken("", tok_float, loc));
+                }
+                case ast_double:
+                {
+                    std::uint32_t bits[2];
+                    bits[0]=next();
+                    bits[1]=next();
+                    double value;
+                    std::memcpy(&value, bits, sizeof(value));
+                    return std::make_unique<DoubleExprAST>(value, VToken("", tok_double, loc));
+                }
+                case ast_char:
+                    return std::make_unique<CharExprAST>((char)next(), VToken("", tok_char, loc));
+                case ast_bool:
+                    return std::make_unique<BoolExprAST>(next()!=0, VToken("", tok_true, loc));
+                case ast_str:
+                    return std::make_unique<StrExprAST>(std::string(string()), VToken("", tok_str, loc));
+                case ast_array:
+                {
+                    std::vector<std::unique_ptr<ExprAST>> elements;
+                    if(!exprs(elements))
+                        return nullptr;
+                    return std::make_unique<ArrayExprAST>(std::move(elements));
+                }
+                case ast_call:
+                {
+                    auto name=string();
+                    std::vector<std::unique_ptr<ExprAST>> args;
+                    if(!exprs(args))
+                        return nullptr;
+                    return std::make_unique<CallExprAST>(VToken(name, tok_id, loc), std::move(args));
+                }
+                case ast_unop:
+                {
+                    auto op=required(token());
+                    auto operand=required(expr());
+                    if(failed)
+                        return nullptr;
+                    return std::make_unique<UnaryExprAST>(std::move(op), std::move(operand));
+                }
+                case ast_binop:
+                {
+                    auto op=required(token());
+                    auto lhs=required(expr());
+                    auto rhs=required(expr());
+                    if(failed)
+                        return nullptr;
+                    return std::make_unique<BinaryExprAST>(std::move(op), std::move(lhs), std::move(rhs));
+                }
+                case ast_incrdecr:
+                {
+                    auto operand=required(expr());
+                    bool is_pre=next();
+                    bool is_increment=next();
+                    if(failed)
+                        return nullptr;
+                    return std::make_unique<IncrementDecrementAST>(std::move(operand), is_pre, is_increment);
+                }
+                case ast_cast:
+                {
+                    auto operand=required(expr());
+                    auto* dest=type();
+                    bool is_non_user_defined=next();
+                    if(failed || !dest)
+                        return nullptr;
+                    return std::make_unique<CastExprAST>(std::move(operand), dest, is_non_user_defined);
+                }
+                case ast_array_access:
+                {
+                    auto array=required(expr());
+                    std::vector<std::unique_ptr<ExprAST>> indices;
+                    if(!exprs(indices))
+                        return nullptr;
+                    return std::make_unique<VariableArrayAccessAST>(std::move(array), std::move(indices));
+                }
+                case ast_return:
+                {
+                    auto value=expr();
+                    auto name=string();
+                    if(failed)
+                        return nullptr;
+                    auto ret=std::make_unique<ReturnExprAST>(std::move(value));
+                    ret->setName(std::string(name));
+                    return ret;
+                }
+                case ast_break:
+                case ast_continue:
+                {
+                    bool is_after=next();
+                    auto after=expr();
+                    if(failed || is_after!=(after!=nullptr))
+                        return nullptr;
+                    if(asttype==ast_break)
+                        return after ? std::make_unique<BreakExprAST>(std::move(after)) : std::make_unique<BreakExprAST>();
+                    return after ? std::make_unique<ContinueExprAST>(std::move(after)) : std::make_unique<ContinueExprAST>();
+                }
+                case ast_if:
+                {
+                    auto cond=expr();
+                    std::vector<std::unique_ptr<ExprAST>> then;
+                    if(!exprs(then))
+                        return nullptr;
+                    return std::make_unique<IfThenExpr>(std::move(cond), std::move(then));
+                }
+                case ast_ifelse:
+                {
+                    auto ifthen=expect<IfThenExpr>(expr(), ast_if);
+                    auto size=count();
+                    std::vector<std::unique_ptr<IfThenExpr>> ladder;
+                    for(std::uint32_t i=0; i<size && !failed; ++i)
+                        ladder.push_back(expect<IfThenExpr>(expr(), ast_if));
+                    if(failed)
+                        return nullptr;
+                    return std::make_unique<IfExprAST>(std::move(ifthen), std::move(ladder));
+                }
+                case ast_new:
+                {
+                    auto name=string();
+                    std::vector<std::unique_ptr<ExprAST>> args;
+                    if(!exprs(args))
+                        return nullptr;
+                    return std::make_unique<NewExprAST>(VToken(name, tok_id, loc), std::move(args));
+                }
+                case ast_delete:
+                {
+                    auto name=string();
+                    if(failed)
+                        return nullptr;
+                    return std::make_unique<DeleteExprAST>(VToken(name, tok_id, loc));
+                }
+                case ast_unsafe:
+                {
+                    std::vector<std::unique_ptr<ExprAST>> body;
+                    if(!exprs(body))
+                        return nullptr;
+                    return std::make_unique<UnsafeExprAST>(std::move(body));
+                }
+                case ast_reference:
+                {
+                    auto var=required(expr());
+                    if(failed)
+                        return nullptr;
+                    return std::make_unique<ReferenceExprAST>(std::move(var));
+                }
+                case ast_struct:
+                case ast_union:
+                {
+                    auto name=string();
+                    auto size=count();
+                    INameExprMap members;
+                    std::vector<proto::IName> order;
+                    for(std::uint32_t i=0; i<size && !failed; ++i)
+                    {
+                        auto member_name=string();
+                        auto member=required(expr());
+                        if(failed || !(member->asttype==ast_vardef || member->asttype==ast_struct || member->asttype==ast_union))
+                            return nullptr;
+
+                        order.push_back(proto::IName(std::string(member_name)));
+                        if(!members.emplace(order.back(), std::move(member)).second)
+                            return nullptr;
+                    }
+                    if(failed)
+                        return nullptr;
+                    if(asttype==ast_union)
+                        return std::make_unique<UnionExprAST>(std::move(members), VToken::construct(name, tok_id, loc), order);
+
+                    auto constructor=function();
+                    if(failed || (constructor && (constructor->is_proto() || constructor->is_extern())))
+                        return nullptr;
+                    return std::make_unique<StructExprAST>(std::move(members), cast_static<FunctionAST>(std::move(constructor)),
+                        VToken::construct(name, tok_id, loc), order);
+                }
+                default:
+                    return nullptr;
+                }
+            }
+        public:
+            ASTReader(std::string_view bytes, proto::SourceLocation start)
+            : data(bytes), start(start)
+            {
+                failed=!open();
+            }
+
+            bool open()
+            {
+                if(data.size()<sizeof(Header))
+                    return false;
+                std::memcpy(&header, data.data(), sizeof(Header));
+                if(std::memcmp(header.magic, ast_magic, sizeof(header.magic))!=0 || header.version!=VSerializedModule::version)
+                    return false;
+
+                for(int i=0; i<section_count; ++i)
+                {
+                    auto const& section=header.sections[i];
+                    if((std::uint64_t)section.offset+(std::uint64_t)section.count*entry_sizes[i]>data.size())
+                        return false;
+                }
+                return true;
+            }
+            bool isValid() const { return !failed; }
+
+            // Types refer to the ones before them only, so a table can not loop
+            bool readTypes()
+            {
+                if(failed)
+                    return false;
+
+                auto& context=types::getContext();
+                resolved.resize(header.sections[section_types].count);
+                for(std::uint32_t i=0; i<resolved.size(); ++i)
+                {
+                    TypeEntry entry;
+                    std::memcpy(&entry, data.data()+header.sections[section_types].offset+(std::size_t)i*sizeof(entry), sizeof(entry));
+
+                    std::string_view name;
+                    switch((types::EType)entry.kind)
+                    {
+                    case types::EType::Array:
+                        if(entry.child>=i)
+                            return false;
+                        resolved[i]=context.getArray(resolved[entry.child], entry.length);
+                        break;
+                    case types::EType::Void:
+                        if(!stringAt(entry.name, name))
+                            return false;
+                        resolved[i]=context.getVoid(std::string(name));
+                        break;
+                    case types::EType::Custom:
+                        if(!stringAt(entry.name, name))
+                            return false;
+                        resolved[i]=context.getCustom(std::string(name), (std::int32_t)entry.length);
+                        break;
+                    case types::EType::Char:
+                    case types::EType::Short:
+                    case types::EType::Int:
+                    case types::EType::Long:
+                    case types::EType::Float:
+                    case types::EType::Double:
+                    case types::EType::Bool:
+                    case types::EType::Any:
+                        resolved[i]=context.get((types::EType)entry.kind);
+                        break;
+                    default:
+                        return false;
+                    }
+                }
+                return true;
+            }
+
+            std::unique_ptr<ExprAST> expr()
+            {
+                auto tag=next();
+                if(failed || tag==0)
+                    return nullptr;
+                if(depth>=max_depth)
+                {
+                    failed=true;
+                    return nullptr;
+                }
+
+                auto loc=location();
+                auto* type=this->type();
+                if(failed)
+                    return nullptr;
+
+                ++depth;
+                auto expr=node((int)tag-1, loc, type);
+                --depth;
+                if(!expr || failed)
+                {
+                    failed=true;
+                    return nullptr;
+                }
+
+                // What the parser set after making the node, like the length of an array
+                expr->setLoc(loc);
+                if(type && expr->getType()!=type)
+                    expr->ExprAST::setType(type);
+                return expr;
+            }
+
+            std::unique_ptr<PrototypeAST> prototype()
+            {
+                auto name=required(token());
+                auto size=count();
+                std::vector<std::unique_ptr<VariableDefAST>> args;
+                for(std::uint32_t i=0; i<size && !failed; ++i)
+                    args.push_back(expect<VariableDefAST>(expr(), ast_vardef));
+                auto* return_type=type();
+                bool requires_selfref=next();
+                bool is_constructor=next();
+                if(failed || !return_type)
+                    return nullptr;
+                return std::make_unique<PrototypeAST>(std::move(name), std::move(args), return_type, requires_selfref, is_constructor);
+            }
+            std::unique_ptr<FunctionBaseAST> function()
+            {
+                switch(next())
+                {
+                case function_none:
+                    return nullptr;
+                case function_proto:
+                    return required(prototype());
+                case function_extern:
+                {
+                    auto proto=required(prototype());
+                    if(failed)
+                        return nullptr;
+                    return std::make_unique<ExternAST>(std::move(proto));
+                }
+                case function_definition:
+                {
+                    auto proto=required(prototype());
+                    std::vector<std::unique_ptr<ExprAST>> body;
+                    exprs(body);
+                    auto begin=location();
+                    auto end=location();
+                    if(failed)
+                        return nullptr;
+                    auto function=std::make_unique<FunctionAST>(std::move(proto), std::move(body));
+                    function->setSourceRange(begin, end);
+                    return function;
+                }
+                default:
+                    failed=true;
+                    return nullptr;
+                }
+            }
+            std::unique_ptr<ClassAST> class_()
+            {
+                auto name=required(token());
+                auto parent=required(token());
+
+                std::vector<std::unique_ptr<FunctionBaseAST>> functions;
+                auto function_count=count();
+                for(std::uint32_t i=0; i<function_count && !failed; ++i)
+                    functions.push_back(required(function()));
+
+                std::vector<std::unique_ptr<VariableDefAST>> members;
+                auto member_count=count();
+                for(std::uint32_t i=0; i<member_count && !failed; ++i)
+                    members.push_back(expect<VariableDefAST>(expr(), ast_vardef));
+
+                if(failed)
+                    return nullptr;
+                return std::make_unique<ClassAST>(std::move(name), std::move(functions), std::move(members), std::move(parent));
+            }
+
+            std::unique_ptr<ModuleAST> module(std::unique_ptr<proto::Arena> arena)
+            {
+                std::vector<std::unique_ptr<ExprAST>> statements;
+                exprs(statements);
+
+                std::vector<std::unique_ptr<FunctionBaseAST>> functions;
+                auto function_count=count();
+                for(std::uint32_t i=0; i<function_count && !failed; ++i)
+                    functions.push_back(required(function()));
+
+                std::vector<std::unique_ptr<ClassAST>> classes;
+                auto class_count=count();
+                for(std::uint32_t i=0; i<class_count && !failed; ++i)
+                    classes.push_back(class_());
+
+                std::vector<std::unique_ptr<ExprAST>> union_structs;
+                exprs(union_structs);
+
+                std::vector<std::string> imports;
+                auto import_count=count();
+                for(std::uint32_t i=0; i<import_count && !failed; ++i)
+                    imports.emplace_back(string());
+
+                // Anything left over is not what was written
+                if(failed || pos!=header.sections[section_words].count)
+                    return nullptr;
+
+                auto module=std::make_unique<ModuleAST>(std::move(statements), std::move(functions), std::move(classes),
+                    std::move(union_structs), std::move(arena));
+                module->setImports(std::move(imports));
+                return module;
+            }
+        };
+    }
+
+    VSerializedModule::VSerializedModule(std::shared_ptr<const proto::SourceBuffer> data)
+    : data(std::move(data)), valid(false)
+    {
+        valid=this->data && ASTReader(this->data->view(), proto::SourceLocation()).isValid();
+    }
+
+    bool VSerializedModule::write(ModuleAST const& module, proto::SourceLocation start, std::string& output)
+    {
+        ASTWriter writer(start);
+        writer.module(module);
+        if(!writer.isValid())
+            return false;
+
+        output=writer.finish();
+        return true;
+    }
+
+    std::unique_ptr<ModuleAST> VSerializedModule::instantiate(proto::SourceLocation start) const
+    {
+        if(!valid)
+            return nullptr;
+
+        // Declared before the reader so that nodes it leaves behind when it fails go first
+        auto arena=std::make_unique<proto::Arena>();
+        proto::ArenaScope arena_scope(arena.get());
+
+        ASTReader reader(data->view(), start);
+        if(!reader.readTypes())
+            return nullptr;
+
+        auto module=reader.module(std::move(arena));
+        if(module)
+            module->adoptBuffer(data);
+        return module;
+    }
+
+    std::string VSerializedModule::makeKey(std::string_view source)
+    {
+        return proto::hashParts({VIRE_VERSION, std::to_string(version), source});
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "vire/ast/include.hpp"
+#include "vire/proto/file.hpp"
+#include "vire/proto/source.hpp"
+
+namespace vire
+{
+
+// VSerializedModule - A ModuleAST as the parser made it, so a source that did not change does not
+// have to be lexed and parsed again. After a header come a table of the strings, which are stored
+// once each, a table of the types, children before the arrays that hold them, and the nodes as a
+// stream of 32-bit words written depth first. Nothing refers to an address: nodes hold their
+// children in place, names and types are indexes and locations are offsets from the start of the
+// module's source. A module is read back in place, tokens point into the data
+class VSerializedModule
+{
+public:
+    static constexpr std::uint32_t version=1;
+private:
+    std::shared_ptr<const proto::SourceBuffer> data;
+    bool valid;
+public:
+    explicit VSerializedModule(std::shared_ptr<const proto::SourceBuffer> data);
+
+    // The header and the tables fit in the data, nodes are checked as they are read
+    bool isValid() const { return valid; }
+
+    // `module` has to be as it was parsed, the analyzer changes it in ways that are not kept.
+    // `start` is the location of its source's first character. Returns false if it has a node
+    // the parser does not make
+    static bool write(ModuleAST const& module, proto::SourceLocation start, std::string& output);
+
+    // The module in the current type context, its locations in the source at `start`. Returns
+    // nullptr if the data is not valid
+    std::unique_ptr<ModuleAST> instantiate(proto::SourceLocation start) const;
+
+    // Names what `source` serializes to, which differs between compiler and format versions
+    static std::string makeKey(std::string_view source);
+};
+
+}
@@ -4,8 +4,25 @@ add_library(
     ${SRC_DIR}/src/vire/proto/file.hpp
     ${SRC_DIR}/src/vire/proto/file.cpp
 
+    ${SRC_DIR}/src/vire/proto/source.hpp
+    ${SRC_DIR}/src/vire/proto/source.cpp
+
+    ${SRC_DIR}/src/vire/proto/arena.hpp
+    ${SRC_DIR}/src/vire/proto/arena.cpp
+
+    ${SRC_DIR}/src/vire/proto/symbol.hpp
+    ${SRC_DIR}/src/vire/proto/symbol.cpp
+
     ${SRC_DIR}/src/vire/proto/iname.hpp
     ${SRC_DIR}/src/vire/proto/iname.cpp
+
+    ${SRC_DIR}/src/vire/proto/thread_pool.hpp
+    ${SRC_DIR}/src/vire/proto/thread_pool.cpp
+
+    ${SRC_DIR}/src/vire/proto/hash.hpp
+    ${SRC_DIR}/src/vire/proto/hash.cpp
 )
 
+target_link_libraries(vire-proto-file PUBLIC Threads::Threads)
+
 target_link_libraries(VIRELANG PRIVATE vire-proto-file)
\ No newline at end of file
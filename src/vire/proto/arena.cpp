@@ -0,0 +1,112 @@
+#include <new>
+#include <cstdlib>
+
+#include "arena.hpp"
+
+namespace vire
+{
+namespace proto
+{
+
+    static thread_local Arena* current_arena=nullptr;
+
+    Arena::Arena()
+    : chunks(nullptr), cur(nullptr), end(nullptr), allocations(0), bytes_used(0), bytes_reserved(0)
+    {}
+    Arena::~Arena()
+    {
+        release();
+    }
+
+    void Arena::grow(std::size_t min_size)
+    {
+        std::size_t size=min_size+sizeof(Chunk)+alignof(std::max_align_t);
+        if(size<chunk_size)
+            size=chunk_size;
+
+        auto* chunk=(Chunk*)std::malloc(size);
+        if(!chunk)
+            throw std::bad_alloc();
+        chunk->next=chunks;
+        chunk->size=size;
+        chunks=chunk;
+
+        cur=(char*)(chunk+1);
+        end=(char*)chunk+size;
+        bytes_reserved+=size;
+    }
+
+    void* Arena::allocate(std::size_t size, std::size_t align)
+    {
+        auto aligned=((std::uintptr_t)cur+align-1)&~(std::uintptr_t)(align-1);
+        if(!cur || aligned+size>(std::uintptr_t)end)
+        {
+            grow(size+align);
+            aligned=((std::uintptr_t)cur+align-1)&~(std::uintptr_t)(align-1);
+        }
+
+        cur=(char*)(aligned+size);
+        ++allocations;
+        bytes_used+=size;
+        return (void*)aligned;
+    }
+
+    void Arena::release()
+    {
+        while(chunks)
+        {
+            auto* next=chunks->next;
+            std::free(chunks);
+            chunks=next;
+        }
+        cur=end=nullptr;
+        allocations=bytes_used=bytes_reserved=0;
+    }
+
+    Arena* Arena::current()
+    {
+        return current_arena;
+    }
+
+    ArenaScope::ArenaScope(Arena* arena)
+    : previous(current_arena)
+    {
+        current_arena=arena;
+    }
+    ArenaScope::~ArenaScope()
+    {
+        current_arena=previous;
+    }
+
+    // Every node is preceded by a header saying where its memory came from, the header is
+    // a whole max_align_t so the node itself stays suitably aligned
+    static constexpr std::size_t node_header=alignof(std::max_align_t);
+    enum NodeOrigin : std::uintptr_t { node_heap=0, node_arena=1 };
+
+    void* ArenaNode::operator new(std::size_t size)
+    {
+        char* mem;
+        if(current_arena)
+        {
+            mem=(char*)current_arena->allocate(size+node_header);
+            *(std::uintptr_t*)mem=node_arena;
+        }
+        else
+        {
+            mem=(char*)::operator new(size+node_header);
+            *(std::uintptr_t*)mem=node_heap;
+        }
+        return mem+node_header;
+    }
+    void ArenaNode::operator delete(void* ptr)
+    {
+        if(!ptr)
+            return;
+
+        char* mem=(char*)ptr-node_header;
+        if(*(std::uintptr_t*)mem==node_heap)
+            ::operator delete(mem);
+    }
+
+}
+}
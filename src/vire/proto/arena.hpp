@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace vire
+{
+namespace proto
+{
+
+// Arena - A bump allocator, memory is only given back all at once when the arena is released
+// or destroyed. Not thread safe, one thread allocates from an arena at a time
+class Arena
+{
+    struct Chunk
+    {
+        Chunk* next;
+        std::size_t size;
+    };
+
+    Chunk* chunks;
+    char* cur;
+    char* end;
+
+    std::size_t allocations;
+    std::size_t bytes_used;
+    std::size_t bytes_reserved;
+
+    void grow(std::size_t min_size);
+public:
+    static constexpr std::size_t chunk_size=64*1024;
+
+    Arena();
+    ~Arena();
+
+    Arena(Arena const&)=delete;
+    Arena& operator=(Arena const&)=delete;
+
+    void* allocate(std::size_t size, std::size_t align=alignof(std::max_align_t));
+    void release();
+
+    std::size_t getAllocationCount() const { return allocations; }
+    std::size_t getBytesUsed() const { return bytes_used; }
+    std::size_t getBytesReserved() const { return bytes_reserved; }
+
+    // The arena `ArenaNode`s are allocated from on this thread, nullptr if there is none
+    static Arena* current();
+};
+
+// ArenaScope - Makes `arena` the current arena of this thread until the scope ends
+class ArenaScope
+{
+    Arena* previous;
+public:
+    explicit ArenaScope(Arena* arena);
+    ~ArenaScope();
+
+    ArenaScope(ArenaScope const&)=delete;
+    ArenaScope& operator=(ArenaScope const&)=delete;
+};
+
+// ArenaNode - Base for the AST nodes and tokens. `new` takes memory from the current
+// arena if there is one and from the heap otherwise, `delete` runs the destructor as usual but
+// only hands heap memory back, arena memory goes away with its arena
+class ArenaNode
+{
+public:
+    static void* operator new(std::size_t size);
+    static void operator delete(void* ptr);
+};
+
+}
+}
@@ -1,8 +1,17 @@
 #include <iostream>
 #include <ostream>
 #include <fstream>
+#include <sstream>
 #include <string>
 
+#if !defined(VIRE_USE_EMCC) && !defined(_WIN32)
+#define VIRE_USE_MMAP
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
 #include "file.hpp"
 
 namespace vire
@@ -36,18 +45,63 @@ namespace proto
 
     std::string readFile(std::fstream& file, char close)
     {
-        std::string buf, out;
+        std::ostringstream out;
+        out << file.rdbuf();
+
+        if(close)
+            file.close();
+
+        return std::move(out).str();
+    }
+
+    SourceBuffer::SourceBuffer(std::string text)
+    : mapped(false), owned(std::move(text))
+    {
+        data=owned.data();
+        size=owned.size();
+    }
+    SourceBuffer::SourceBuffer(const char* mapping, std::size_t size)
+    : data(mapping), size(size), mapped(true)
+    {}
+    SourceBuffer::~SourceBuffer()
+    {
+#ifdef VIRE_USE_MMAP
+        if(mapped)
+            munmap((void*)data, size);
+#endif
+    }
 
-        while(std::getline(file,buf))
+    std::shared_ptr<const SourceBuffer> SourceBuffer::fromFile(const std::string& filename)
+    {
+#ifdef VIRE_USE_MMAP
+        int fd=open(filename.c_str(), O_RDONLY);
+        if(fd<0)
         {
-            out += buf;
-            out += '\n';
+            std::cout << "File " << filename << " doest not exist." << std::endl;
+            return fromString("");
         }
 
-        if(close)
-            file.close();
+        struct stat st;
+        // Empty files can not be mapped, and pipes or devices have no fixed size to map
+        if(fstat(fd, &st)==0 && S_ISREG(st.st_mode) && st.st_size>0)
+        {
+            void* mapping=mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            close(fd);
 
-        return out;
+            if(mapping!=MAP_FAILED)
+                return std::make_shared<const SourceBuffer>((const char*)mapping, (std::size_t)st.st_size);
+        }
+        else
+        {
+            close(fd);
+        }
+#endif
+        auto file=openFile(filename);
+        return fromString(readFile(file, true));
+    }
+    std::shared_ptr<const SourceBuffer> SourceBuffer::fromString(std::string text)
+    {
+        return std::make_shared<const SourceBuffer>(std::move(text));
     }
 
 }
@@ -4,6 +4,8 @@
 #include <ostream>
 #include <fstream>
 #include <string>
+#include <string_view>
+#include <memory>
 
 namespace vire
 {
@@ -15,5 +17,30 @@ namespace proto
 
     std::string readFile(std::fstream& file, char close=0);
 
+    // SourceBuffer - Read-only source text, either a read-only mapping of a file or an owned string.
+    // It is passed around as a shared_ptr so the lexer, analyzer and error reporting view the same bytes.
+    class SourceBuffer
+    {
+        const char* data;
+        std::size_t size;
+        bool mapped;
+        std::string owned;
+    public:
+        SourceBuffer(std::string text);
+        // Takes ownership of a mapping made with mmap
+        SourceBuffer(const char* mapping, std::size_t size);
+        ~SourceBuffer();
+
+        SourceBuffer(SourceBuffer const&)=delete;
+        SourceBuffer& operator=(SourceBuffer const&)=delete;
+
+        std::string_view view() const { return std::string_view(data, size); }
+        bool isMapped() const { return mapped; }
+
+        // Maps regular files and reads everything else (pipes, devices), a missing file gives an empty buffer
+        static std::shared_ptr<const SourceBuffer> fromFile(const std::string& filename);
+        static std::shared_ptr<const SourceBuffer> fromString(std::string text);
+    };
+
 }
 }
\ No newline at end of file
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <initializer_list>
+#include <string>
+#include <string_view>
+
+namespace vire
+{
+namespace proto
+{
+
+// SHA-256 of `parts` in hex, for naming cache entries. Every part is length prefixed so no two
+// different lists of parts hash the same text
+std::string hashParts(std::initializer_list<std::string_view> parts);
+
+}
+}
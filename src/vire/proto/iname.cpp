@@ -9,12 +9,12 @@ IName::IName()
 {
     this->name="";
     this->prefix="_";
-    this->prefixed_name=this->prefix+this->name;
+    refresh();
 }
 IName::IName(std::string name, std::string prefix)
 : name(name), prefix(prefix)
 {
-    this->prefixed_name=prefix+name;
+    refresh();
 }
 
 void IName::setName(const char* name)
@@ -39,17 +39,26 @@ void IName::setPrefix(std::string const& prefix)
 
 std::string const& IName::get() const
 {
-    return prefixed_name;
+    return symbolName(prefixed);
+}
+Symbol IName::getSymbol() const
+{
+    return prefixed;
+}
+Symbol IName::getNameSymbol() const
+{
+    return plain;
 }
 
 void IName::refresh()
 {
-    prefixed_name=prefix+name;
+    prefixed=intern(prefix+name);
+    plain=intern(name);
 }
 
 bool IName::isSame(IName const& rhs) const
 {
-    return this->get()==rhs.get();
+    return prefixed==rhs.prefixed;
 }
 bool IName::operator==(IName const& rhs) const
 {
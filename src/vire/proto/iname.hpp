@@ -2,14 +2,19 @@
 
 #include <string>
 
+#include "symbol.hpp"
+
 namespace vire
 {
 namespace proto
 {
 
+// IName - A name with a prefix, the concatenation is interned so names compare and hash
+// by their symbol id. The name without the prefix is interned too, for lookups keyed by it
 class IName
 {
-    std::string prefixed_name;
+    Symbol prefixed;
+    Symbol plain;
 
     void refresh();
 public:
@@ -26,6 +31,8 @@ public:
     void setPrefix(std::string const& prefix);
 
     std::string const& get() const;
+    Symbol getSymbol() const;
+    Symbol getNameSymbol() const;
 
     bool isSame(IName const& rhs) const;
     bool operator==(IName const& rhs) const;
@@ -43,11 +50,7 @@ struct hash<vire::proto::IName>
 {
   std::size_t operator()(const vire::proto::IName& k) const
   {
-    using std::size_t;
-    using std::hash;
-    using std::string;
-
-    return hash<string>()(k.get());
+    return hash<vire::proto::Symbol>()(k.getSymbol());
   }
 };
 
@@ -1,4 +1,9 @@
 #pragma once
 
 #include "file.hpp"
-#include "iname.hpp"
\ No newline at end of file
+#include "source.hpp"
+#include "arena.hpp"
+#include "symbol.hpp"
+#include "iname.hpp"
+#include "thread_pool.hpp"
+#include "hash.hpp"
\ No newline at end of file
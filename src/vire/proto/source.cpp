@@ -0,0 +1,135 @@
+#include <iostream>
+#include <ostream>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include "source.hpp"
+
+namespace vire
+{
+namespace proto
+{
+
+    SourceLocation SourceManager::addBuffer(std::shared_ptr<const SourceBuffer> buffer, std::string name)
+    {
+        auto text=buffer->view();
+        
+        // One past the end is still a valid location (tok_eof), so it is counted as well
+        if(text.size()+1 > std::numeric_limits<std::uint32_t>::max()-next_start)
+        {
+            std::cout << "Source " << name << " does not fit in the source manager." << std::endl;
+            return SourceLocation();
+        }
+
+        Entry entry;
+        entry.name=std::move(name);
+        entry.buffer=std::move(buffer);
+        entry.start=next_start;
+
+        entry.line_starts.push_back(0);
+        const char* begin=text.data();
+        const char* end=begin+text.size();
+        for(const char* p=begin; p<end;)
+        {
+            auto* nl=(const char*)std::memchr(p, '\n', end-p);
+            if(!nl) break;
+            
+            p=nl+1;
+            entry.line_starts.push_back(p-begin);
+        }
+
+        next_start+=text.size()+1;
+        entries.push_back(std::move(entry));
+
+        return SourceLocation(entries.back().start);
+    }
+
+    SourceManager::Entry const* SourceManager::getEntry(SourceLocation loc) const
+    {
+        if(!loc.isValid() || entries.empty())
+            return nullptr;
+
+        auto it=std::upper_bound(entries.begin(), entries.end(), loc.offset,
+            [](std::uint32_t offset, Entry const& entry) { return offset<entry.start; });
+        
+        if(it==entries.begin())
+            return nullptr;
+        
+        return &*(it-1);
+    }
+    std::size_t SourceManager::getLineIndex(Entry const& entry, std::uint32_t offset) const
+    {
+        auto it=std::upper_bound(entry.line_starts.begin(), entry.line_starts.end(), offset);
+        return (it-entry.line_starts.begin())-1;
+    }
+
+    std::shared_ptr<const SourceBuffer> SourceManager::getBuffer(SourceLocation loc) const
+    {
+        auto* entry=getEntry(loc);
+        if(!entry)  return nullptr;
+        
+        return entry->buffer;
+    }
+    std::string const& SourceManager::getBufferName(SourceLocation loc) const
+    {
+        static const std::string unknown="<unknown>";
+        
+        auto* entry=getEntry(loc);
+        if(!entry)  return unknown;
+        
+        return entry->name;
+    }
+
+    std::size_t SourceManager::getLine(SourceLocation loc) const
+    {
+        auto* entry=getEntry(loc);
+        if(!entry)  return 0;
+
+        return getLineIndex(*entry, loc.offset-entry->start);
+    }
+    std::size_t SourceManager::getColumn(SourceLocation loc) const
+    {
+        auto* entry=getEntry(loc);
+        if(!entry)  return 0;
+
+        std::uint32_t offset=loc.offset-entry->start;
+        return offset-entry->line_starts[getLineIndex(*entry, offset)];
+    }
+    std::size_t SourceManager::getLineCount(SourceLocation loc) const
+    {
+        auto* entry=getEntry(loc);
+        if(!entry)  return 0;
+
+        return entry->line_starts.size();
+    }
+    std::string_view SourceManager::getLineText(SourceLocation loc, std::size_t line) const
+    {
+        auto* entry=getEntry(loc);
+        if(!entry || line>=entry->line_starts.size())
+            return std::string_view();
+
+        auto text=entry->buffer->view();
+        std::size_t begin=entry->line_starts[line];
+        std::size_t end=(line+1<entry->line_starts.size()) ? entry->line_starts[line+1]-1 : text.size();
+        
+        // Drop the `\r` of a CRLF line ending
+        if(end>begin && text[end-1]=='\r')
+            --end;
+
+        return text.substr(begin, end-begin);
+    }
+    std::string_view SourceManager::getText(SourceLocation begin, SourceLocation end) const
+    {
+        auto* entry=getEntry(begin);
+        if(!entry || end<begin || getEntry(end)!=entry)
+            return std::string_view();
+
+        auto text=entry->buffer->view();
+        std::size_t first=begin.offset-entry->start;
+        std::size_t last=std::min<std::size_t>(end.offset-entry->start, text.size());
+        return text.substr(first, last-first);
+    }
+
+}
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+
+#include "file.hpp"
+
+namespace vire
+{
+namespace proto
+{
+
+// SourceLocation - A position in any buffer owned by a SourceManager, stored as a single offset
+// into the concatenation of all of them. Offset 0 is reserved for "no location"
+struct SourceLocation
+{
+    std::uint32_t offset;
+
+    SourceLocation() : offset(0) {}
+    explicit SourceLocation(std::uint32_t offset) : offset(offset) {}
+
+    bool isValid() const { return offset!=0; }
+    SourceLocation getOffset(std::uint32_t by) const { return SourceLocation(offset+by); }
+
+    bool operator==(SourceLocation const& rhs) const { return offset==rhs.offset; }
+    bool operator<(SourceLocation const& rhs) const { return offset<rhs.offset; }
+};
+
+// SourceManager - Owns every source buffer of a compilation and maps locations back to
+// a buffer, line and column. Line starts are tabulated once per buffer so lookups are O(log n)
+class SourceManager
+{
+    struct Entry
+    {
+        std::string name;
+        std::shared_ptr<const SourceBuffer> buffer;
+        std::uint32_t start;
+        std::vector<std::uint32_t> line_starts;
+    };
+
+    std::vector<Entry> entries;
+    std::uint32_t next_start;
+
+    Entry const* getEntry(SourceLocation loc) const;
+    std::size_t getLineIndex(Entry const& entry, std::uint32_t offset) const;
+public:
+    static constexpr std::uint32_t first_offset=1;
+
+    SourceManager() : next_start(first_offset) {}
+
+    // Returns the location of the first character of `buffer`, or an invalid location
+    // if the 32-bit offset space is used up
+    SourceLocation addBuffer(std::shared_ptr<const SourceBuffer> buffer, std::string name="");
+
+    std::shared_ptr<const SourceBuffer> getBuffer(SourceLocation loc) const;
+    std::string const& getBufferName(SourceLocation loc) const;
+
+    // Lines and columns start from 0
+    std::size_t getLine(SourceLocation loc) const;
+    std::size_t getColumn(SourceLocation loc) const;
+    std::size_t getLineCount(SourceLocation loc) const;
+    // Text of `line` in the buffer that contains `loc`, without the line break
+    std::string_view getLineText(SourceLocation loc, std::size_t line) const;
+    // Text from `begin` up to `end`, empty unless both are in the same buffer
+    std::string_view getText(SourceLocation begin, SourceLocation end) const;
+};
+
+}
+}
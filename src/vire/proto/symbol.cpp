@@ -0,0 +1,91 @@
+#include "symbol.hpp"
+
+namespace vire
+{
+namespace proto
+{
+
+    Interner::Interner()
+    : chunks(new std::atomic<std::string*>[max_chunks]), count(0), overflow(false), invalid_text("<invalid symbol>")
+    {
+        for(std::uint32_t i=0; i<max_chunks; ++i)
+            chunks[i].store(nullptr, std::memory_order_relaxed);
+        
+        intern(""); // so that Symbol() names the empty string
+    }
+    Interner::~Interner()
+    {
+        release();
+    }
+    void Interner::release()
+    {
+        for(std::uint32_t i=0; i<max_chunks; ++i)
+        {
+            delete[] chunks[i].load(std::memory_order_relaxed);
+            chunks[i].store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+    Interner& Interner::global()
+    {
+        static Interner interner;
+        return interner;
+    }
+
+    Symbol Interner::intern(std::string_view text)
+    {
+        {
+            std::shared_lock<std::shared_mutex> guard(lock);
+
+            auto it=ids.find(text);
+            if(it!=ids.end())
+                return Symbol(it->second);
+        }
+
+        // Another thread may have added the string since the lookup above
+        std::unique_lock<std::shared_mutex> guard(lock);
+
+        auto it=ids.find(text);
+        if(it!=ids.end())
+            return Symbol(it->second);
+
+        return add(text);
+    }
+    Symbol Interner::add(std::string_view text)
+    {
+        std::uint32_t id=count.load(std::memory_order_relaxed);
+        std::uint32_t chunk_indx=id>>chunk_bits;
+        if(chunk_indx>=max_chunks)
+        {
+            overflow.store(true, std::memory_order_relaxed);
+            return Symbol::invalid();
+        }
+
+        auto* chunk=chunks[chunk_indx].load(std::memory_order_relaxed);
+        if(!chunk)
+        {
+            chunk=new std::string[chunk_size];
+            chunks[chunk_indx].store(chunk, std::memory_order_release);
+        }
+
+        auto& slot=chunk[id&(chunk_size-1)];
+        slot=std::string(text);
+        ids.emplace(std::string_view(slot), id);
+        count.store(id+1, std::memory_order_relaxed);
+
+        return Symbol(id);
+    }
+
+    void Interner::reset()
+    {
+        std::unique_lock<std::shared_mutex> guard(lock);
+
+        ids.clear();
+        release();
+        count.store(0, std::memory_order_relaxed);
+        overflow.store(false, std::memory_order_relaxed);
+        add("");
+    }
+
+}
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <atomic>
+#include <unordered_map>
+
+namespace vire
+{
+namespace proto
+{
+
+// Symbol - A stable 32-bit id for an interned string, two symbols are equal exactly when
+// their text is. Id 0 is the empty string, invalid() is what interning gives once the table is full
+struct Symbol
+{
+    static constexpr std::uint32_t invalid_id=0xFFFFFFFF;
+
+    std::uint32_t id;
+
+    Symbol() : id(0) {}
+    explicit Symbol(std::uint32_t id) : id(id) {}
+
+    static Symbol invalid() { return Symbol(invalid_id); }
+
+    bool empty() const { return id==0; }
+    bool valid() const { return id!=invalid_id; }
+
+    bool operator==(Symbol const& rhs) const { return id==rhs.id; }
+    bool operator!=(Symbol const& rhs) const { return id!=rhs.id; }
+    bool operator<(Symbol const& rhs) const { return id<rhs.id; }
+};
+
+// Interner - Process wide table of identifiers. Interning a known string takes a shared lock and
+// only adding a new one an exclusive lock, looking a symbol's text up takes none. The text of a
+// symbol does not move, and nothing is freed until reset(), so the table only grows while a
+// process compiles. Past max_symbols distinct strings interning gives Symbol::invalid() and the
+// table counts as overflowed, which VApi reports as an error. Processes that compile for a long
+// time call reset() between compilations, see VCompileServer
+class Interner
+{
+    static constexpr std::uint32_t chunk_bits=12;
+    static constexpr std::uint32_t chunk_size=1u<<chunk_bits;
+    static constexpr std::uint32_t max_chunks=4096;
+
+    std::unique_ptr<std::atomic<std::string*>[]> chunks;
+    std::unordered_map<std::string_view, std::uint32_t> ids;
+    std::atomic<std::uint32_t> count;
+    std::atomic<bool> overflow;
+    std::shared_mutex lock;
+    std::string invalid_text;
+
+    Interner();
+    // The lock has to be held exclusively
+    Symbol add(std::string_view text);
+    void release();
+public:
+    static constexpr std::uint32_t max_symbols=max_chunks*chunk_size; // 16M distinct identifiers
+
+    ~Interner();
+
+    Interner(Interner const&)=delete;
+    Interner& operator=(Interner const&)=delete;
+
+    static Interner& global();
+
+    Symbol intern(std::string_view text);
+    std::string const& lookup(Symbol sym) const
+    {
+        if(!sym.valid())
+            return invalid_text;
+        auto* chunk=chunks[sym.id>>chunk_bits].load(std::memory_order_acquire);
+        return chunk[sym.id&(chunk_size-1)];
+    }
+
+    // Distinct strings interned, the empty one included
+    std::uint32_t size() const { return count.load(std::memory_order_relaxed); }
+    // Whether a string could not be interned since the last reset
+    bool overflowed() const { return overflow.load(std::memory_order_relaxed); }
+    // Frees every symbol but the empty string. No symbol made before may be used after, so it is
+    // only safe while nothing compiles
+    void reset();
+};
+
+inline Symbol intern(std::string_view text)
+{
+    return Interner::global().intern(text);
+}
+inline std::string const& symbolName(Symbol sym)
+{
+    return Interner::global().lookup(sym);
+}
+
+}
+}
+
+namespace std
+{
+template<>
+struct hash<vire::proto::Symbol>
+{
+  std::size_t operator()(const vire::proto::Symbol& k) const
+  {
+    return hash<std::uint32_t>()(k.id);
+  }
+};
+}
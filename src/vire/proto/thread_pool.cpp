@@ -0,0 +1,131 @@
+#include "thread_pool.hpp"
+
+namespace vire
+{
+namespace proto
+{
+
+    ThreadPool::ThreadPool(unsigned int thread_count)
+    : pending(0), batch(0), stopping(false)
+    {
+        if(thread_count==0)
+            thread_count=getDefaultThreadCount();
+
+        for(unsigned int i=0; i<thread_count; ++i)
+            queues.push_back(std::make_unique<Queue>());
+        for(unsigned int i=1; i<thread_count; ++i)
+            threads.emplace_back(&ThreadPool::runWorker, this, i);
+    }
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stopping=true;
+        }
+        wake.notify_all();
+
+        for(auto& thread : threads)
+            thread.join();
+    }
+
+    unsigned int ThreadPool::getDefaultThreadCount()
+    {
+    #ifdef VIRE_USE_EMCC
+        return 1;
+    #else
+        auto count=std::thread::hardware_concurrency();
+        return count?count:1;
+    #endif
+    }
+
+    bool ThreadPool::take(unsigned int worker, std::size_t& task)
+    {
+        {
+            auto& own=*queues[worker];
+            std::lock_guard<std::mutex> guard(own.lock);
+            if(!own.tasks.empty())
+            {
+                task=own.tasks.front();
+                own.tasks.pop_front();
+                return true;
+            }
+        }
+
+        for(unsigned int i=1; i<queues.size(); ++i)
+        {
+            auto& victim=*queues[(worker+i)%queues.size()];
+            std::lock_guard<std::mutex> guard(victim.lock);
+            if(!victim.tasks.empty())
+            {
+                task=victim.tasks.back();
+                victim.tasks.pop_back();
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void ThreadPool::work(unsigned int worker)
+    {
+        std::size_t task;
+        while(take(worker, task))
+        {
+            job(task, worker);
+
+            if(pending.fetch_sub(1, std::memory_order_acq_rel)==1)
+            {
+                // Taking the lock makes sure the waiting thread is either asleep or has not
+                // checked `pending` yet, so the notification cannot get lost
+                std::lock_guard<std::mutex> guard(lock);
+                done.notify_all();
+            }
+        }
+    }
+
+    void ThreadPool::runWorker(unsigned int worker)
+    {
+        std::uint64_t seen=0;
+        while(true)
+        {
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                wake.wait(guard, [&]{ return stopping || batch!=seen; });
+                if(stopping)
+                    return;
+                seen=batch;
+            }
+
+            work(worker);
+        }
+    }
+
+    void ThreadPool::forEach(std::size_t count, std::function<void(std::size_t, unsigned int)> fn)
+    {
+        if(count==0)
+            return;
+
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            job=std::move(fn);
+            pending.store(count, std::memory_order_relaxed);
+
+            // Round robin, so every worker starts out with tasks from all over the batch
+            for(std::size_t i=0; i<count; ++i)
+            {
+                auto& queue=*queues[i%queues.size()];
+                std::lock_guard<std::mutex> queue_guard(queue.lock);
+                queue.tasks.push_back(i);
+            }
+            ++batch;
+        }
+        wake.notify_all();
+
+        work(0);
+
+        std::unique_lock<std::mutex> guard(lock);
+        done.wait(guard, [&]{ return pending.load(std::memory_order_acquire)==0; });
+    }
+
+}
+}
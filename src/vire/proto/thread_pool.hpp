@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+
+namespace vire
+{
+namespace proto
+{
+
+// ThreadPool - A fixed set of workers that run batches of indexed tasks. Every worker owns a
+// queue of task indices, it takes from the front of its own and, once that runs dry, steals
+// from the back of the others'. The thread running a batch is worker 0 and works on it too,
+// so a pool of one thread runs everything inline
+class ThreadPool
+{
+    struct Queue
+    {
+        std::mutex lock;
+        std::deque<std::size_t> tasks;
+    };
+
+    std::vector<std::thread> threads;
+    std::vector<std::unique_ptr<Queue>> queues;
+
+    std::function<void(std::size_t, unsigned int)> job;
+    std::atomic<std::size_t> pending;
+    std::uint64_t batch;
+    bool stopping;
+
+    std::mutex lock;
+    std::condition_variable wake;
+    std::condition_variable done;
+
+    bool take(unsigned int worker, std::size_t& task);
+    void work(unsigned int worker);
+    void runWorker(unsigned int worker);
+public:
+    // 0 threads means one per hardware thread
+    explicit ThreadPool(unsigned int thread_count=0);
+    ~ThreadPool();
+
+    ThreadPool(ThreadPool const&)=delete;
+    ThreadPool& operator=(ThreadPool const&)=delete;
+
+    unsigned int size() const { return queues.size(); }
+
+    // Runs `fn(task, worker)` for every task in [0, count) and returns once all of them are done.
+    // `worker` is in [0, size()) and no two tasks run on the same worker at once. One batch
+    // runs at a time, forEach is not meant to be called from several threads or from a task
+    void forEach(std::size_t count, std::function<void(std::size_t, unsigned int)> fn);
+
+    static unsigned int getDefaultThreadCount();
+};
+
+}
+}
@@ -0,0 +1,18 @@
+add_library(
+    vire-remote
+
+    ${SRC_DIR}/src/vire/remote/protocol.hpp
+    ${SRC_DIR}/src/vire/remote/protocol.cpp
+    ${SRC_DIR}/src/vire/remote/server.hpp
+    ${SRC_DIR}/src/vire/remote/server.cpp
+    ${SRC_DIR}/src/vire/remote/client.hpp
+    ${SRC_DIR}/src/vire/remote/client.cpp
+)
+
+target_link_libraries(vire-remote PRIVATE vire-api Threads::Threads)
+
+add_executable(vire-server ${SRC_DIR}/src/server.cpp)
+target_link_libraries(vire-server PRIVATE vire-remote vire-api vire-pconfig vire-parser vire-error-builder vire-analyzer vire-compiler vire-interpreter vire-tiering vire-proto-file)
+
+add_executable(vire-client ${SRC_DIR}/src/client.cpp)
+target_link_libraries(vire-client PRIVATE vire-remote vire-pconfig)
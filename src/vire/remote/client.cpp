@@ -0,0 +1,45 @@
+#include "client.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <ostream>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace vire
+{
+    VCompileClient::VCompileClient(std::string socket_path)
+    : socket_path(std::move(socket_path))
+    {}
+
+    bool VCompileClient::send(CompileRequest const& request, CompileResponse& response)
+    {
+        sockaddr_un address;
+        if(socket_path.size()>=sizeof(address.sun_path))
+        {
+            std::cout << "The socket path " << socket_path << " is too long" << std::endl;
+            return false;
+        }
+        std::memset(&address, 0, sizeof(address));
+        address.sun_family=AF_UNIX;
+        std::memcpy(address.sun_path, socket_path.c_str(), socket_path.size()+1);
+
+        int fd=socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if(fd<0 || connect(fd, (sockaddr*)&address, sizeof(address))!=0)
+        {
+            std::cout << "Could not connect to the server at " << socket_path << ": " << std::strerror(errno) << std::endl;
+            if(fd>=0)
+                close(fd);
+            return false;
+        }
+
+        bool sent=writeRequest(fd, request) && readResponse(fd, response);
+        close(fd);
+        if(!sent)
+            std::cout << "The server at " << socket_path << " did not respond" << std::endl;
+        return sent;
+    }
+}
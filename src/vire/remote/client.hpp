@@ -0,0 +1,22 @@
+#pragma once
+
+#include <string>
+
+#include "protocol.hpp"
+
+namespace vire
+{
+
+// VCompileClient - Sends requests to a VCompileServer, each over a connection of its own
+class VCompileClient
+{
+    std::string socket_path;
+public:
+    VCompileClient(std::string socket_path);
+
+    // Returns false, after saying why, if there is no server or it went away before responding.
+    // A request the server could not compile is a response with `success` unset
+    bool send(CompileRequest const& request, CompileResponse& response);
+};
+
+}
@@ -0,0 +1,5 @@
+#pragma once
+
+#include "protocol.hpp"
+#include "server.hpp"
+#include "client.hpp"
@@ -0,0 +1,211 @@
+#include "protocol.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <string_view>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace vire
+{
+    // No one field is allowed to be larger, a peer sending garbage can not make the other side allocate it
+    static std::size_t const max_field_size=std::size_t(256)*1024*1024;
+
+    static bool writeAll(int fd, char const* data, std::size_t size)
+    {
+        while(size>0)
+        {
+            // MSG_NOSIGNAL, a peer that went away is an error here and not a SIGPIPE
+            auto written=send(fd, data, size, MSG_NOSIGNAL);
+            if(written<0)
+            {
+                if(errno==EINTR)
+                    continue;
+                return false;
+            }
+            data+=written;
+            size-=written;
+        }
+        return true;
+    }
+
+    // Reads ahead, a connection carries one message each way so nothing it reads belongs to another
+    class Reader
+    {
+        int fd;
+        char buffer[4096];
+        std::size_t begin=0;
+        std::size_t end=0;
+
+        bool fill()
+        {
+            while(true)
+            {
+                auto got=::read(fd, buffer, sizeof(buffer));
+                if(got<0 && errno==EINTR)
+                    continue;
+                if(got<=0)
+                    return false;
+                begin=0;
+                end=got;
+                return true;
+            }
+        }
+    public:
+        Reader(int fd) : fd(fd) {}
+
+        bool get(char& c)
+        {
+            if(begin==end && !fill())
+                return false;
+            c=buffer[begin++];
+            return true;
+        }
+        bool read(char* data, std::size_t size)
+        {
+            while(size>0)
+            {
+                if(begin==end && !fill())
+                    return false;
+                auto n=std::min(size, end-begin);
+                std::memcpy(data, buffer+begin, n);
+                begin+=n;
+                data+=n;
+                size-=n;
+            }
+            return true;
+        }
+    };
+
+    static void addField(std::string& message, std::string_view name, std::string_view value)
+    {
+        message+=name;
+        message+=' ';
+        message+=std::to_string(value.size());
+        message+='\n';
+        message+=value;
+    }
+    static bool sendFields(int fd, std::string& message)
+    {
+        addField(message, "end", "");
+        return writeAll(fd, message.data(), message.size());
+    }
+
+    // Calls `on_field` for each field until the `end` header, a header is at most a line of 64 bytes
+    static bool readFields(int fd, std::function<bool(std::string const&, std::string&)> const& on_field)
+    {
+        Reader reader(fd);
+        std::string name, value;
+        while(true)
+        {
+            std::string header;
+            char c;
+            do
+            {
+                if(!reader.get(c) || header.size()>64)
+                    return false;
+                header+=c;
+            } while(c!='\n');
+
+            auto space=header.find(' ');
+            if(space==std::string::npos)
+                return false;
+            name=header.substr(0, space);
+
+            char* end=nullptr;
+            auto size=std::strtoull(header.c_str()+space+1, &end, 10);
+            if(*end!='\n' || size>max_field_size)
+                return false;
+            if(name=="end")
+                return size==0;
+
+            value.resize(size);
+            if(!reader.read(value.data(), size) || !on_field(name, value))
+                return false;
+        }
+    }
+
+    bool writeRequest(int fd, CompileRequest const& request)
+    {
+        std::string message;
+        addField(message, "command", request.command==CompileRequest::stop?"stop":"compile");
+        if(!request.path.empty())
+            addField(message, "path", request.path);
+        else
+            addField(message, "source", request.source);
+        addField(message, "output", request.output);
+        addField(message, "target", request.target);
+        addField(message, "opt", optimization_to_str.at(request.opt_level));
+        addField(message, "lto", request.enable_lto?"1":"0");
+        addField(message, "jobs", std::to_string(request.jobs));
+        return sendFields(fd, message);
+    }
+    bool readRequest(int fd, CompileRequest& request)
+    {
+        request=CompileRequest();
+        return readFields(fd, [&request](std::string const& name, std::string& value)
+        {
+            if(name=="command")
+            {
+                if(value=="compile")        request.command=CompileRequest::compile;
+                else if(value=="stop")      request.command=CompileRequest::stop;
+                else                        return false;
+            }
+            else if(name=="path")           request.path=std::move(value);
+            else if(name=="source")         request.source=std::move(value);
+            else if(name=="output")         request.output=std::move(value);
+            else if(name=="target")         request.target=std::move(value);
+            else if(name=="opt")
+            {
+                auto opt=str_to_optimization.find(value);
+                if(opt==str_to_optimization.end())
+                    return false;
+                request.opt_level=opt->second;
+            }
+            else if(name=="lto")            request.enable_lto=value=="1";
+            else if(name=="jobs")
+            {
+                request.jobs=std::strtoul(value.c_str(), nullptr, 10);
+                if(request.jobs==0)
+                    request.jobs=1;
+            }
+            // Fields from newer clients are skipped
+            return true;
+        });
+    }
+
+    bool writeResponse(int fd, CompileResponse const& response)
+    {
+        std::string message;
+        addField(message, "success", response.success?"1":"0");
+        addField(message, "message", response.message);
+        return sendFields(fd, message);
+    }
+    bool readResponse(int fd, CompileResponse& response)
+    {
+        response=CompileResponse();
+        return readFields(fd, [&response](std::string const& name, std::string& value)
+        {
+            if(name=="success")         response.success=value=="1";
+            else if(name=="message")    response.message=std::move(value);
+            return true;
+        });
+    }
+
+    std::string getDefaultSocketPath()
+    {
+        if(char const* path=std::getenv("VIRE_SERVER_SOCKET"))
+            return path;
+
+        std::error_code ec;
+        auto directory=std::filesystem::temp_directory_path(ec);
+        if(ec)
+            directory="/tmp";
+        return (directory/("vire-server-"+std::to_string(getuid())+".sock")).string();
+    }
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <string>
+
+#include "vire/config/config.hpp"
+
+namespace vire
+{
+
+// CompileRequest - What a client asks the compile server to do. The code is either `source` or
+// read from `path`, paths are as the server sees them so clients send them absolute
+struct CompileRequest
+{
+    enum Command
+    {
+        compile,
+        stop,       // the server finishes the requests it has and exits
+    };
+
+    Command command=compile;
+    std::string source;
+    std::string path;
+    std::string output;
+    std::string target="sys";
+    Optimization opt_level=Optimization::O0;
+    bool enable_lto=false;
+    unsigned int jobs=1;
+};
+
+struct CompileResponse
+{
+    bool success=false;
+    std::string message;
+};
+
+// A message is a list of `name length\n` headers each followed by `length` bytes, ended by an
+// `end` header. Reads return false if the peer went away or sent something malformed
+bool writeRequest(int fd, CompileRequest const& request);
+bool readRequest(int fd, CompileRequest& request);
+bool writeResponse(int fd, CompileResponse const& response);
+bool readResponse(int fd, CompileResponse& response);
+
+// $VIRE_SERVER_SOCKET if it is set, else a socket of the user's own in the temporary directory
+std::string getDefaultSocketPath();
+
+}
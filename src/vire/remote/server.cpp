@@ -0,0 +1,276 @@
+#include "server.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <ostream>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "vire/api/include.hpp"
+
+namespace vire
+{
+    static bool makeAddress(std::string const& path, sockaddr_un& address)
+    {
+        if(path.size()>=sizeof(address.sun_path))
+            return false;
+
+        std::memset(&address, 0, sizeof(address));
+        address.sun_family=AF_UNIX;
+        std::memcpy(address.sun_path, path.c_str(), path.size()+1);
+        return true;
+    }
+
+    VCompileServer::VCompileServer(std::string socket_path, unsigned int threads)
+    : socket_path(std::move(socket_path)), thread_count(threads), listen_fd(-1), stopping(false), served(0)
+    {
+        if(thread_count==0)
+            thread_count=std::max(1u, std::thread::hardware_concurrency());
+    }
+    VCompileServer::~VCompileServer()
+    {
+        stop();
+        for(auto& worker : workers)
+        {
+            if(worker.joinable())
+                worker.join();
+        }
+        for(int fd : pending)
+            close(fd);
+
+        if(listen_fd>=0)
+        {
+            close(listen_fd);
+            unlink(socket_path.c_str());
+        }
+    }
+
+    bool VCompileServer::listen()
+    {
+        sockaddr_un address;
+        if(!makeAddress(socket_path, address))
+        {
+            std::cout << "The socket path " << socket_path << " is too long" << std::endl;
+            return false;
+        }
+
+        // A socket file nobody answers on is what a server that did not exit cleanly leaves behind
+        int probe=socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if(probe>=0)
+        {
+            bool running=connect(probe, (sockaddr*)&address, sizeof(address))==0;
+            close(probe);
+            if(running)
+            {
+                std::cout << "A server is already listening on " << socket_path << std::endl;
+                return false;
+            }
+        }
+        unlink(socket_path.c_str());
+
+        int fd=socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if(fd<0 || bind(fd, (sockaddr*)&address, sizeof(address))!=0)
+        {
+            std::cout << "Could not create the socket " << socket_path << ": " << std::strerror(errno) << std::endl;
+            if(fd>=0)
+                close(fd);
+            return false;
+        }
+
+        // Clients can have the server write anywhere it can, so only its user may connect
+        chmod(socket_path.c_str(), S_IRUSR | S_IWUSR);
+        if(::listen(fd, SOMAXCONN)!=0)
+        {
+            std::cout << "Could not listen on " << socket_path << ": " << std::strerror(errno) << std::endl;
+            close(fd);
+            unlink(socket_path.c_str());
+            return false;
+        }
+
+        listen_fd=fd;
+        return true;
+    }
+
+    void VCompileServer::serve()
+    {
+        if(listen_fd<0)
+            return;
+
+        for(unsigned int i=0; i<thread_count; ++i)
+            workers.emplace_back(&VCompileServer::work, this);
+
+        while(!stopping)
+        {
+            int fd=accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+            if(fd<0)
+            {
+                // stop() shuts the socket down, which is what ends a blocked accept
+                if(stopping)
+                    break;
+                if(errno==EINTR || errno==ECONNABORTED || errno==EMFILE || errno==ENFILE)
+                    continue;
+
+                std::cout << "Could not accept a connection: " << std::strerror(errno) << std::endl;
+                stop();
+                break;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                pending.push_back(fd);
+            }
+            ready.notify_one();
+        }
+
+        for(auto& worker : workers)
+            worker.join();
+        workers.clear();
+    }
+
+    void VCompileServer::stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if(stopping.exchange(true))
+                return;
+        }
+        if(listen_fd>=0)
+            shutdown(listen_fd, SHUT_RDWR);
+        ready.notify_all();
+    }
+
+    void VCompileServer::work()
+    {
+        warmUp();
+
+        unsigned int handled=0;
+        while(true)
+        {
+            int fd;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                ready.wait(lock, [this]{ return !pending.empty() || stopping; });
+                if(pending.empty())
+                    return;
+
+                fd=pending.front();
+                pending.pop_front();
+            }
+
+            handle(fd);
+            close(fd);
+
+            // The request's compiler is gone by now, the next one makes a fresh context
+            if(++handled%context_requests==0)
+                session.releaseContext();
+        }
+    }
+
+    // Makes this thread's context and a host target machine, and brings the compiler's code in,
+    // before the first client has to wait on it
+    void VCompileServer::warmUp()
+    {
+        VOutputCapture ignored;
+        std::shared_lock<std::shared_mutex> compiling(symbols);
+
+        auto api=VApi::loadFromText("func main() : int { return 0; }", "sys", &session);
+        api->parseSourceModule();
+        if(api->verifySourceModule())
+            api->compileSourceModule("", false, Optimization::O0);
+    }
+
+    void VCompileServer::handle(int fd)
+    {
+        CompileRequest request;
+        if(!readRequest(fd, request))
+            return;
+
+        CompileResponse response;
+        if(request.command==CompileRequest::stop)
+        {
+            response.success=true;
+            response.message="Stopping";
+            writeResponse(fd, response);
+            stop();
+            return;
+        }
+
+        VOutputCapture printed;
+        {
+            std::shared_lock<std::shared_mutex> compiling(symbols);
+            response=compile(request);
+        }
+        releaseSymbols();
+        response.message=printed.getText()+response.message;
+        ++served;
+        writeResponse(fd, response);
+    }
+
+    // Symbols live in the process wide interner, which would otherwise grow with every identifier
+    // any client ever sent. Nothing outside a compilation holds one
+    void VCompileServer::releaseSymbols()
+    {
+        auto& interner=proto::Interner::global();
+        if(interner.size()<symbol_limit && !interner.overflowed())
+            return;
+
+        std::unique_lock<std::shared_mutex> idle(symbols);
+        if(interner.size()>=symbol_limit || interner.overflowed())
+            interner.reset();
+    }
+
+    CompileResponse VCompileServer::compile(CompileRequest const& request)
+    {
+        CompileResponse response;
+        if(request.output.empty())
+        {
+            response.message="No output file was given";
+            return response;
+        }
+
+        std::unique_ptr<VApi> api;
+        if(!request.path.empty())
+        {
+            std::error_code ec;
+            if(!std::filesystem::is_regular_file(request.path, ec))
+            {
+                response.message="File "+request.path+" does not exist";
+                return response;
+            }
+            api=VApi::loadFromFile(request.path, request.target, &session);
+        }
+        else
+        {
+            api=VApi::loadFromText(request.source, request.target, &session);
+        }
+        // Requests are served thread_count at a time already
+        api->getCompiler()->getAnalyzer()->setThreadCount(1);
+
+        api->parseSourceModule();
+        if(!api->verifySourceModule())
+        {
+            response.message="Verification failed";
+            return response;
+        }
+        if(!api->compileSourceModule(request.output, true, request.opt_level, request.enable_lto, std::min(request.jobs, thread_count)))
+        {
+            response.message="Compilation failed";
+            return response;
+        }
+
+        response.success=true;
+        response.message="Compiled";
+        return response;
+    }
+
+    std::uint64_t VCompileServer::getRequestCount() const
+    {
+        return served;
+    }
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "vire/v_compiler/session.hpp"
+
+#include "protocol.hpp"
+
+namespace vire
+{
+
+// VCompileServer - Compiles for clients connecting over a Unix socket so that starting the
+// process and LLVM is paid for once. Connections are handed to a fixed set of worker threads, each
+// compiles in the context the session keeps for it and leases target machines from the session.
+// A connection is one request and its response, what the compiler prints while it is served is
+// sent back with the response. Symbols interned by the requests are released once there are more
+// than symbol_limit of them and no request is being compiled. A worker's LLVMContext keeps the
+// types and constants of every request compiled in it, it is replaced after context_requests
+class VCompileServer
+{
+    static constexpr std::uint32_t symbol_limit=1u<<20;
+    static constexpr unsigned int context_requests=32;
+
+    std::string socket_path;
+    unsigned int thread_count;
+    int listen_fd;
+
+    VCompilerSession session;
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<int> pending;
+    std::atomic<bool> stopping;
+    std::atomic<std::uint64_t> served;
+    // Held shared while compiling, exclusively to reset the interner
+    std::shared_mutex symbols;
+private:
+    void work();
+    void warmUp();
+    void handle(int fd);
+    CompileResponse compile(CompileRequest const& request);
+    void releaseSymbols();
+public:
+    // `threads` of 0 is one per hardware thread
+    VCompileServer(std::string socket_path, unsigned int threads=0);
+    ~VCompileServer();
+
+    VCompileServer(VCompileServer const&)=delete;
+    VCompileServer& operator=(VCompileServer const&)=delete;
+
+    // Fails if the socket can not be made or another server is listening on it, a socket left
+    // behind by one that is gone is replaced
+    bool listen();
+    // Accepts connections until stop() is called or a client asks the server to stop, then
+    // finishes the requests that were accepted
+    void serve();
+    // Safe to call from any thread
+    void stop();
+
+    std::uint64_t getRequestCount() const;
+};
+
+}
@@ -3,6 +3,9 @@ add_library(
 
     ${SRC_DIR}/src/vire/v_analyzer/analyzer.hpp
     ${SRC_DIR}/src/vire/v_analyzer/analyzer.cpp
+
+    ${SRC_DIR}/src/vire/v_analyzer/scope.hpp
 )
 
+target_link_libraries(vire-analyzer PRIVATE vire-proto-file)
 target_link_libraries(VIRELANG PRIVATE vire-analyzer)
\ No newline at end of file
@@ -5,61 +5,43 @@
 #include <memory>
 #include <vector>
 #include <algorithm>
+#include <sstream>
 
 namespace vire
 {
     bool VAnalyzer::isVariableDefined(const proto::IName& name)
     {
-        return scope.count(name.get());
+        return scope.contains(name.getSymbol());
     }
     bool VAnalyzer::isStructDefined(const std::string& name)
     {
         return types::isTypeinMap(name);
     }
-    bool VAnalyzer::isFunctionDefined(const std::string& name)
+    VAnalyzer::VAnalyzer(VAnalyzer* parent)
+    : builder(parent->builder), sources(parent->sources), type_context(parent->type_context), current_func(nullptr), current_struct(nullptr),
+      declarations(parent->declarations), visible_functions(SIZE_MAX), diagnostics(parent->diagnostics), thread_count(1)
+    {}
+
+    void VAnalyzer::setThreadCount(unsigned int count)
     {
-        const auto& functions=ast->getFunctions();
-        if(!functions.empty())
-        {
-            for(int i=0; i<functions.size(); ++i)
-                if(functions[i]->getIName().name==name)
-                    return true;
-        }
-        
-        const auto& constructors=ast->getConstructors();
-        if(!constructors.empty())
-        {
-            for(int i=0; i<constructors.size(); ++i)
-                if(constructors[i]->getIName().name==name)
-                    return true;
-        }
-        
-        return false;
+        thread_count=count;
+        pool.reset();
     }
-    bool VAnalyzer::isClassDefined(const std::string& name)
+
+    // Functions are keyed by their name alone and classes by the prefixed one, both interned
+    // when the name was set
+    bool VAnalyzer::isFunctionDefined(proto::IName const& name)
     {
-        const auto& classes=ast->getClasses();
-        if(!classes.empty())
-        {
-            for(int i=0; i<classes.size(); ++i)
-            {
-                if(classes[i]->getName()==name)
-                {
-                    return true;
-                }
-            }
-        }
-        return false;
+        return findFunction(name.getNameSymbol())!=nullptr;
+    }
+    bool VAnalyzer::isClassDefined(proto::IName const& name)
+    {
+        return declarations->classes.count(name.getSymbol());
     }
 
     void VAnalyzer::defineVariable(VariableDefAST* const var, bool is_arg)
     {
-        scope.insert(std::make_pair(var->getName(), var));
-        
-        if(scope_varref != nullptr)
-        {
-            scope_varref->push_back(var);
-        }
+        scope.define(var);
 
         if(is_arg) return;
         if(current_func != nullptr)
@@ -67,28 +49,49 @@ namespace vire
             current_func->addVariable(var);
         }
     }
-    void VAnalyzer::undefineVariable(VariableDefAST* const var)
-    {
-        undefineVariable(var->getIName());
-    }
-    void VAnalyzer::undefineVariable(proto::IName const& name)
-    {
-        scope.erase(name.get());
-    }
 
+    // The first declaration of a name is the one lookups find, same as the module's order
     void VAnalyzer::addConstructor(FunctionAST* func)
     {
+        declarations->constructors.emplace(func->getIName().getNameSymbol(), func);
         ast->addConstructor(func);
     }
     void VAnalyzer::addFunction(std::unique_ptr<FunctionBaseAST> func)
     {
+        declarations->function_indices.emplace(func->getIName().getNameSymbol(), declarations->functions.size());
+        declarations->functions.push_back(func.get());
         ast->addFunction(std::move(func));
     }
+    void VAnalyzer::addClass(std::unique_ptr<ClassAST> class_)
+    {
+        declarations->classes.emplace(class_->getIName().getSymbol(), class_.get());
+        ast->addClass(std::move(class_));
+    }
+    void VAnalyzer::addUnionStruct(std::unique_ptr<ExprAST> union_struct)
+    {
+        if(union_struct->asttype==ast_struct)
+        {
+            auto* st=(StructExprAST*)union_struct.get();
+            declarations->structs.emplace(st->getIName().getSymbol(), st);
+        }
+        ast->addUnionStruct(std::move(union_struct));
+    }
 
     ModuleAST* const VAnalyzer::getSourceModule()
     {
         return ast.get();
     }
+    void VAnalyzer::resetSourceModule()
+    {
+        // The scope and type tables point into the module, drop them before it goes away
+        scope.clear();
+        types.clear();
+        declarations->clear();
+        current_func=nullptr;
+        current_struct=nullptr;
+
+        ast.reset();
+    }
 
     FunctionBaseAST* const VAnalyzer::getFunction(const std::string& name)
     {
@@ -102,62 +105,45 @@ namespace vire
     {
         return getStruct(proto::IName(name, ""));
     }
-    FunctionBaseAST* const VAnalyzer::getFunction(const proto::IName& name)
+    FunctionBaseAST* VAnalyzer::findFunction(proto::Symbol name)
     {
-        const auto& functions=ast->getFunctions();
-        for(int i=0; i<functions.size(); i++)
-            if(functions[i]->getIName().name==name.name)
-                return functions[i].get();
+        auto func=declarations->function_indices.find(name);
+        if(func!=declarations->function_indices.end() && func->second<visible_functions)
+            return declarations->functions[func->second];
 
-        const auto& constructors=ast->getConstructors();
-        for(int i=0; i<constructors.size(); i++)
-            if(constructors[i]->getIName().name==name.name)
-                return constructors[i];
+        auto constructor=declarations->constructors.find(name);
+        if(constructor!=declarations->constructors.end())
+            return constructor->second;
 
+        return nullptr;
+    }
+    FunctionBaseAST* const VAnalyzer::getFunction(const proto::IName& name)
+    {
+        if(auto* func=findFunction(name.getNameSymbol()))
+            return func;
+
+        // The function being verified is only added once it is done, recursive calls and
+        // its return statements still have to find it
         if(current_func)
             if(current_func->getIName().name==name.name || name.name=="")
                 return current_func;
-        
-        std::cout << "Function `" << name << "` not found" << std::endl;
+
         return nullptr;
     }
     VariableDefAST* const VAnalyzer::getVariable(const proto::IName& name)
     {
-        if(!isVariableDefined(name))
-        {
-           std::cout << "Variable `" << name << "` not found" << std::endl;
-           return nullptr;
-        }
-        return scope.at(name.get());
+        return scope.find(name.getSymbol());
     }
     StructExprAST* const VAnalyzer::getStruct(const proto::IName& name)
     {
         if(!isStructDefined(name.get()))
-        {
-            std::cout << "Struct with name not defined: " << name << std::endl;
             return nullptr;
-        }
 
-        if(current_struct->getIName().name==name)
+        if(current_struct && current_struct->getIName().name==name)
             return current_struct;
 
-        auto const& structs=ast->getUnionStructs();
-        for(auto const& expr : structs)
-        {
-            if(expr->asttype==ast_struct)
-            {
-                auto* st=(StructExprAST*)expr.get();
-
-                if(st->getIName().name==name)
-                {
-                    return st;
-                }
-            }
-        }
-
-        std::cout << "Could not find struct with name: " << name << std::endl;
-
-        return nullptr;
+        auto it=declarations->structs.find(name.getSymbol());
+        return it==declarations->structs.end()?nullptr:it->second;
     }
     
     // !!- CHANGES REQUIRED -!!
@@ -235,7 +221,7 @@ namespace vire
                 return array_type;
             }
 
-            case ast_call: return getFunction(((CallExprAST*)expr)->getIName().name)->getReturnType();
+            case ast_call: return getFunction(((CallExprAST*)expr)->getIName())->getReturnType();
 
             case ast_array: return getType((ArrayExprAST*)expr);
 
@@ -261,7 +247,7 @@ namespace vire
 
             default:
             {
-                std::cout<<"Error: Unknown expr in getType()"<<std::endl;
+                out()<<"Error: Unknown expr in getType()"<<std::endl;
                 return nullptr;
             }
         }
@@ -272,23 +258,22 @@ namespace vire
     types::Base* VAnalyzer::getType(ArrayExprAST* const array)
     {
         const auto& vec=array->getElements();
-        auto type=types::copyType(getType(vec[0].get()));
+        auto* type=getType(vec[0].get());
 
         for(int i=0; i<vec.size(); ++i)
         {
             auto* new_type=getType(vec[i].get());
 
-            if(!types::isSame(type.get(), new_type))
+            if(!types::isSame(type, new_type))
             {
-                std::cout << "Error: Array element types do not match: " << *type << " " << *new_type << std::endl;
+                out() << "Error: Array element types do not match: " << *type << " " << *new_type << std::endl;
                 return nullptr;
             }
         }
         
         unsigned int len=((types::Array*)array->getType())->getLength();
 
-        auto type_uptr=std::make_unique<types::Array>(std::move(type), len);
-        array->setType(std::move(type_uptr));
+        array->setType(types::getContext().getArray(type, len));
 
         return array->getType();
     }
@@ -310,23 +295,20 @@ namespace vire
         bool types_are_arrays=(target->getType()==types::EType::Array || base->getType()==types::EType::Array);
         if(!types_are_user_defined && !types_are_arrays)
         {
-            auto src_type=types::copyType(base);
-            auto dst_type=types::copyType(target);
-
-            auto new_cast_value=std::make_unique<CastExprAST>(std::move(expr), std::move(dst_type), true);
-            new_cast_value->setSourceType(std::move(src_type));
+            auto new_cast_value=std::make_unique<CastExprAST>(std::move(expr), target, true);
+            new_cast_value->setSourceType(base);
 
             base=new_cast_value->getSourceType();
             target=new_cast_value->getDestType();
             
             if(base->getSize() > target->getSize())
             {
-                std::cout << "Warning: Analysis: Truncation, possible data loss while converting from "
+                out() << "Warning: Analysis: Truncation, possible data loss while converting from "
                 << *base << " to " << *target << std::endl;
             }
             else if(types::isTypeFloatingPoint(base) && !types::isTypeFloatingPoint(target))
             {
-                std::cout << "Warning: Analysis: Decimal (Floating point) to Integer, possible data loss while converting from "
+                out() << "Warning: Analysis: Decimal (Floating point) to Integer, possible data loss while converting from "
                 << *base << " to " << *target << std::endl;
             }
 
@@ -345,7 +327,7 @@ namespace vire
         if(!isVariableDefined(var->getIName()))
         {
             // Variable is not defined
-            std::cout << "Variable " << var->getName() << " not defined" << std::endl;
+            out() << "Variable " << var->getName() << " not defined" << std::endl;
             return false;
         }
         
@@ -372,7 +354,7 @@ namespace vire
     {
         if(var->getIName().name=="self")
         {
-            std::cout << "Cannot name variable `self` as it is a keyword" << std::endl;
+            out() << "Cannot name variable `self` as it is a keyword" << std::endl;
             return false;
         }
 
@@ -404,7 +386,7 @@ namespace vire
                 {
                     // Requires a variable for definiton
                     unsigned char islet = var->isLet() ? 1 : 0;
-                    // builder->addError<errortypes::analyze_requires_type>(this->code, islet, var->getName(), var->getLine(), var->getCharpos());
+                    // builder->addError<errortypes::analyze_requires_type>(*sources, islet, var->getName(), var->getLoc());
 
                     return false;
                 }
@@ -426,12 +408,12 @@ namespace vire
             bool is_auto=(type->getType()==types::EType::Void);
             if(is_auto && is_var)
             {
-                std::cout << "`any` type not implement yet" << std::endl;
+                out() << "`any` type not implement yet" << std::endl;
             }
             
             if(!verifyExpr(value))
             {
-                std::cout << "Variable definition's value is invalid" << std::endl;
+                out() << "Variable definition's value is invalid" << std::endl;
                 return false;
             }
             
@@ -445,7 +427,7 @@ namespace vire
                         
                     if(!new_cast_value)
                     {
-                        std::cout << "Error: VarDef Type Mismatch: " << *type << " and " << *value_type << std::endl;
+                        out() << "Error: VarDef Type Mismatch: " << *type << " and " << *value_type << std::endl;
                         return false;
                     }
                     else
@@ -454,9 +436,7 @@ namespace vire
             }
             else
             {
-                auto value_type_uptr=types::copyType(value_type);
-
-                var->getValue()->setType(std::move(value_type_uptr));
+                var->getValue()->setType(value_type);
                 var->setUseValueType(true);
             }
             
@@ -466,7 +446,7 @@ namespace vire
             return true;
         }
         
-        std::cout << "Variable " << var->getName() << " is already defined" << std::endl;
+        out() << "Variable " << var->getName() << " is already defined" << std::endl;
 
         // Variable is already defined
         return false;
@@ -494,7 +474,7 @@ namespace vire
 
             if(!cast)
             {
-                std::cout << "Error: Assigment: Variable and Value types do not match" << std::endl;
+                out() << "Error: Assigment: Variable and Value types do not match" << std::endl;
                 return false;
             }
             else
@@ -503,8 +483,8 @@ namespace vire
             }
         }
 
-        assign->getLHS()->setType(types::copyType(lhs_type));
-        assign->getRHS()->setType(types::copyType(rhs_type));
+        assign->getLHS()->setType(lhs_type);
+        assign->getRHS()->setType(rhs_type);
         
         return is_valid;
     }
@@ -521,7 +501,7 @@ namespace vire
         
         if(type->getType()!=types::EType::Array)
         {
-            std::cout << "Error: Variable is not an array" << std::endl;
+            out() << "Error: Variable is not an array" << std::endl;
             return false;
         }
         else
@@ -529,7 +509,7 @@ namespace vire
             auto* array_type=(types::Array*)type;
             if(indices.size()!=array_type->getDepth())
             {
-                std::cout << "Error: Array index mismatch" << std::endl;
+                out() << "Error: Array index mismatch" << std::endl;
                 return false;
             }
             else
@@ -549,14 +529,14 @@ namespace vire
                             auto* index_cast=(IntExprAST*)index.get();
                             if(index_cast->getValue() >= child_array_type->getLength())
                             {
-                                std::cout << "Error: Array index out of bounds" << std::endl;
+                                out() << "Error: Array index out of bounds" << std::endl;
                                 return false;
                             } 
                         }
                     }
                     else
                     {
-                        std::cout << "Error: Array index is not of type integer, but is " << *index_type << std::endl;
+                        out() << "Error: Array index is not of type integer, but is " << *index_type << std::endl;
                         return false;
                     }
 
@@ -566,8 +546,8 @@ namespace vire
         }
         
         auto* array_ty=(types::Array*)type;
-        access->setType(types::copyType(array_ty->getChild()));
-        access->getExpr()->setType(types::copyType(array_ty));
+        access->setType(array_ty->getChild());
+        access->getExpr()->setType(array_ty);
 
         return true;
     }
@@ -590,11 +570,8 @@ namespace vire
                 return false;
             }
         }
-        
-        std::size_t elem_size=array->getElements()[0]->getType()->getSize();
-        std::size_t size=elem_size*elems.size();
-        array->getType()->setSize(size);
 
+        // The array's type, and with it its size, is settled in getType once the element type is known
         return true;
     }
     bool VAnalyzer::verifyCastExpr(CastExprAST* const cast)
@@ -602,7 +579,7 @@ namespace vire
         if(!verifyExpr(cast->getExpr()))
             return false;
         auto* ty=getType(cast->getExpr());
-        cast->setSourceType(types::copyType(ty));
+        cast->setSourceType(ty);
         
         return true;
     }
@@ -684,7 +661,8 @@ namespace vire
     bool VAnalyzer::verifyCall(CallExprAST* const call)
     {
         bool is_valid=true;
-        auto name=call->getIName().name;
+        auto const& iname=call->getIName();
+        auto const& name=iname.name;
 
         bool is_recursive_call=false;
         if(current_func)
@@ -695,27 +673,27 @@ namespace vire
             }
         }
 
-        if(!isFunctionDefined(name) && !is_recursive_call)
+        if(!isFunctionDefined(iname) && !is_recursive_call)
         {
-            std::cout << "Function `" << name << "` is not defined" << std::endl;
+            out() << "Function `" << name << "` is not defined" << std::endl;
             // Function is not defined
             return false;
         }
 
         if(name == "main")
         {
-            std::cout << "Verification Error: Cannot call the main function, it is an entry point" << std::endl;
+            out() << "Verification Error: Cannot call the main function, it is an entry point" << std::endl;
             is_valid=false;
         }
 
         auto args=call->moveArgs();
-        const auto* func=getFunction(name);
+        const auto* func=getFunction(iname);
         const auto& func_args=func->getArgs();
 
         if(args.size() != (func_args.size()-func->doesRequireSelfRef()))
         {
             // Argument count mismatch
-            std::cout << "Call arg count mismatch" << std::endl;
+            out() << "Call arg count mismatch" << std::endl;
             is_valid=false;
         }
 
@@ -726,7 +704,7 @@ namespace vire
             if(!verifyExpr(arg.get()))
             {
                 // Argument is not valid
-                std::cout << "Call argument is not valid" << std::endl;
+                out() << "Call argument is not valid" << std::endl;
                 is_valid=false;
                 continue;
             }
@@ -739,7 +717,7 @@ namespace vire
 
                 if(!cast)
                 {
-                    std::cout << "Error: Function call type mismatch, " << *func_args[i]->getType() << " : " << *arg_type << std::endl;
+                    out() << "Error: Function call type mismatch, " << *func_args[i]->getType() << " : " << *arg_type << std::endl;
                     is_valid=false;
                 }
                 else
@@ -747,7 +725,7 @@ namespace vire
                     arg=std::move(cast);
                 }
             }
-            arg->setType(types::copyType(arg_type));
+            arg->setType(arg_type);
 
             args[i]=std::move(arg);
         }
@@ -757,14 +735,14 @@ namespace vire
             call->setArgs(std::move(args));
         }
 
-        call->setType(types::copyType(func->getReturnType()));
+        call->setType(func->getReturnType());
 
         return is_valid;
     }
 
     bool VAnalyzer::verifyReturn(ReturnExprAST* const ret)
     {
-        auto* func=(FunctionAST*)getFunction(ret->getIName().name);
+        auto* func=(FunctionAST*)getFunction(ret->getIName());
         auto* ret_type=func->getReturnType();
 
         if(!verifyExpr(ret->getValue()))
@@ -780,7 +758,7 @@ namespace vire
 
             if(!cast)
             {
-                std::cout << "Error: Return type mismatch, " << *ret_expr_type << " : " << *ret_type << std::endl;
+                out() << "Error: Return type mismatch, " << *ret_expr_type << " : " << *ret_type << std::endl;
                 return false;
             }
             else
@@ -796,7 +774,7 @@ namespace vire
             getVariable(var_name)->isReturned(true);
         }
 
-        ret->getValue()->setType(types::copyType(ret_expr_type));
+        ret->getValue()->setType(ret_expr_type);
 
         return true;
     }
@@ -824,8 +802,8 @@ namespace vire
             auto* left_type=getType(left);
             auto* right_type=getType(right);
 
-            left->setType(types::copyType(left_type));
-            right->setType(types::copyType(right_type));
+            left->setType(left_type);
+            right->setType(right_type);
 
             left_type=left->getType();
             right_type=right->getType();
@@ -856,7 +834,7 @@ namespace vire
                 }
             }
 
-            binop->setType(types::copyType(binop->getLHS()->getType()));
+            binop->setType(binop->getLHS()->getType());
         }
 
         return is_valid;
@@ -878,7 +856,7 @@ namespace vire
     {
         bool is_valid=true;
 
-        if(isFunctionDefined(proto->getIName().name))
+        if(isFunctionDefined(proto->getIName()))
         {
             // Function is already defined
             return false;
@@ -886,7 +864,7 @@ namespace vire
 
         if(types::isSame(proto->getReturnType(), "any") /*|| types::isSame(proto->getReturnType(), "auto")*/)
         {
-            std::cout << "Function type cannot be `" << *proto->getReturnType() << "`" << std::endl;
+            out() << "Function type cannot be `" << *proto->getReturnType() << "`" << std::endl;
             // Type is not valid
             is_valid=false;
         }
@@ -902,7 +880,7 @@ namespace vire
                 }
                 else
                 {
-                    std::cout << "Prototype's return type is a non-defined struct" << std::endl;
+                    out() << "Prototype's return type is a non-defined struct" << std::endl;
                 }
             }
         }
@@ -917,12 +895,12 @@ namespace vire
                 // Type is not valid
                 is_valid=false;
                 
-                std::cout << "Type cannot be `auto` or `any`" << std::endl;
+                out() << "Type cannot be `auto` or `any`" << std::endl;
             }
 
             if(!verifyVariableDefinition(arg.get(), false))
             {
-                std::cout << "Verification Error: Function Prototype argument is not valid" << std::endl;
+                out() << "Verification Error: Function Prototype argument is not valid" << std::endl;
 
                 // Argument is not valid
                 is_valid=false;
@@ -963,8 +941,22 @@ namespace vire
             // Prototype is not valid
             is_valid=false;
         }
-        func->setReturnType(types::copyType(func->getProto()->getReturnType()));
+        func->setReturnType(func->getProto()->getReturnType());
+
+        if(!verifyFunctionBody(func))
+        {
+            // Body is not valid
+            is_valid=false;
+        }
 
+        return is_valid;
+    }
+    bool VAnalyzer::verifyFunctionBody(FunctionAST* const func)
+    {
+        bool is_valid=true;
+
+        // The arguments get a frame of their own around the body's
+        scope.pushFrame();
         for(auto const& var: func->getArgs())
         {
             defineVariable(var.get(), true);
@@ -979,8 +971,8 @@ namespace vire
         for(auto const& var: func->getArgs())
         {
             func->addVariable(var.get());
-            undefineVariable(var.get());
         }
+        scope.popFrame();
 
         return is_valid;
     }
@@ -989,21 +981,21 @@ namespace vire
     {
         bool is_valid=true;
 
-        std::map<std::string, VariableDefAST*> scope;
+        std::unordered_map<proto::Symbol, VariableDefAST*> scope;
 
         for(auto* expr: body)
         {
             if(expr->asttype==ast_vardef)
             {
                 auto* var=(VariableDefAST*)expr;
-                if(scope.count(var->getName())>0)
+                if(scope.count(var->getIName().getSymbol())>0)
                 {
-                    std::cout << "Redeclaration of variable in struct" << std::endl;
+                    out() << "Redeclaration of variable in struct" << std::endl;
                     is_valid=false;
                 }
                 else
                 {
-                    scope.insert(std::make_pair(var->getName(),var));
+                    scope.insert(std::make_pair(var->getIName().getSymbol(),var));
                 }
             }
             else if(expr->asttype==ast_struct)
@@ -1011,9 +1003,9 @@ namespace vire
                 auto* struct_=(StructExprAST*)expr;
                 struct_->setName("_"+struct_->getName());
 
-                if(scope.count(struct_->getName())>0)
+                if(scope.count(struct_->getIName().getSymbol())>0)
                 {
-                    std::cout << "Redeclaration of struct-variable in struct" << std::endl;
+                    out() << "Redeclaration of struct-variable in struct" << std::endl;
                     is_valid=false;
                 }
                 if(!verifyUnionStructBody(struct_->getMembersValues()))
@@ -1028,16 +1020,16 @@ namespace vire
                     size+=member->getType()->getSize();
                 }
 
-                struct_->getType()->setSize(size);
+                struct_->setType(types::getContext().getCustom(struct_->getName(), size));
             }
             else if(expr->asttype==ast_union)
             {
                 auto* union_=(UnionExprAST*)expr;
                 union_->setName("_"+union_->getName());
 
-                if(scope.count(union_->getName())>0)
+                if(scope.count(union_->getIName().getSymbol())>0)
                 {
-                    std::cout << "Redeclaration of union-variable in struct" << std::endl;
+                    out() << "Redeclaration of union-variable in struct" << std::endl;
                     is_valid=false;
                 }
                 if(!verifyUnionStructBody(union_->getMembersValues()))
@@ -1089,23 +1081,25 @@ namespace vire
         }
         else
         {
-            std::cout << "Struct `" << st_name << "` already defined" << std::endl;
+            out() << "Struct `" << st_name << "` already defined" << std::endl;
             is_valid=false;
         }
-        auto struct_ty=types::construct(st_name, true);
+        auto* struct_ty=types::construct(st_name, true);
 
+        // Set up front, function bodies verified in parallel only ever read it
+        struct_->setType(struct_ty);
         current_struct=struct_;
 
         if(auto* constructor=struct_->getConstructor())
         {
             constructor->isConstructor(true);
             constructor->doesRequireSelfRef(true);
-            constructor->setReturnType(types::copyType(struct_ty.get()));
+            constructor->setReturnType(struct_ty);
             constructor->setName(proto::IName(struct_->getIName().name, "struct_construct_"));
             
-            auto self_ref=std::make_unique<VariableDefAST>(VToken::construct("self", tok_id), types::copyType(struct_ty.get()), nullptr);
+            // `self` is the first argument, verifyFunction brings it into scope with the others
+            auto self_ref=std::make_unique<VariableDefAST>(VToken("self", tok_id, struct_->getLoc()), struct_ty, nullptr);
             self_ref->isArgument(true);
-            defineVariable(self_ref.get(), true);
             constructor->getModifyableArgs().insert(constructor->getArgs().begin(), std::move(self_ref));
 
             current_func=constructor;
@@ -1113,14 +1107,12 @@ namespace vire
             {
                 is_valid=false;
             }
-        
-            undefineVariable(self_ref->getIName());
         }
         else
         {
             // Create a default constructor //
 
-            auto st_iname=struct_->getIName();
+            auto const& st_iname=struct_->getIName();
             auto func_name=proto::IName(st_iname.name, "struct_construct_");
             constexpr const char* self_ref_name="self";
 
@@ -1131,7 +1123,7 @@ namespace vire
 
             // Create the args
             std::unique_ptr<ExprAST> empty_val;
-            auto vardef=std::make_unique<VariableDefAST>(VToken::construct("", tok_id), types::copyType(struct_ty.get()), std::move(empty_val), false, true);
+            auto vardef=std::make_unique<VariableDefAST>(VToken("", tok_id, struct_->getLoc()), struct_ty, std::move(empty_val), false, true);
             vardef->setName(proto::IName(self_ref_name, ""));
             vardef->isArgument(true);
             vars.push_back(vardef.get());
@@ -1143,12 +1135,12 @@ namespace vire
                 if(member->asttype==ast_struct)
                 {
                     auto* st=(StructExprAST*)member;
-                    arg=std::make_unique<VariableDefAST>(VToken::construct(st->getIName().name, tok_id), types::construct(st->getName(), true), std::move(empty_val));
+                    arg=std::make_unique<VariableDefAST>(VToken(st->getIName().name, tok_id, struct_->getLoc()), types::construct(st->getName(), true), std::move(empty_val));
                 }
                 else if(member->asttype==ast_vardef)
                 {
                     auto* var=(VariableDefAST*)member;
-                    arg=std::make_unique<VariableDefAST>(VToken::construct(var->getIName().name, tok_id), types::copyType(var->getType()), std::move(empty_val));
+                    arg=std::make_unique<VariableDefAST>(VToken(var->getIName().name, tok_id, struct_->getLoc()), var->getType(), std::move(empty_val));
                 }
 
                 arg->isArgument(true);
@@ -1159,30 +1151,31 @@ namespace vire
             // Create the body
             for(auto const& member : members)
             {
-                std::string member_name;
+                // Views into the member's name, tokens do not own their text
+                std::string_view member_name;
 
                 if(member->asttype==ast_struct)
                     member_name=((StructExprAST*)member)->getIName().name;
                 else if(member->asttype==ast_vardef)
                     member_name=((VariableDefAST*)member)->getIName().name;
 
-                auto self_ref=std::make_unique<VariableExprAST>(VToken::construct("", tok_id));
+                auto self_ref=std::make_unique<VariableExprAST>(VToken("", tok_id, struct_->getLoc()));
                 self_ref->setName(proto::IName(self_ref_name, ""));
-                self_ref->setType(types::copyType(struct_ty.get()));
-                auto mem=std::make_unique<VariableExprAST>(VToken::construct(member_name, tok_id));
-                mem->setType(types::copyType(member->getType()));
+                self_ref->setType(struct_ty);
+                auto mem=std::make_unique<VariableExprAST>(VToken(member_name, tok_id, struct_->getLoc()));
+                mem->setType(member->getType());
 
                 auto lhs=std::make_unique<TypeAccessAST>(std::move(self_ref), std::move(mem));
-                lhs->setType(types::copyType(member->getType()));
+                lhs->setType(member->getType());
                 
-                auto rhs=std::make_unique<VariableExprAST>(VToken::construct(member_name, tok_id));
-                rhs->setType(types::copyType(member->getType()));
+                auto rhs=std::make_unique<VariableExprAST>(VToken(member_name, tok_id, struct_->getLoc()));
+                rhs->setType(member->getType());
 
                 new_constructor_body.push_back(std::make_unique<VariableAssignAST>(std::move(lhs), std::move(rhs)));
             }
 
             // Set the constructor
-            auto new_constructor_proto=std::make_unique<PrototypeAST>(VToken::construct(st_iname.name), std::move(args), types::copyType(struct_ty.get()));
+            auto new_constructor_proto=std::make_unique<PrototypeAST>(VToken::construct(st_iname.name), std::move(args), struct_ty);
             auto new_constructor=std::make_unique<FunctionAST>(std::move(new_constructor_proto), std::move(new_constructor_body));
 
             new_constructor->setName(func_name);
@@ -1208,18 +1201,18 @@ namespace vire
         auto* ptype=getType(access->getParent());
         if(ptype->getType() != types::EType::Custom)
         {
-            std::cout << "Parent is not a type" << std::endl;
+            out() << "Parent is not a type" << std::endl;
             return false;
         }
         
         auto* ptype_custom=(types::Custom*)ptype;
         if(!types::isTypeinMap(ptype_custom->getName()))
         {
-            std::cout << "Type " << *ptype_custom << " is not defined" << std::endl;
+            out() << "Type " << *ptype_custom << " is not defined" << std::endl;
             return false;
         }
 
-        access->getParent()->setType(types::copyType(ptype_custom));
+        access->getParent()->setType(ptype_custom);
         st=getStruct(ptype_custom->getName());
 
         IdentifierExprAST* possible_access=access;
@@ -1232,7 +1225,7 @@ namespace vire
 
             if(possible_struct_child->asttype!=ast_struct)
             {
-                std::cout << "The type is not a struct" << std::endl;
+                out() << "The type is not a struct" << std::endl;
                 is_valid=false;
                 break;
             }
@@ -1241,26 +1234,30 @@ namespace vire
 
             if(!casted_pos_stchild->isMember(child->getIName()))
             {
-                std::cout << "No member as `" << child->getIName().name << "` in struct `" << casted_pos_stchild->getName() << "`." << std::endl;
+                out() << "No member as `" << child->getIName().name << "` in struct `" << casted_pos_stchild->getName() << "`." << std::endl;
                 is_valid=false;
                 break;
             }
             else
             {
-                possible_struct_child->setType(std::make_unique<types::Custom>(casted_pos_stchild->getName(), 1));
-                casted_pos_access->getParent()->setType(std::make_unique<types::Custom>(casted_pos_stchild->getName(), 1));
+                // The struct is shared by every function body, it already has its type unless
+                // this is the constructor being verified along with it
+                auto* st_type=types::getContext().getCustom(casted_pos_stchild->getName(), 1);
+                if(possible_struct_child->getType()!=st_type)
+                    possible_struct_child->setType(st_type);
+                casted_pos_access->getParent()->setType(st_type);
                 possible_access=child->getChild();
                 possible_struct_child=casted_pos_stchild->getMember(child->getIName());
             }
         }
 
         // Set the type for the tail of the access
-        possible_access->setType(types::copyType(possible_struct_child->getType()));
+        possible_access->setType(possible_struct_child->getType());
 
         if(is_valid)
         {
             auto* type=getType(access);
-            access->setType(types::copyType(type));
+            access->setType(type);
         }
 
         return is_valid;
@@ -1276,12 +1273,12 @@ namespace vire
 
         if(cond_type->getType()!=types::EType::Bool)
         {
-            auto bool_type=types::construct(types::EType::Bool);
-            auto cast=tryCreateImplicitCast(bool_type.get(), cond_type, if_then->moveCondition());
+            auto* bool_type=types::construct(types::EType::Bool);
+            auto cast=tryCreateImplicitCast(bool_type, cond_type, if_then->moveCondition());
 
             if(!cast)
             {
-                std::cout << "Condition needs to be of a boolean type or a numeric type";
+                out() << "Condition needs to be of a boolean type or a numeric type";
                 is_valid=false;
             }
             else
@@ -1358,7 +1355,7 @@ namespace vire
 
     bool VAnalyzer::verifyClass(ClassAST* const cls)
     {
-        if(isClassDefined(cls->getName()))
+        if(isClassDefined(cls->getIName()))
         {
             // Class is already defined
             return false;
@@ -1412,26 +1409,24 @@ namespace vire
 
     bool VAnalyzer::verifyBlock(std::vector<std::unique_ptr<ExprAST>> const& block)
     {
-        auto refscope=std::vector<VariableDefAST*>();
-        this->scope_varref=&refscope;
+        // Variables defined in the block go out of scope with its frame
+        scope.pushFrame();
 
+        bool is_valid=true;
         for(auto const& expr : block)
         {
             auto* ptr=expr.get();
             if(!verifyExpr(ptr))
             {
                 // Expr is not valid
-                return false;
+                is_valid=false;
+                break;
             }
         }
-        for(const auto& var : refscope)
-        {
-            undefineVariable(var);
-        }
 
-        this->scope_varref=nullptr;
+        scope.popFrame();
         
-        return true;
+        return is_valid;
     }
 
     bool VAnalyzer::verifySourceModule(std::unique_ptr<ModuleAST> code)
@@ -1444,7 +1439,14 @@ namespace vire
         bool is_valid=true;
         ast=std::move(code);
 
+        // Nodes created while verifying (implicit casts, copied types) join the module's arena
+        proto::ArenaScope arena_scope(ast->getArena());
+        types::TypeContextScope type_scope(type_context);
+
         auto classes=ast->moveClasses();
+        for(auto& cls : classes)
+            addClass(std::move(cls));
+
         auto funcs=ast->moveFunctions();
         auto union_structs=ast->moveUnionStructs();
         auto pre_stms=ast->movePreExecutionStatements();
@@ -1474,10 +1476,12 @@ namespace vire
                 }
             }
 
-            ast->addUnionStruct(std::move(union_structs[it]));
+            addUnionStruct(std::move(union_structs[it]));
         }
 
-        // Verify all functions
+        // Verify all function signatures, the bodies only read declarations from then on and
+        // are verified afterwards, independently of each other
+        std::vector<std::pair<FunctionAST*, std::size_t>> bodies;
         for(unsigned int it=0; it<funcs.size(); ++it)
         {
             const auto& func=funcs[it];
@@ -1502,11 +1506,13 @@ namespace vire
             {
                 auto const& casted_func=((std::unique_ptr<FunctionAST>const&)func).get();
                 current_func=casted_func;
-                if(!verifyFunction(casted_func))
+                if(!verifyPrototype(casted_func->getProto()))
                 {
-                    // Function is not valid
+                    // Prototype is not valid
                     is_valid=false;
                 }
+                casted_func->setReturnType(casted_func->getProto()->getReturnType());
+                bodies.push_back(std::make_pair(casted_func, declarations->functions.size()));
 
                 if(casted_func->getName()=="main")
                 {
@@ -1517,11 +1523,16 @@ namespace vire
         
             addFunction(std::move(funcs[it]));
         }
+        current_func=nullptr;
+
+        if(!verifyFunctionBodies(bodies))
+        {
+            // A function body is not valid
+            is_valid=false;
+        }
 
         // Verify all statements in global scope
-        current_func=nullptr;
-        auto global_refscope=std::vector<VariableDefAST*>();
-        this->scope_varref=&global_refscope;
+        scope.pushFrame();
         for(const auto& expr : pre_stms)
         {
             if(!verifyExpr(expr.get()))
@@ -1529,15 +1540,63 @@ namespace vire
                 is_valid=false;
             }
         }
-        this->scope_varref=nullptr;
 
         ast->addPreExecutionStatements(std::move(pre_stms));
-        ast->addPreExecutionStatementVariables(global_refscope);
+        ast->addPreExecutionStatementVariables(scope.frame());
+        scope.popFrame();
         ast->addConstructors(constructors);
 
         return is_valid;
     }
 
+    bool VAnalyzer::verifyFunctionBodies(std::vector<std::pair<FunctionAST*, std::size_t>> const& bodies)
+    {
+        bool parallel=thread_count!=1 && bodies.size()>=parallel_threshold;
+        if(parallel && !pool)
+            pool=std::make_unique<proto::ThreadPool>(thread_count);
+        unsigned int worker_count=parallel?pool->size():1;
+
+        // Every worker has its own scope and arena, diagnostics are buffered per body so that
+        // they come out in module order however the bodies were scheduled
+        std::vector<std::unique_ptr<VAnalyzer>> workers;
+        std::vector<std::unique_ptr<proto::Arena>> arenas;
+        for(unsigned int i=0; i<worker_count; ++i)
+        {
+            workers.push_back(std::unique_ptr<VAnalyzer>(new VAnalyzer(this)));
+            arenas.push_back(parallel?std::make_unique<proto::Arena>():nullptr);
+        }
+
+        std::vector<std::ostringstream> logs(parallel?bodies.size():0);
+        std::vector<char> results(bodies.size());
+
+        auto verify=[&](std::size_t task, unsigned int worker_indx)
+        {
+            auto& worker=*workers[worker_indx];
+            proto::ArenaScope arena_scope(parallel?arenas[worker_indx].get():ast->getArena());
+            types::TypeContextScope type_scope(type_context);
+
+            auto [func, indx]=bodies[task];
+            worker.diagnostics=parallel?&logs[task]:diagnostics;
+            worker.current_func=func;
+            worker.visible_functions=indx;
+            results[task]=worker.verifyFunctionBody(func);
+        };
+
+        if(parallel)
+            pool->forEach(bodies.size(), verify);
+        else
+            for(std::size_t i=0; i<bodies.size(); ++i)
+                verify(i, 0);
+
+        for(auto const& log : logs)
+            out() << log.str();
+        for(auto& arena : arenas)
+            if(arena)
+                ast->adoptArena(std::move(arena));
+
+        return std::find(results.begin(), results.end(), false)==results.end();
+    }
+
     bool VAnalyzer::verifyExpr(ExprAST* const expr)
     {
         switch(expr->asttype)
@@ -3,7 +3,15 @@
 #include "vire/parse/include.hpp"
 #include "vire/ast/include.hpp"
 #include "vire/errors/include.hpp"
+#include "vire/proto/symbol.hpp"
 #include "vire/proto/iname.hpp"
+#include "vire/proto/source.hpp"
+#include "vire/proto/arena.hpp"
+#include "vire/proto/thread_pool.hpp"
+
+#include <ostream>
+
+#include "scope.hpp"
 
 namespace vire
 {
@@ -20,49 +28,96 @@ class VAnalyzer
     errors::ErrorBuilder* const builder;
 
     // Source Code
-    std::string code;
+    proto::SourceManager const* sources;
+
+    // Types of the compilation, shared with the parser and the compiler
+    types::TypeContext* type_context;
 
     // Scope Stack
-    std::map<std::string, VariableDefAST*> scope;
-    std::vector<VariableDefAST*>* scope_varref;
+    VScope scope;
 
     // Type Stack
     std::map<std::string, ExprAST*> types;
 
+    // Declarations of the module, indexed by name as they are added to it. Functions keep
+    // their module order, the body of a function only sees the functions declared before it
+    struct Declarations
+    {
+        std::vector<FunctionBaseAST*> functions;
+        std::unordered_map<proto::Symbol, std::size_t> function_indices;
+        std::unordered_map<proto::Symbol, FunctionAST*> constructors;
+        std::unordered_map<proto::Symbol, StructExprAST*> structs;
+        std::unordered_map<proto::Symbol, ClassAST*> classes;
+
+        void clear()
+        {
+            functions.clear();
+            function_indices.clear();
+            constructors.clear();
+            structs.clear();
+            classes.clear();
+        }
+    };
+    Declarations own_declarations;
+    // The declarations lookups go to, workers share their parent's
+    Declarations* declarations;
+    // How many of the module's functions are visible, all of them outside of a function body
+    std::size_t visible_functions;
+
+    // Where diagnostics go, a worker's are collected per function body
+    std::ostream* diagnostics;
+
+    // Function bodies are verified on `pool` when a module has at least `parallel_threshold`
+    static constexpr std::size_t parallel_threshold=32;
+    unsigned int thread_count;
+    std::unique_ptr<proto::ThreadPool> pool;
+
+    // Worker - An analyzer that verifies function bodies for `parent`, with its own scope
+    explicit VAnalyzer(VAnalyzer* parent);
+
     // Functions
+    std::ostream& out() { return *diagnostics; }
+
     void defineVariable(VariableDefAST* const var, bool is_arg=false);
-    void undefineVariable(VariableDefAST* const var);
-    void undefineVariable(proto::IName const& var);
+    FunctionBaseAST* findFunction(proto::Symbol name);
 
     void addFunction(std::unique_ptr<FunctionBaseAST> func);
     void addConstructor(FunctionAST* constructor);
     void addClass(std::unique_ptr<ClassAST> class_);
+    void addUnionStruct(std::unique_ptr<ExprAST> union_struct);
     bool isVariableDefined(proto::IName const& name);
 
     VariableDefAST* const getVariable(std::string const& name);
     VariableDefAST* const getVariable(proto::IName const& name);
 public:
-    VAnalyzer(errors::ErrorBuilder* const builder, std::string const& code="")
-    : builder(builder), code(code), scope_varref(nullptr), current_func(nullptr), current_struct(nullptr) {}
+    VAnalyzer(errors::ErrorBuilder* const builder, proto::SourceManager const* sources=nullptr, types::TypeContext* type_context=nullptr)
+    : builder(builder), sources(sources), type_context(type_context), current_func(nullptr), current_struct(nullptr),
+      declarations(&own_declarations), visible_functions(SIZE_MAX), diagnostics(&std::cout), thread_count(0) {}
+
+    // 0 uses a thread per hardware thread, 1 verifies everything on the calling thread
+    void setThreadCount(unsigned int count);
 
     errors::ErrorBuilder* const getErrorBuilder() const { return builder; }
+    types::TypeContext* const getTypeContext() const { return type_context; }
+    proto::SourceManager const* const getSourceManager() const { return sources; }
 
     bool isStructDefined(std::string const& name);
     bool isUnionDefined(std::string const& name);
-    bool isClassDefined(std::string const& name);
-    bool isFunctionDefined(std::string const& name);
+    bool isClassDefined(proto::IName const& name);
+    bool isFunctionDefined(proto::IName const& name);
     unsigned int getFunctionArgCount(std::string const& name);
 
     types::Base* getType(ExprAST* const expr);
     types::Base* getType(ArrayExprAST* const arr);
-    std::unique_ptr<types::Base> moveFuncReturnType(const std::string& name="");
 
+    // Lookups return nullptr when nothing by that name is defined, reporting it is up to the caller
     FunctionBaseAST* const getFunction(const std::string& name);
     StructExprAST* const getStruct(const std::string& name);
     FunctionBaseAST* const getFunction(const proto::IName& name);
     StructExprAST* const getStruct(const proto::IName& name);
 
     ModuleAST* const getSourceModule();
+    void resetSourceModule();
 
     ///- Verification functions -///
     ReturnExprAST* const getReturnStatement(std::vector<std::unique_ptr<ExprAST>> const& block);
@@ -96,6 +151,8 @@ public:
     bool verifyProto(PrototypeAST* const proto);
     bool verifyExtern(ExternAST* const extern_);
     bool verifyFunction(FunctionAST* const func);
+    bool verifyFunctionBody(FunctionAST* const func);
+    bool verifyFunctionBodies(std::vector<std::pair<FunctionAST*, std::size_t>> const& bodies);
     bool verifyReturn(ReturnExprAST* const return_);
 
     // Operator and Cast verifications
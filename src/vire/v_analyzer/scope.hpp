@@ -0,0 +1,64 @@
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+
+#include "vire/ast/include.hpp"
+#include "vire/proto/symbol.hpp"
+
+namespace vire
+{
+
+// VScope - The variables visible while verifying, as a stack of frames over one hash table.
+// Every block pushes a frame and the variables defined in it go out of scope when it is popped,
+// so a lookup is a single probe however deeply the blocks nest
+class VScope
+{
+    std::unordered_map<proto::Symbol, VariableDefAST*> symbols;
+    std::vector<std::vector<VariableDefAST*>> frames;
+public:
+    void pushFrame()
+    {
+        frames.emplace_back();
+    }
+    void popFrame()
+    {
+        for(auto* var : frames.back())
+            symbols.erase(var->getIName().getSymbol());
+        frames.pop_back();
+    }
+    // The variables defined in the innermost frame, in definition order
+    std::vector<VariableDefAST*> const& frame() const
+    {
+        return frames.back();
+    }
+
+    // Returns false, and leaves the visible definition alone, if the name is already taken
+    bool define(VariableDefAST* const var)
+    {
+        if(!symbols.emplace(var->getIName().getSymbol(), var).second)
+            return false;
+
+        if(!frames.empty())
+            frames.back().push_back(var);
+        return true;
+    }
+
+    bool contains(proto::Symbol name) const
+    {
+        return symbols.count(name)>0;
+    }
+    VariableDefAST* find(proto::Symbol name) const
+    {
+        auto it=symbols.find(name);
+        return it==symbols.end()?nullptr:it->second;
+    }
+
+    void clear()
+    {
+        symbols.clear();
+        frames.clear();
+    }
+};
+
+}
@@ -3,6 +3,11 @@ add_library(
 
     ${SRC_DIR}/src/vire/v_compiler/codegen.hpp
     ${SRC_DIR}/src/vire/v_compiler/codegen.cpp
+    ${SRC_DIR}/src/vire/v_compiler/cache.hpp
+    ${SRC_DIR}/src/vire/v_compiler/cache.cpp
+    ${SRC_DIR}/src/vire/v_compiler/session.hpp
+    ${SRC_DIR}/src/vire/v_compiler/session.cpp
 )
 
+target_link_libraries(vire-compiler PRIVATE vire-proto-file)
 target_link_libraries(VIRELANG PRIVATE vire-compiler)
\ No newline at end of file
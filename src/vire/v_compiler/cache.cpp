@@ -0,0 +1,139 @@
+#include "cache.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <utility>
+
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/FileUtilities.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "vire/proto/hash.hpp"
+
+#ifndef VIRE_VERSION
+#define VIRE_VERSION "unknown"
+#endif
+
+namespace vire
+{
+    static char const* const object_extension=".o";
+
+    VObjectCache::VObjectCache(std::filesystem::path directory, std::uintmax_t max_size)
+    : directory(std::move(directory)), max_size(max_size), hits(0), misses(0)
+    {
+        std::error_code ec;
+        std::filesystem::create_directories(this->directory, ec);
+    }
+
+    std::string VObjectCache::makeKey(std::string_view source, std::string_view triple, std::string_view cpu,
+        Optimization opt_level, bool enable_lto)
+    {
+        return proto::hashParts({VIRE_VERSION, LLVM_VERSION_STRING, triple, cpu, std::to_string((int)opt_level),
+            enable_lto?"lto":"", source});
+    }
+
+    std::filesystem::path VObjectCache::getPath(std::string const& key) const
+    {
+        return directory/(key+object_extension);
+    }
+
+    bool VObjectCache::lookup(std::string const& key, std::vector<unsigned char>& object)
+    {
+        auto path=getPath(key);
+        std::ifstream file(path, std::ios::binary);
+        if(!file)
+        {
+            ++misses;
+            return false;
+        }
+
+        object.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        if(file.bad())
+        {
+            ++misses;
+            return false;
+        }
+
+        // The modification time is when an entry was last used, that is what eviction goes by
+        std::error_code ec;
+        std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), ec);
+
+        ++hits;
+        return true;
+    }
+    bool VObjectCache::store(std::string const& key, std::vector<unsigned char> const& object)
+    {
+        auto path=getPath(key);
+        auto temporary=directory/(key+"-%%%%%%%%.tmp");
+
+        auto error=llvm::writeFileAtomically(temporary.string(), path.string(),
+            llvm::StringRef((char const*)object.data(), object.size()));
+        if(error)
+        {
+            llvm::errs() << "Could not write to the object cache: " << llvm::toString(std::move(error)) << "\n";
+            return false;
+        }
+
+        evict();
+        return true;
+    }
+
+    // Other compilers may be evicting at the same time, an entry that is already gone is skipped
+    void VObjectCache::evict()
+    {
+        struct Entry
+        {
+            std::filesystem::path path;
+            std::uintmax_t size;
+            std::filesystem::file_time_type used;
+        };
+
+        std::vector<Entry> entries;
+        std::uintmax_t total=0;
+
+        std::error_code ec;
+        for(auto const& file : std::filesystem::directory_iterator(directory, ec))
+        {
+            if(file.path().extension()!=object_extension)
+                continue;
+
+            std::error_code file_ec;
+            auto size=file.file_size(file_ec);
+            auto used=file.last_write_time(file_ec);
+            if(file_ec)
+                continue;
+
+            entries.push_back(Entry{file.path(), size, used});
+            total+=size;
+        }
+        if(total<=max_size)
+            return;
+
+        std::sort(entries.begin(), entries.end(), [](Entry const& lhs, Entry const& rhs)
+        {
+            return lhs.used<rhs.used;
+        });
+        for(auto const& entry : entries)
+        {
+            if(total<=max_size)
+                break;
+
+            std::filesystem::remove(entry.path, ec);
+            total-=entry.size;
+        }
+    }
+
+    std::uint64_t VObjectCache::getHits() const
+    {
+        return hits;
+    }
+    std::uint64_t VObjectCache::getMisses() const
+    {
+        return misses;
+    }
+    std::filesystem::path const& VObjectCache::getDirectory() const
+    {
+        return directory;
+    }
+}
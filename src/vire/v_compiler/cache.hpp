@@ -0,0 +1,46 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "vire/config/config.hpp"
+
+namespace vire
+{
+
+// VObjectCache - Compiled objects kept in a directory that any number of compilers can share.
+// An entry is named by a hash of everything its object depends on, so it never has to be
+// invalidated. Entries are written under a temporary name and renamed into place, a reader only
+// ever sees a whole object. Once the entries take more than `max_size` bytes the ones used least
+// recently are removed
+class VObjectCache
+{
+    std::filesystem::path directory;
+    std::uintmax_t max_size;
+    std::atomic<std::uint64_t> hits;
+    std::atomic<std::uint64_t> misses;
+private:
+    std::filesystem::path getPath(std::string const& key) const;
+    void evict();
+public:
+    VObjectCache(std::filesystem::path directory, std::uintmax_t max_size=std::uintmax_t(512)*1024*1024);
+
+    // `triple` and `cpu` are what the target resolved to, the compiler's and LLVM's versions are
+    // part of every key
+    static std::string makeKey(std::string_view source, std::string_view triple, std::string_view cpu,
+        Optimization opt_level, bool enable_lto);
+
+    // Returns false, and counts a miss, if there is no entry for `key`
+    bool lookup(std::string const& key, std::vector<unsigned char>& object);
+    bool store(std::string const& key, std::vector<unsigned char> const& object);
+
+    std::uint64_t getHits() const;
+    std::uint64_t getMisses() const;
+    std::filesystem::path const& getDirectory() const;
+};
+
+}
@@ -17,6 +17,22 @@
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Target/TargetOptions.h"
+#include "llvm/Support/Program.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/Transforms/Utils/SplitModule.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/Support/xxhash.h"
+
+#include "vire/proto/thread_pool.hpp"
+
+#ifndef VIRE_USE_EMCC
+#include "llvm/ExecutionEngine/Orc/ExecutionUtils.h"
+#include "llvm/ExecutionEngine/Orc/ThreadSafeModule.h"
+#endif
 
 #ifndef VIRE_NO_PASSES
 #include "llvm/Transforms/InstCombine/InstCombine.h"
@@ -58,7 +74,7 @@ namespace vire
             case types::EType::Custom:
             {
                 auto* custom=(types::Custom*)type;
-                auto* ty=definedStructs[custom->getName()];
+                auto* ty=definedStructs[proto::intern(custom->getName())];
 
                 if(allow_opaque_ptr)
                     return llvm::PointerType::get(ty, 0);
@@ -104,7 +120,7 @@ namespace vire
     {
         auto* ty=getLLVMType(var->getType(), false);
         auto* alloca=Builder.CreateAlloca(ty, nullptr, var->getName());
-        namedValues[var->getName()]=alloca;
+        namedValues[var->getIName().getSymbol()]=alloca;
         return alloca;
     }
     llvm::BranchInst* VCompiler::createBrIfNoTerminator(llvm::BasicBlock* block)
@@ -128,7 +144,7 @@ namespace vire
         else if (llvm::LoadInst* load=llvm::dyn_cast<llvm::LoadInst>(expr))
         {
             // Get the alloca by the name in the load operation
-            auto* alloca=namedValues[load->getPointerOperand()->getName()];
+            auto* alloca=namedValues[proto::intern(load->getPointerOperand()->getName())];
             
             // remove the expr from the block
             load->eraseFromParent();
@@ -138,7 +154,7 @@ namespace vire
         else if(llvm::GetElementPtrInst* gep=llvm::dyn_cast<llvm::GetElementPtrInst>(expr))
         {
             // Get the alloca by the name in the GEP operation
-            auto* alloca=namedValues[gep->getPointerOperand()->getName()];
+            auto* alloca=namedValues[proto::intern(gep->getPointerOperand()->getName())];
             
             // remove the expr from the block
             gep->eraseFromParent();
@@ -449,7 +465,7 @@ namespace vire
         }
         else
         {
-            auto* named=namedValues[expr->getName()];
+            auto* named=namedValues[expr->getIName().getSymbol()];
             val=named;
             ty=named->getAllocatedType();
         }
@@ -485,7 +501,7 @@ namespace vire
         }
         else
         {
-            auto* alloca=namedValues[def->getName()];
+            auto* alloca=namedValues[def->getIName().getSymbol()];
             lhs=alloca;
             lhs_align=alloca->getAlign();
         }
@@ -499,7 +515,7 @@ namespace vire
         {
             if(value->asttype==ast_call)
             {
-                auto* func=analyzer->getFunction(((CallExprAST*)def->getValue())->getIName().name);
+                auto* func=analyzer->getFunction(((CallExprAST*)def->getValue())->getIName());
                 llvm::CallInst* call;
 
                 if(func->doesRequireSelfRef())
@@ -877,7 +893,7 @@ namespace vire
     llvm::Value* VCompiler::compileCallExpr(CallExprAST* const expr, llvm::Value* parent_struct)
     {
         std::string func_name;
-        auto* afunc=analyzer->getFunction(expr->getIName().name);
+        auto* afunc=analyzer->getFunction(expr->getIName());
 
         if(afunc->is_extern())
         {
@@ -926,7 +942,8 @@ namespace vire
             call->addParamAttr(indx, llvm::Attribute::NoUndef);
             if(types::isUserDefined(arg->getType()))
             {
-                auto* ty=getLLVMType(arg->getType());
+                // Has to be the callee's, whose body may be compiled in another module
+                auto* ty=getLLVMType(arg->getType(), false);
                 uint64_t align=data_layout->getStructLayout((llvm::StructType*)ty)->getAlignment().value();
                 call->addParamAttr(indx, llvm::Attribute::get(CTX, llvm::Attribute::ByVal, ty));
                 call->addParamAttr(indx, llvm::Attribute::get(CTX, llvm::Attribute::Alignment, align));
@@ -951,7 +968,7 @@ namespace vire
             if(types::isUserDefined(currentFunctionAST->getReturnType()))
             {
                 // If its a struct
-                nsize=types::custom_type_sizes[((types::Custom*)expr->getValue()->getType())->getName()];
+                nsize=types::getContext().getTypeSize(((types::Custom*)expr->getValue()->getType())->getName());
             }
             else
             {
@@ -971,7 +988,7 @@ namespace vire
 
             return memcpy;
         }
-        auto* value=Builder.CreateStore(expr_val, namedValues["retval"]);
+        auto* value=Builder.CreateStore(expr_val, namedValues[retval]);
         Builder.CreateBr(currentFunctionEndBB);
 
         return value;
@@ -1094,7 +1111,7 @@ namespace vire
         if(func_returns)
         {
             auto* ret_val=Builder.CreateAlloca(ret_type, nullptr, "retval");
-            namedValues["retval"]=ret_val;
+            namedValues[retval]=ret_val;
         }
 
         // Compile the block
@@ -1140,7 +1157,7 @@ namespace vire
 
         if(func_returns)
         {
-            Builder.CreateRet(Builder.CreateLoad(ret_type, namedValues["retval"], "ret"));
+            Builder.CreateRet(Builder.CreateLoad(ret_type, namedValues[retval], "ret"));
         }
         else
         {
@@ -1191,14 +1208,45 @@ namespace vire
             }
         }
 
-        auto struct_type=llvm::StructType::create(CTX, elements);
+        // Member names in the order of the elements, the elements alone do not say which is which
+        std::string members;
+        for(auto const& [iname, member] : st->getMembers())
+        {
+            members+=iname.get();
+            members+=';';
+        }
+
+        llvm::StructType* struct_type;
         auto struct_name="struct."+st->getName();
-        struct_type->setName(struct_name);
+        auto symbol=st->getIName().getSymbol();
+        auto layout=struct_layouts.find(symbol);
+        if(layout!=struct_layouts.end() && layout->second.members==members && layout->second.type->elements()==llvm::ArrayRef<llvm::Type*>(elements))
+        {
+            struct_type=layout->second.type;
+        }
+        else
+        {
+            // Cached functions may have been compiled for the old layout
+            if(layout!=struct_layouts.end())
+                clearFunctionCache();
 
-        definedStructs[st->getName()]=struct_type;
+            // A context shared through a session may have the type from another compiler already
+            struct_type=llvm::StructType::getTypeByName(CTX, struct_name);
+            if(!struct_type || struct_type->isOpaque() || struct_type->elements()!=llvm::ArrayRef<llvm::Type*>(elements))
+            {
+                struct_type=llvm::StructType::create(CTX, elements);
+                struct_type->setName(struct_name);
+            }
+            struct_layouts[symbol]=StructLayout{members, struct_type};
+        }
+
+        definedStructs[symbol]=struct_type;
 
-        // Create the constructor
-        compileFunction(st->getConstructor());
+        // Create the constructor, the module a struct is imported from has its body
+        if(!st->isImported())
+            compileFunction(st->getConstructor());
+        else if(!Module->getFunction(st->getConstructor()->getName()))
+            compilePrototype(st->getConstructor()->getProto());
 
         return struct_type;
     }
@@ -1214,7 +1262,7 @@ namespace vire
             // Load the type access ast and the pre-compiled struct type
             auto* current=(TypeAccessAST*)current_expr;
             auto* st_type=(types::Custom*)current->getParent()->getType();
-            auto* st_ltype=definedStructs[st_type->getName()];
+            auto* st_ltype=definedStructs[proto::intern(st_type->getName())];
 
             // Compile the pointer
             llvm::Value* val;
@@ -1276,6 +1324,8 @@ namespace vire
     void VCompiler::compileModule()
     {
         auto* mod=analyzer->getSourceModule();
+        types::TypeContextScope type_scope(analyzer->getTypeContext());
+        ++function_cache_generation;
 
         for(auto const& s:mod->getUnionStructs())
         {
@@ -1305,11 +1355,15 @@ namespace vire
             else
             {
                 auto* func=(FunctionAST*)f.get();
-                compileFunction(func);
+                cacheFunction(func, compileFunction(func));
             }
         }
+        pruneFunctionCache();
 
         current_func_single_sret=current_func_ret_ty=false;
+        if(!emit_entry)
+            return;
+
         llvm::FunctionType* main_type=llvm::FunctionType::get(llvm::Type::getInt32Ty(CTX), false);
         llvm::Function* main_func=llvm::Function::Create(main_type, llvm::GlobalValue::ExternalLinkage, "main", Module.get());
         llvm::BasicBlock* bb=llvm::BasicBlock::Create(CTX, "entry", main_func);
@@ -1362,6 +1416,247 @@ namespace vire
         }
     }
 
+    // The globals `function` uses, directly or through constant expressions
+    static void collectGlobals(llvm::Function* function, llvm::SetVector<llvm::GlobalValue*>& globals)
+    {
+        llvm::SmallVector<llvm::Constant*, 16> worklist;
+        llvm::SmallPtrSet<llvm::Constant*, 16> seen;
+        for(auto& inst : llvm::instructions(function))
+        {
+            for(auto& operand : inst.operands())
+            {
+                if(auto* constant=llvm::dyn_cast<llvm::Constant>(operand.get()); constant && seen.insert(constant).second)
+                    worklist.push_back(constant);
+            }
+        }
+        while(!worklist.empty())
+        {
+            auto* constant=worklist.pop_back_val();
+            if(auto* global=llvm::dyn_cast<llvm::GlobalValue>(constant))
+            {
+                if(global!=function)
+                    globals.insert(global);
+                continue;
+            }
+            for(auto& operand : constant->operands())
+            {
+                if(auto* inner=llvm::dyn_cast<llvm::Constant>(operand.get()); inner && seen.insert(inner).second)
+                    worklist.push_back(inner);
+            }
+        }
+    }
+
+    // Copies `function` into `to` with the constants it uses, replacing the body of the function
+    // by that name if `to` has one. What it calls is looked up by name, and declared if missing.
+    // Returns nullptr, leaving `to` as it was, if one of the names is taken by something else
+    llvm::Function* VCompiler::copyFunction(llvm::Function* function, llvm::Module& to)
+    {
+        llvm::SetVector<llvm::GlobalValue*> globals;
+        collectGlobals(function, globals);
+
+        auto* copy=llvm::dyn_cast_or_null<llvm::Function>(to.getNamedValue(function->getName()));
+        if(to.getNamedValue(function->getName()) && (!copy || copy->getFunctionType()!=function->getFunctionType()))
+            return nullptr;
+
+        for(auto* global : globals)
+        {
+            if(llvm::isa<llvm::GlobalVariable>(global))
+                continue;
+            auto* callee=llvm::dyn_cast<llvm::Function>(global);
+            if(!callee)
+                return nullptr;
+
+            auto* target=to.getNamedValue(callee->getName());
+            if(target && (!llvm::isa<llvm::Function>(target) || ((llvm::Function*)target)->getFunctionType()!=callee->getFunctionType()))
+                return nullptr;
+        }
+
+        llvm::ValueToValueMapTy values;
+        std::vector<std::pair<llvm::GlobalVariable*, llvm::GlobalVariable*>> variables;
+        for(auto* global : globals)
+        {
+            if(auto* callee=llvm::dyn_cast<llvm::Function>(global))
+            {
+                auto* target=to.getFunction(callee->getName());
+                if(!target)
+                {
+                    target=llvm::Function::Create(callee->getFunctionType(), llvm::GlobalValue::ExternalLinkage, callee->getName(), to);
+                    target->setAttributes(callee->getAttributes());
+                }
+                values[callee]=target;
+            }
+            else
+            {
+                auto* variable=(llvm::GlobalVariable*)global;
+                auto* target=new llvm::GlobalVariable(to, variable->getValueType(), variable->isConstant(), variable->getLinkage(),
+                    nullptr, variable->getName(), nullptr, variable->getThreadLocalMode(), variable->getAddressSpace());
+                target->copyAttributesFrom(variable);
+                values[variable]=target;
+                variables.emplace_back(variable, target);
+            }
+        }
+        for(auto [variable, target] : variables)
+        {
+            if(variable->hasInitializer())
+                target->setInitializer(llvm::MapValue(variable->getInitializer(), values));
+        }
+
+        if(copy)
+            copy->deleteBody();
+        else
+            copy=llvm::Function::Create(function->getFunctionType(), function->getLinkage(), function->getName(), to);
+        copy->setLinkage(function->getLinkage());
+
+        auto copy_arg=copy->arg_begin();
+        for(auto& arg : function->args())
+        {
+            copy_arg->setName(arg.getName());
+            values[&arg]=&*copy_arg++;
+        }
+
+        llvm::SmallVector<llvm::ReturnInst*, 8> returns;
+        llvm::CloneFunctionInto(copy, function, values, llvm::CloneFunctionChangeType::DifferentModule, returns);
+
+        // Cloning into another module lists the compile units the body uses, there are none
+        if(auto* units=to.getNamedMetadata("llvm.dbg.cu"); units && units->getNumOperands()==0)
+            to.eraseNamedMetadata(units);
+        return copy;
+    }
+    void VCompiler::cacheFunction(FunctionAST* const func, llvm::Function* function)
+    {
+        auto* sources=analyzer->getSourceManager();
+        if(!function_cache_enabled || !sources || !function)
+            return;
+
+        auto text=sources->getText(func->getSourceBegin(), func->getSourceEnd());
+        if(text.empty())
+            return;
+
+        auto hash=llvm::xxHash64(llvm::StringRef(text.data(), text.size()));
+        auto& cached=function_cache[function->getName().str()];
+        if(cached.hash!=hash)
+        {
+            cached.hash=hash;
+            cached.optimized.clear();
+        }
+        cached.generation=function_cache_generation;
+        cached.function=function;
+    }
+    // Optimizes each function of the module in a module of its own, where everything else is only
+    // declared, so what it optimizes to depends on nothing but its own code and can be kept
+    void VCompiler::optimizeFunctions(llvm::TargetMachine* tm, Optimization opt_level, bool enable_lto)
+    {
+        auto config=tm->getTargetTriple().str()+"/"+tm->getTargetCPU().str()+"/"+tm->getTargetFeatureString().str()
+            +"/"+std::to_string((int)opt_level)+(enable_lto?"/lto":"");
+
+        std::unordered_map<llvm::Function*, CachedFunction*> entries;
+        for(auto& [name, cached] : function_cache)
+        {
+            if(cached.generation==function_cache_generation && cached.function)
+                entries[cached.function]=&cached;
+        }
+
+        std::vector<llvm::Function*> functions;
+        for(auto& function : *Module)
+        {
+            if(!function.isDeclaration())
+                functions.push_back(&function);
+        }
+
+        for(auto* function : functions)
+        {
+            CachedFunction* cached=nullptr;
+            llvm::Module* optimized=nullptr;
+            if(auto it=entries.find(function); it!=entries.end())
+            {
+                cached=it->second;
+
+                llvm::SetVector<llvm::GlobalValue*> globals;
+                collectGlobals(function, globals);
+                std::vector<Callee> callees;
+                for(auto* global : globals)
+                {
+                    if(auto* callee=llvm::dyn_cast<llvm::Function>(global))
+                        callees.push_back(Callee{callee->getName().str(), callee->getFunctionType(), callee->getAttributes()});
+                }
+                if(callees!=cached->callees)
+                {
+                    cached->callees=std::move(callees);
+                    cached->optimized.clear();
+                }
+
+                if(auto found=cached->optimized.find(config); found!=cached->optimized.end())
+                {
+                    optimized=found->second.get();
+                    ++function_cache_hits;
+                }
+            }
+
+            std::unique_ptr<llvm::Module> alone;
+            if(!optimized)
+            {
+                alone=std::make_unique<llvm::Module>(function->getName(), CTX);
+                alone->setDataLayout(Module->getDataLayout());
+                alone->setTargetTriple(Module->getTargetTriple());
+                if(!copyFunction(function, *alone))
+                    continue;
+
+                runOptimizationPasses(*alone, tm, opt_level, enable_lto);
+                optimized=alone.get();
+                if(cached)
+                {
+                    ++function_cache_misses;
+                    cached->optimized[config]=std::move(alone);
+                }
+            }
+
+            auto* body=optimized->getFunction(function->getName());
+            if(!body || !copyFunction(body, *Module))
+                llvm::errs() << "Could not use the optimized " << function->getName() << ", it is left unoptimized\n";
+        }
+
+        // The constants of the bodies that were replaced
+        for(auto it=Module->global_begin(); it!=Module->global_end();)
+        {
+            auto& variable=*it++;
+            if(variable.hasLocalLinkage() && variable.use_empty())
+                variable.eraseFromParent();
+        }
+    }
+    void VCompiler::clearFunctionCache()
+    {
+        function_cache.clear();
+    }
+    // Drops the functions the last module did not have
+    void VCompiler::pruneFunctionCache()
+    {
+        for(auto it=function_cache.begin(); it!=function_cache.end();)
+        {
+            if(it->second.generation!=function_cache_generation)
+                it=function_cache.erase(it);
+            else
+                ++it;
+        }
+    }
+    void VCompiler::setFunctionCache(bool enable)
+    {
+        function_cache_enabled=enable;
+        if(!enable)
+            clearFunctionCache();
+    }
+    std::uint64_t VCompiler::getFunctionCacheHits() const
+    {
+        return function_cache_hits;
+    }
+    std::uint64_t VCompiler::getFunctionCacheMisses() const
+    {
+        return function_cache_misses;
+    }
+    void VCompiler::setEmitEntry(bool emit)
+    {
+        emit_entry=emit;
+    }
+
     llvm::Module* const VCompiler::getModule() const
     {
         return Module.get();
@@ -1378,9 +1673,15 @@ namespace vire
         return analyzer.get();
     }
 
-    void VCompiler::runOptimizationPasses(llvm::TargetMachine* tm, Optimization opt_level, bool enable_lto)
+    void VCompiler::runOptimizationPasses(llvm::Module& module, llvm::TargetMachine* tm, Optimization opt_level, bool enable_lto)
     {
         #ifndef VIRE_NO_PASSES
+
+        if(function_cache_enabled && &module==Module.get())
+        {
+            optimizeFunctions(tm, opt_level, enable_lto);
+            return;
+        }
         
         llvm::LoopAnalysisManager lam;
         llvm::FunctionAnalysisManager fam;
@@ -1437,58 +1738,53 @@ namespace vire
             }
         }
 
-        passmgr.run(*Module, mam);
+        passmgr.run(module, mam);
 
         #endif
     }
-    llvm::TargetMachine* VCompiler::compileInternal(std::string const& target_str)
+    void VCompiler::resolveTarget(std::string const& target_str, std::string& triple, std::string& cpu)
     {
-        std::string target_triple;
+        // Asking the host is not free, and the answer does not change
+        static std::string const host_triple=llvm::sys::getDefaultTargetTriple();
         if(target_str=="sys" || target_str=="")
         {
-            target_triple=llvm::sys::getDefaultTargetTriple();
+            triple=host_triple;
         }
         else
         {
-            target_triple=target_str;
+            triple=target_str;
         }
-    
-    #ifdef VIRE_ENABLE_ONLY
-        SPECIFIC_INIT_TARGET_INFO(VIRE_ENABLE_ONLY);
-        SPECIFIC_INIT_TARGET(VIRE_ENABLE_ONLY);
-        SPECIFIC_INIT_TARGET_MC(VIRE_ENABLE_ONLY);
-        SPECIFIC_INIT_ASM_PARSER(VIRE_ENABLE_ONLY);
-        SPECIFIC_INIT_ASM_PRINTER(VIRE_ENABLE_ONLY);
-    #endif
-    #ifndef VIRE_ENABLE_ONLY
-        llvm::InitializeAllTargetInfos();
-        llvm::InitializeAllTargets();
-        llvm::InitializeAllTargetMCs();
-        llvm::InitializeAllAsmParsers();
-        llvm::InitializeAllAsmPrinters();
-    #endif
-        
-        std::string error;
-        auto* target=llvm::TargetRegistry::lookupTarget(target_triple, error);
 
-        if(!target)
-        {
-            llvm::errs() << "Target not found:\n" << error;
-            return nullptr;
-        }
-
-        std::string cpu="generic";
-        std::string features;
+        cpu="generic";
 
         // POSSIBLY DANGEROUS, TO BE CHANGED
     #ifndef VIRE_ENABLE_ONLY
-        cpu=llvm::sys::getHostCPUName();
+        static std::string const host_cpu=llvm::sys::getHostCPUName().str();
+        cpu=host_cpu;
     #endif
+    }
+    std::shared_ptr<llvm::TargetMachine> VCompiler::createTargetMachine(std::string const& triple, std::string const& cpu, Optimization opt_level)
+    {
+        std::string error;
+        std::shared_ptr<llvm::TargetMachine> target_machine;
+        if(session)
+            target_machine=session->getTargetMachine(triple, cpu, "", opt_level, error);
+        else
+            target_machine=VCompilerSession::createTargetMachine(triple, cpu, "", opt_level, error);
 
-        llvm::TargetOptions opt;
-        auto rm=llvm::Optional<llvm::Reloc::Model>();
+        if(!target_machine)
+            llvm::errs() << "Target not found:\n" << error;
+        return target_machine;
+    }
+    std::shared_ptr<llvm::TargetMachine> VCompiler::compileInternal(std::string const& target_str, Optimization opt_level)
+    {
+        std::string target_triple;
+        std::string cpu;
+        resolveTarget(target_str, target_triple, cpu);
 
-        auto* target_machine=target->createTargetMachine(target_triple, cpu, features, opt, rm);
+        auto target_machine=createTargetMachine(target_triple, cpu, opt_level);
+        if(!target_machine)
+            return nullptr;
 
         Module->setDataLayout(target_machine->createDataLayout());
         Module->setTargetTriple(target_triple);
@@ -1500,14 +1796,14 @@ namespace vire
         llvm::SmallString<1> out;
         llvm::raw_svector_ostream os(out);
 
-        auto* target_machine=compileInternal(target_str);
+        auto target_machine=compileInternal(target_str, opt_level);
 
         if(!target_machine)
         {
             return std::vector<unsigned char>();
         }
 
-        runOptimizationPasses(target_machine, opt_level, enable_lto);
+        runOptimizationPasses(*Module, target_machine.get(), opt_level, enable_lto);
 
         llvm::legacy::PassManager legacy_passmgr;
         target_machine->addPassesToEmitFile(legacy_passmgr, os, nullptr, file_type);
@@ -1516,29 +1812,300 @@ namespace vire
         auto bytestr=out.str().str();
         std::vector<unsigned char> ret(bytestr.begin(), bytestr.end());
 
-        delete target_machine;
-
         return ret;
     }
-    void VCompiler::compileToFile(std::string const& filename, std::string const& target_str, Optimization opt_level, bool enable_lto)
+    // Returns false, having written nothing, when the module is better emitted whole: a single
+    // function, a cross target, or no linker to combine the partitions with
+    bool VCompiler::compileToFileParallel(std::string const& filename, std::string const& target_str, Optimization opt_level, bool enable_lto, unsigned int jobs)
+    {
+        if(file_type!=llvm::CGFT_ObjectFile || (target_str!="sys" && target_str!=""))
+            return false;
+
+        auto linker=llvm::sys::findProgramByName("ld");
+        if(!linker)
+            return false;
+
+        unsigned int defined=0;
+        for(auto const& func : *Module)
+            if(!func.isDeclaration())
+                ++defined;
+        if(defined<2)
+            return false;
+        if(jobs>defined)
+            jobs=defined;
+
+        auto target_machine=compileInternal(target_str, opt_level);
+        if(!target_machine)
+            return false;
+
+        // Partitions share the module's context, so they are handed to the threads as bitcode and
+        // loaded into a context of their own there. Local symbols keep every user in their partition
+        std::vector<llvm::SmallVector<char, 0>> partitions;
+        llvm::SplitModule(*Module, jobs, [&](std::unique_ptr<llvm::Module> part)
+        {
+            partitions.emplace_back();
+            llvm::raw_svector_ostream os(partitions.back());
+            llvm::WriteBitcodeToFile(*part, os);
+        }, true);
+
+        // Target machines are made up front, the target registry is not safe to use concurrently
+        std::vector<std::shared_ptr<llvm::TargetMachine>> machines;
+        std::vector<std::string> objects;
+        for(std::size_t i=0; i<partitions.size(); ++i)
+        {
+            machines.push_back(createTargetMachine(target_machine->getTargetTriple().str(), target_machine->getTargetCPU().str(), opt_level));
+            if(!machines.back())
+                return false;
+        }
+        for(std::size_t i=0; i<partitions.size(); ++i)
+        {
+            llvm::SmallString<128> path;
+            llvm::sys::fs::createTemporaryFile("vire-part", "o", path);
+            objects.push_back(path.str().str());
+        }
+        target_machine.reset();
+
+        std::vector<char> emitted(partitions.size());
+        proto::ThreadPool pool(jobs);
+        pool.forEach(partitions.size(), [&](std::size_t i, unsigned int)
+        {
+            llvm::LLVMContext ctx;
+            ctx.setOpaquePointers(true);
+
+            auto buffer=llvm::MemoryBufferRef(llvm::StringRef(partitions[i].data(), partitions[i].size()), "partition");
+            auto part=llvm::parseBitcodeFile(buffer, ctx);
+            if(!part)
+            {
+                llvm::consumeError(part.takeError());
+                return;
+            }
+
+            runOptimizationPasses(**part, machines[i].get(), opt_level, enable_lto);
+
+            std::error_code ec;
+            llvm::raw_fd_ostream os(objects[i], ec, llvm::sys::fs::OF_None);
+            if(ec)
+                return;
+
+            llvm::legacy::PassManager legacy_passmgr;
+            machines[i]->addPassesToEmitFile(legacy_passmgr, os, nullptr, file_type);
+            legacy_passmgr.run(**part);
+            os.flush();
+
+            emitted[i]=true;
+        });
+
+        bool success=std::find(emitted.begin(), emitted.end(), false)==emitted.end();
+        if(success)
+        {
+            std::vector<llvm::StringRef> args={*linker, "-r", "-o", filename};
+            for(auto const& object : objects)
+                args.push_back(object);
+
+            success=llvm::sys::ExecuteAndWait(*linker, args)==0;
+        }
+
+        for(auto const& object : objects)
+            llvm::sys::fs::remove(object);
+
+        if(!success)
+            llvm::errs() << "Parallel code generation failed, emitting the module whole\n";
+        return success;
+    }
+    void VCompiler::compileToFile(std::string const& filename, std::string const& target_str, Optimization opt_level, bool enable_lto, unsigned int jobs)
     {
+        if(jobs>1 && compileToFileParallel(filename, target_str, opt_level, enable_lto, jobs))
+            return;
+
         std::error_code ec;
         llvm::raw_fd_ostream os(filename, ec, llvm::sys::fs::OF_None);
         
-        auto* target_machine=compileInternal(target_str);
+        auto target_machine=compileInternal(target_str, opt_level);
 
         if(!target_machine)
         {
             return;
         }
 
-        runOptimizationPasses(target_machine, opt_level, enable_lto);
+        runOptimizationPasses(*Module, target_machine.get(), opt_level, enable_lto);
 
         llvm::legacy::PassManager legacy_passmgr;
         target_machine->addPassesToEmitFile(legacy_passmgr, os, nullptr, file_type);
         legacy_passmgr.run(*Module);
         os.flush();
+    }
+
+#ifndef VIRE_USE_EMCC
+    void VCompiler::addHostSymbol(std::string const& name, void* address)
+    {
+        host_symbols[name]=address;
+    }
+    bool VCompiler::createJIT(bool lazy)
+    {
+        llvm::InitializeNativeTarget();
+        llvm::InitializeNativeTargetAsmPrinter();
+
+        if(lazy)
+        {
+            // The compile-on-demand layer gives every function a partition of its own by default, a
+            // body is split off, optimized and compiled the first time it is called through its stub.
+            // Compiling happens on one thread so stubs hit from different threads queue up there
+            auto created=llvm::orc::LLLazyJITBuilder().setNumCompileThreads(1).create();
+            if(!created)
+            {
+                llvm::errs() << "Could not create the JIT: " << llvm::toString(created.takeError()) << "\n";
+                return false;
+            }
+            jit=std::move(*created);
+        }
+        else
+        {
+            auto created=llvm::orc::LLJITBuilder().create();
+            if(!created)
+            {
+                llvm::errs() << "Could not create the JIT: " << llvm::toString(created.takeError()) << "\n";
+                return false;
+            }
+            jit=std::move(*created);
+        }
+        jit_lazy=lazy;
+
+        auto builder=llvm::orc::JITTargetMachineBuilder::detectHost();
+        if(!builder)
+        {
+            llvm::errs() << llvm::toString(builder.takeError()) << "\n";
+            return false;
+        }
+        auto tm=builder->createTargetMachine();
+        if(!tm)
+        {
+            llvm::errs() << llvm::toString(tm.takeError()) << "\n";
+            return false;
+        }
+
+        // The transform layer sees what is about to be compiled, the whole module for the eager
+        // jit and one function at a time for the lazy one
+        std::shared_ptr<llvm::TargetMachine> target_machine=std::move(*tm);
+        jit->getIRTransformLayer().setTransform([this, target_machine](llvm::orc::ThreadSafeModule module, llvm::orc::MaterializationResponsibility&)
+            -> llvm::Expected<llvm::orc::ThreadSafeModule>
+        {
+            if(jit_opt_level!=Optimization::O0)
+            {
+                module.withModuleDo([&](llvm::Module& m) { runOptimizationPasses(m, target_machine.get(), jit_opt_level); });
+            }
+            return std::move(module);
+        });
+
+        auto process=llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(jit->getDataLayout().getGlobalPrefix());
+        if(!process)
+        {
+            llvm::errs() << "Could not load the host symbols: " << llvm::toString(process.takeError()) << "\n";
+            return false;
+        }
+        jit->getMainJITDylib().addGenerator(std::move(*process));
+
+        return true;
+    }
+    bool VCompiler::loadJIT(Optimization opt_level, bool lazy)
+    {
+        unloadJIT();
+        if((!jit || jit_lazy!=lazy) && !createJIT(lazy))
+        {
+            jit.reset();
+            return false;
+        }
+        jit_opt_level=opt_level;
+
+        // The JIT owns the modules it runs, so it gets a copy in a context of its own and this
+        // module stays usable for the other outputs
+        llvm::SmallVector<char, 0> bitcode;
+        llvm::raw_svector_ostream os(bitcode);
+        llvm::WriteBitcodeToFile(*Module, os);
+
+        auto ctx=std::make_unique<llvm::LLVMContext>();
+        ctx->setOpaquePointers(true);
+        auto module=llvm::parseBitcodeFile(llvm::MemoryBufferRef(llvm::StringRef(bitcode.data(), bitcode.size()), "jit"), *ctx);
+        if(!module)
+        {
+            llvm::errs() << llvm::toString(module.takeError()) << "\n";
+            return false;
+        }
+        (*module)->setDataLayout(jit->getDataLayout());
+        (*module)->setTargetTriple(jit->getTargetTriple().str());
+
+        // Everything that is loaded is dropped with its tracker, the next load starts from a clean library
+        auto& library=jit->getMainJITDylib();
+        auto tracker=library.createResourceTracker();
 
-        delete target_machine;
+        auto fail=[&](llvm::Error err)
+        {
+            llvm::errs() << llvm::toString(std::move(err)) << "\n";
+            llvm::consumeError(tracker->remove());
+            return false;
+        };
+
+        if(!host_symbols.empty())
+        {
+            llvm::orc::SymbolMap symbols;
+            for(auto const& [name, address] : host_symbols)
+            {
+                symbols[jit->mangleAndIntern(name)]=llvm::JITEvaluatedSymbol(llvm::pointerToJITTargetAddress(address), llvm::JITSymbolFlags::Exported);
+            }
+            if(auto err=library.define(llvm::orc::absoluteSymbols(std::move(symbols)), tracker))
+                return fail(std::move(err));
+        }
+
+        llvm::orc::ThreadSafeModule thread_safe_module(std::move(*module), std::move(ctx));
+        if(lazy)
+        {
+            auto* lazy_jit=static_cast<llvm::orc::LLLazyJIT*>(jit.get());
+            if(auto err=lazy_jit->getCompileOnDemandLayer().add(tracker, std::move(thread_safe_module)))
+                return fail(std::move(err));
+        }
+        else if(auto err=jit->addIRModule(tracker, std::move(thread_safe_module)))
+        {
+            return fail(std::move(err));
+        }
+
+        jit_tracker=std::move(tracker);
+        return true;
+    }
+    void* VCompiler::lookupJIT(std::string const& name)
+    {
+        if(!jit_tracker)
+            return nullptr;
+
+        auto sym=jit->lookup(name);
+        if(!sym)
+        {
+            llvm::errs() << llvm::toString(sym.takeError()) << "\n";
+            return nullptr;
+        }
+        return sym->toPtr<void*>();
+    }
+    void VCompiler::unloadJIT()
+    {
+        if(!jit_tracker)
+            return;
+
+        llvm::consumeError(jit_tracker->remove());
+        jit_tracker=nullptr;
     }
+    bool VCompiler::runJIT(int& exit_code, Optimization opt_level, bool lazy)
+    {
+        if(!loadJIT(opt_level, lazy))
+            return false;
+
+        auto* main_func=(int(*)())lookupJIT("main");
+        if(!main_func)
+        {
+            unloadJIT();
+            return false;
+        }
+        exit_code=main_func();
+
+        unloadJIT();
+        return true;
+    }
+#endif
 }
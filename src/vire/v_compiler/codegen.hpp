@@ -10,6 +10,8 @@
 // For `VIRE_ENABLE_ONLY` definition
 #include "vire/config/config.hpp"
 
+#include "session.hpp"
+
 #ifdef VIRE_ENABLE_ONLY
     #define __SPECIFIC_INIT_MACRO(target, func_name) LLVMInitialize##target##func_name()
     #define SPECIFIC_INIT_TARGET_INFO(target) __SPECIFIC_INIT_MACRO(target, TargetInfo)
@@ -24,6 +26,10 @@
 #include "llvm/IR/Module.h"
 #include "llvm/IR/DataLayout.h"
 
+#ifndef VIRE_USE_EMCC
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
+#endif
+
 namespace llvm
 {
     class Function;
@@ -46,15 +52,18 @@ class VCompiler
 {
     std::unique_ptr<VAnalyzer> analyzer;
 
-    // LLVM
-    llvm::LLVMContext CTX;
+    // LLVM, the context is the session's when there is one
+    VCompilerSession* session;
+    std::unique_ptr<llvm::LLVMContext> own_context;
+    llvm::LLVMContext& CTX;
     llvm::IRBuilder<> Builder;
     std::unique_ptr<llvm::Module> Module;
     std::unique_ptr<llvm::DataLayout> data_layout;
 
     // Memory
-    std::map<llvm::StringRef, llvm::AllocaInst*> namedValues;
-    std::map<std::string, llvm::StructType*> definedStructs;
+    std::unordered_map<proto::Symbol, llvm::AllocaInst*> namedValues;
+    std::unordered_map<proto::Symbol, llvm::StructType*> definedStructs;
+    proto::Symbol retval;
     llvm::Function* currentFunction;
     llvm::BasicBlock* currentFunctionEndBB;
     llvm::BasicBlock* currentLoopEndBB;
@@ -66,18 +75,80 @@ class VCompiler
     // Compilation
     enum llvm::CodeGenFileType file_type;
     std::string output_ir;
+
+    // Structs keep their type while their members stay the same, so code compiled for an earlier
+    // module can still use it
+    struct StructLayout
+    {
+        std::string members;
+        llvm::StructType* type;
+    };
+    std::unordered_map<proto::Symbol, StructLayout> struct_layouts;
+
+    // Function cache, what the functions of earlier modules optimized to, by name. An entry is
+    // used while the function's source text, what it calls and the struct layouts stay the same
+    struct Callee
+    {
+        std::string name;
+        llvm::FunctionType* type;
+        llvm::AttributeList attributes;
+
+        bool operator==(Callee const& rhs) const
+        {
+            return name==rhs.name && type==rhs.type && attributes==rhs.attributes;
+        }
+    };
+    struct CachedFunction
+    {
+        std::uint64_t hash=0;
+        std::uint64_t generation=0;
+        llvm::Function* function=nullptr;
+        std::vector<Callee> callees;
+        // The function optimized on its own, by target and optimization level
+        std::unordered_map<std::string, std::unique_ptr<llvm::Module>> optimized;
+    };
+    bool function_cache_enabled=false;
+    std::unordered_map<std::string, CachedFunction> function_cache;
+    std::uint64_t function_cache_generation=0;
+    std::uint64_t function_cache_hits=0;
+    std::uint64_t function_cache_misses=0;
+
+    // Modules other modules import are linked into a program that has its `main` elsewhere
+    bool emit_entry=true;
+
+#ifndef VIRE_USE_EMCC
+    // JIT, created on the first run and kept for the next ones
+    std::unique_ptr<llvm::orc::LLJIT> jit;
+    llvm::orc::ResourceTrackerSP jit_tracker;
+    std::unordered_map<std::string, void*> host_symbols;
+    bool jit_lazy=false;
+    Optimization jit_opt_level=Optimization::O0;
+#endif
 private:
-    llvm::TargetMachine* compileInternal(std::string const& target_str);
-    void runOptimizationPasses(llvm::TargetMachine* tm, Optimization opt_level=Optimization::O0, bool enable_lto=false);
+    std::shared_ptr<llvm::TargetMachine> createTargetMachine(std::string const& triple, std::string const& cpu, Optimization opt_level);
+    std::shared_ptr<llvm::TargetMachine> compileInternal(std::string const& target_str, Optimization opt_level);
+    void runOptimizationPasses(llvm::Module& module, llvm::TargetMachine* tm, Optimization opt_level=Optimization::O0, bool enable_lto=false);
+    bool compileToFileParallel(std::string const& filename, std::string const& target_str, Optimization opt_level, bool enable_lto, unsigned int jobs);
+    llvm::Function* copyFunction(llvm::Function* function, llvm::Module& to);
+    void cacheFunction(FunctionAST* const func, llvm::Function* function);
+    void optimizeFunctions(llvm::TargetMachine* tm, Optimization opt_level, bool enable_lto);
+    void clearFunctionCache();
+    void pruneFunctionCache();
+#ifndef VIRE_USE_EMCC
+    bool createJIT(bool lazy);
+#endif
 
 public:
-    VCompiler(std::unique_ptr<VAnalyzer> analyzer, std::string const& name="vire")
-    : analyzer(std::move(analyzer)), Builder(llvm::IRBuilder<>(CTX))
+    VCompiler(std::unique_ptr<VAnalyzer> analyzer, std::string const& name="vire", VCompilerSession* session=nullptr)
+    : analyzer(std::move(analyzer)), session(session), own_context(session ? nullptr : std::make_unique<llvm::LLVMContext>()),
+      CTX(session ? session->getContext() : *own_context), Builder(llvm::IRBuilder<>(CTX))
     {
         Module = std::make_unique<llvm::Module>(name, CTX);
         data_layout = std::make_unique<llvm::DataLayout>(Module.get());
-        CTX.setOpaquePointers(true);
+        if(own_context)
+            CTX.setOpaquePointers(true);
         file_type=llvm::CGFT_ObjectFile;
+        retval=proto::intern("retval");
     }
 
     // Compilation Functions
@@ -138,10 +209,40 @@ public:
     llvm::Module* const getModule() const;
     std::string const& getCompiledOutput();
     VAnalyzer* const getAnalyzer()  const;
+
+    // The triple and CPU `target_str` compiles for, "sys" or nothing is the host
+    static void resolveTarget(std::string const& target_str, std::string& triple, std::string& cpu);
     
     void resetModule();
     void compileModule();
-    void compileToFile(std::string const& filename, std::string const& target, Optimization opt_level=Optimization::O0, bool enable_lto=false);
+    // With the function cache on, functions are optimized one at a time, without inlining across
+    // them, and a function that is the same as in an earlier module gets what it optimized to then.
+    // It is the same while its text and the signatures of what it calls are, changing the layout
+    // of a struct empties the cache
+    void setFunctionCache(bool enable);
+    std::uint64_t getFunctionCacheHits() const;
+    std::uint64_t getFunctionCacheMisses() const;
+    // Without an entry the module gets no `main`, its top level statements are not run
+    void setEmitEntry(bool emit);
+    // With `jobs` above 1 the module is split in that many partitions, each optimized and emitted on
+    // its own thread, and the objects are combined into one relocatable object with `ld -r`
+    void compileToFile(std::string const& filename, std::string const& target, Optimization opt_level=Optimization::O0, bool enable_lto=false, unsigned int jobs=1);
     std::vector<unsigned char> compileToString(std::string const& target_str="", Optimization opt_level=Optimization::O0, bool enable_lto=false);
+
+#ifndef VIRE_USE_EMCC
+    // Externs resolve against these first, then against the symbols the host process exports
+    void addHostSymbol(std::string const& name, void* address);
+    // Runs the compiled module's `main` in this process, returns false if it could not be loaded.
+    // A `lazy` run compiles each function on its first call instead of the whole module up front
+    bool runJIT(int& exit_code, Optimization opt_level=Optimization::O0, bool lazy=false);
+
+    // Loads the compiled module into the JIT and keeps it there until it is unloaded, so its
+    // functions can be looked up one by one. A lazy JIT compiles on a thread of its own, lookups
+    // may then come from any thread
+    bool loadJIT(Optimization opt_level=Optimization::O0, bool lazy=false);
+    // The address of a loaded function, compiling it first if needed, nullptr if there is none
+    void* lookupJIT(std::string const& name);
+    void unloadJIT();
+#endif
 };
 } // namespace vire
\ No newline at end of file
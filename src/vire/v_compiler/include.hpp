@@ -1,3 +1,5 @@
 #pragma once
 
-#include "codegen.hpp"
\ No newline at end of file
+#include "codegen.hpp"
+#include "cache.hpp"
+#include "session.hpp"
\ No newline at end of file
@@ -0,0 +1,130 @@
+#include "session.hpp"
+
+// For the `VIRE_ENABLE_ONLY` initialization macros
+#include "codegen.hpp"
+
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/MC/TargetRegistry.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/Target/TargetOptions.h"
+
+namespace vire
+{
+    VCompilerSession::VCompilerSession()
+    : created(0)
+    {
+        initializeTargets();
+    }
+    VCompilerSession::~VCompilerSession()=default;
+
+    void VCompilerSession::initializeTargets()
+    {
+        static std::once_flag initialized;
+        std::call_once(initialized, []
+        {
+        #ifdef VIRE_ENABLE_ONLY
+            SPECIFIC_INIT_TARGET_INFO(VIRE_ENABLE_ONLY);
+            SPECIFIC_INIT_TARGET(VIRE_ENABLE_ONLY);
+            SPECIFIC_INIT_TARGET_MC(VIRE_ENABLE_ONLY);
+            SPECIFIC_INIT_ASM_PARSER(VIRE_ENABLE_ONLY);
+            SPECIFIC_INIT_ASM_PRINTER(VIRE_ENABLE_ONLY);
+        #endif
+        #ifndef VIRE_ENABLE_ONLY
+            llvm::InitializeAllTargetInfos();
+            llvm::InitializeAllTargets();
+            llvm::InitializeAllTargetMCs();
+            llvm::InitializeAllAsmParsers();
+            llvm::InitializeAllAsmPrinters();
+        #endif
+        });
+    }
+
+    std::unique_ptr<llvm::TargetMachine> VCompilerSession::createTargetMachine(std::string const& triple, std::string const& cpu,
+        std::string const& features, Optimization opt_level, std::string& error)
+    {
+        initializeTargets();
+
+        auto* target=llvm::TargetRegistry::lookupTarget(triple, error);
+        if(!target)
+            return nullptr;
+
+        // The code generator is tuned like the passes before it
+        llvm::CodeGenOpt::Level level;
+        switch(opt_level)
+        {
+            case Optimization::O0: level=llvm::CodeGenOpt::None; break;
+            case Optimization::O1: level=llvm::CodeGenOpt::Less; break;
+            case Optimization::O3: level=llvm::CodeGenOpt::Aggressive; break;
+
+            default: level=llvm::CodeGenOpt::Default;
+        }
+
+        llvm::TargetOptions opt;
+        auto rm=llvm::Optional<llvm::Reloc::Model>();
+        auto cm=llvm::Optional<llvm::CodeModel::Model>();
+
+        return std::unique_ptr<llvm::TargetMachine>(target->createTargetMachine(triple, cpu, features, opt, rm, cm, level));
+    }
+
+    std::shared_ptr<llvm::TargetMachine> VCompilerSession::getTargetMachine(std::string const& triple, std::string const& cpu,
+        std::string const& features, Optimization opt_level, std::string& error)
+    {
+        auto key=triple+'\n'+cpu+'\n'+features+'\n'+std::to_string((int)opt_level);
+
+        std::unique_ptr<llvm::TargetMachine> machine;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto& machines=idle[key];
+            if(!machines.empty())
+            {
+                machine=std::move(machines.back());
+                machines.pop_back();
+            }
+            else
+            {
+                // The target registry is not safe to use concurrently either
+                machine=createTargetMachine(triple, cpu, features, opt_level, error);
+                if(!machine)
+                    return nullptr;
+                ++created;
+            }
+        }
+
+        return std::shared_ptr<llvm::TargetMachine>(machine.release(), [this, key](llvm::TargetMachine* machine)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            idle[key].emplace_back(machine);
+        });
+    }
+    llvm::LLVMContext& VCompilerSession::getContext()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto& context=contexts[std::this_thread::get_id()];
+        if(!context)
+        {
+            context=std::make_unique<llvm::LLVMContext>();
+            context->setOpaquePointers(true);
+        }
+        return *context;
+    }
+    void VCompilerSession::releaseContext(std::thread::id thread)
+    {
+        std::unique_ptr<llvm::LLVMContext> context;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto found=contexts.find(thread);
+            if(found==contexts.end())
+                return;
+
+            context=std::move(found->second);
+            contexts.erase(found);
+        }
+        // Freed after the lock is let go, other threads need not wait on it
+    }
+
+    std::uint64_t VCompilerSession::getTargetMachineCount() const
+    {
+        return created;
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "vire/config/config.hpp"
+
+namespace llvm
+{
+    class LLVMContext;
+    class TargetMachine;
+}
+
+namespace vire
+{
+
+// VCompilerSession - What each compilation would otherwise set up again, for the compilers made
+// with it. Target machines are kept per triple, CPU, features and optimization level and only
+// handed to one compilation at a time, compilations running at once get machines of their own.
+// Compilers made on the same thread share that thread's LLVMContext, a compiler has to stay on
+// the thread it was made on. The session has to outlive its compilers
+class VCompilerSession
+{
+    std::mutex mutex;
+    std::unordered_map<std::string, std::vector<std::unique_ptr<llvm::TargetMachine>>> idle;
+    std::unordered_map<std::thread::id, std::unique_ptr<llvm::LLVMContext>> contexts;
+    std::atomic<std::uint64_t> created;
+public:
+    VCompilerSession();
+    ~VCompilerSession();
+
+    VCompilerSession(VCompilerSession const&)=delete;
+    VCompilerSession& operator=(VCompilerSession const&)=delete;
+
+    // Registers the targets the compiler is built with, once per process however often it is called
+    static void initializeTargets();
+    // Returns nullptr, saying why in `error`, if there is no target for `triple`
+    static std::unique_ptr<llvm::TargetMachine> createTargetMachine(std::string const& triple, std::string const& cpu,
+        std::string const& features, Optimization opt_level, std::string& error);
+
+    // The machine returns to the session when the last copy of the pointer is gone
+    std::shared_ptr<llvm::TargetMachine> getTargetMachine(std::string const& triple, std::string const& cpu,
+        std::string const& features, Optimization opt_level, std::string& error);
+    llvm::LLVMContext& getContext();
+    // Drops `thread`'s context, every compiler made on it has to be gone. Contexts are kept for as
+    // long as the session otherwise, threads that only live for a while are released when done
+    void releaseContext(std::thread::id thread=std::this_thread::get_id());
+
+    // How many target machines the session had to create
+    std::uint64_t getTargetMachineCount() const;
+};
+
+}
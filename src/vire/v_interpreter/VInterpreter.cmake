@@ -0,0 +1,25 @@
+add_library(
+    vire-interpreter
+
+    ${SRC_DIR}/src/vire/v_interpreter/bytecode.hpp
+    ${SRC_DIR}/src/vire/v_interpreter/lowering.hpp
+    ${SRC_DIR}/src/vire/v_interpreter/lowering.cpp
+    ${SRC_DIR}/src/vire/v_interpreter/interpreter.hpp
+    ${SRC_DIR}/src/vire/v_interpreter/interpreter.cpp
+)
+
+target_link_libraries(vire-interpreter PRIVATE vire-proto-file vire-analyzer ${CMAKE_DL_LIBS})
+target_link_libraries(VIRELANG PRIVATE vire-interpreter)
+
+# Tiering promotes hot functions to native code, builds without the code generator leave it out
+if(TARGET vire-compiler)
+    add_library(
+        vire-tiering
+
+        ${SRC_DIR}/src/vire/v_interpreter/tiering.hpp
+        ${SRC_DIR}/src/vire/v_interpreter/tiering.cpp
+    )
+
+    target_link_libraries(vire-tiering PRIVATE vire-interpreter vire-compiler)
+    target_link_libraries(VIRELANG PRIVATE vire-tiering)
+endif()
@@ -0,0 +1,192 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace vire
+{
+
+// Value - One register. Integers are kept sign extended from their width, floats are kept as
+// doubles rounded to float precision, so every operation can work on the full 64 bits
+union Value
+{
+    int64_t i;
+    double d;
+    void* p;
+};
+
+// The machine type a value has in the LLVM output, the interpreter follows the same widths
+enum ValueKind : uint8_t
+{
+    kind_void,
+    kind_i1,
+    kind_i8,
+    kind_i16,
+    kind_i32,
+    kind_i64,
+    kind_f32,
+    kind_f64,
+    kind_ptr,       // arrays and structs, which live in memory
+};
+
+inline bool isKindFloatingPoint(ValueKind kind)
+{
+    return kind==kind_f32 || kind==kind_f64;
+}
+
+// The opcodes in order, so the interpreter's dispatch table is built from the same list
+#define VIRE_OPCODES(X) \
+    X(op_mov)       /* a=b */ \
+    X(op_loadi)     /* a=imm32 */ \
+    X(op_loadk)     /* a=constants[imm32] */ \
+    \
+    X(op_add32)     /* a=b+c, and likewise for the rest */ \
+    X(op_sub32) \
+    X(op_mul32) \
+    X(op_div32) \
+    X(op_rem32) \
+    X(op_add64) \
+    X(op_sub64) \
+    X(op_mul64) \
+    X(op_div64) \
+    X(op_rem64) \
+    X(op_addi32)    /* a=b+(int16)c */ \
+    X(op_addi64) \
+    \
+    X(op_fadd) \
+    X(op_fsub) \
+    X(op_fmul) \
+    X(op_fdiv) \
+    \
+    X(op_eq)        /* a=b==c, integers */ \
+    X(op_ne) \
+    X(op_lt) \
+    X(op_le) \
+    X(op_gt) \
+    X(op_ge) \
+    X(op_feq)       /* ordered comparisons, false if either side is NaN */ \
+    X(op_fne) \
+    X(op_flt) \
+    X(op_fle) \
+    X(op_fgt) \
+    X(op_fge) \
+    \
+    X(op_sext8)     /* a=b sign extended from the low bits */ \
+    X(op_sext16) \
+    X(op_sext32) \
+    X(op_zext1)     /* a=b zero extended from the low bits */ \
+    X(op_zext8) \
+    X(op_zext16) \
+    X(op_zext32) \
+    X(op_i2f)       /* a=(double)b */ \
+    X(op_f2i)       /* a=(int64)b */ \
+    X(op_f32)       /* a=b rounded to float */ \
+    \
+    X(op_frame)     /* a=address of the call's memory+imm32 */ \
+    X(op_data)      /* a=address of the function's data+imm32 */ \
+    X(op_index)     /* a=b+c*a, `a` holds the element size beforehand */ \
+    X(op_ld1)       /* a=*(b+c), zero extended */ \
+    X(op_ld8)       /* a=*(b+c), sign extended */ \
+    X(op_ld16) \
+    X(op_ld32) \
+    X(op_ld64) \
+    X(op_ldf32) \
+    X(op_ldf64) \
+    X(op_st8)       /* *(a+c)=b */ \
+    X(op_st16) \
+    X(op_st32) \
+    X(op_st64) \
+    X(op_stf32) \
+    X(op_stf64) \
+    X(op_copy)      /* copy c bytes, counted in a register, from b to a */ \
+    \
+    X(op_jmp)       /* goto imm32 */ \
+    X(op_jz)        /* if(!a) goto imm32 */ \
+    X(op_jnz)       /* if(a) goto imm32 */ \
+    X(op_loop)      /* goto imm32, counted as a loop iteration */ \
+    \
+    X(op_call)      /* a=functions[b](a...a+c-1) */ \
+    X(op_callx)     /* a=externs[b](a...a+c-1) */ \
+    X(op_ret)       /* return a */ \
+    X(op_retv)      /* return */
+
+enum Opcode : uint8_t
+{
+#define VIRE_OPCODE_ENUM(name) name,
+    VIRE_OPCODES(VIRE_OPCODE_ENUM)
+#undef VIRE_OPCODE_ENUM
+
+    op_count,
+};
+
+// Instruction - Three 16 bit register operands, jumps and immediates take `b` and `c` together
+struct Instruction
+{
+    Opcode op;
+    uint16_t a;
+    uint16_t b;
+    uint16_t c;
+
+    int32_t imm() const
+    {
+        return (int32_t)((uint32_t)b | ((uint32_t)c<<16));
+    }
+    void setImm(int32_t value)
+    {
+        b=(uint16_t)((uint32_t)value & 0xFFFF);
+        c=(uint16_t)((uint32_t)value >> 16);
+    }
+};
+
+// Signature - What a native function takes and returns, used to call externs and promoted functions
+struct Signature
+{
+    std::vector<ValueKind> args;
+    ValueKind ret=kind_void;
+};
+
+// BytecodeFunction - A lowered function. Its arguments are its first registers and a call
+// places them at the top of the caller's, so the callee's frame starts where they are. Arrays
+// and structs get `frame_size` bytes of memory per call, array literals are kept in `data`.
+// A function returning one of them is passed where to put it as a hidden first argument
+struct BytecodeFunction
+{
+    std::string name;
+    std::string native_name;
+    Signature signature;
+
+    std::vector<Instruction> code;
+    std::vector<Value> constants;
+    std::vector<uint8_t> data;
+    uint32_t register_count=0;
+    uint32_t frame_size=0;
+
+    // Tiering, counted by the interpreter and filled in by whoever compiles it natively
+    uint32_t calls=0;
+    uint32_t loops=0;
+    bool promotable=false;
+    bool promotion_requested=false;
+    std::atomic<void*> native{nullptr};
+};
+
+struct BytecodeExtern
+{
+    std::string name;
+    Signature signature;
+    void* address=nullptr;
+};
+
+// BytecodeModule - Every function of a verified module and the `main` that runs its global
+// statements and then calls the user's
+struct BytecodeModule
+{
+    std::vector<std::unique_ptr<BytecodeFunction>> functions;
+    std::vector<BytecodeExtern> externs;
+    std::size_t entry=0;
+};
+
+}
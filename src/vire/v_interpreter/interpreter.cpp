@@ -0,0 +1,405 @@
+#include "interpreter.hpp"
+
+#include <cstring>
+#include <iostream>
+#include <ostream>
+
+#if !defined(_WIN32) && !defined(VIRE_USE_EMCC)
+#include <dlfcn.h>
+#endif
+
+namespace vire
+{
+    void VInterpreter::addHostSymbol(std::string const& name, void* address)
+    {
+        host_symbols[name]=address;
+    }
+    void VInterpreter::setPromotionHandler(std::function<void(BytecodeFunction*)> handler, uint32_t call_threshold, uint32_t loop_threshold)
+    {
+        promote=std::move(handler);
+        this->call_threshold=call_threshold;
+        this->loop_threshold=loop_threshold;
+    }
+    void VInterpreter::setMemorySize(std::size_t size)
+    {
+        memory_size=size;
+    }
+
+    bool VInterpreter::link()
+    {
+        for(auto& ext : module->externs)
+        {
+            if(!canCallNative())
+            {
+                std::cout << "Calling `" << ext.name << "` is not supported by the interpreter on this platform" << std::endl;
+                return false;
+            }
+
+            unsigned int ints=0, fps=0;
+            for(auto kind : ext.signature.args)
+                isKindFloatingPoint(kind)?++fps:++ints;
+            if(ints>6 || fps>8)
+            {
+                std::cout << "`" << ext.name << "` takes too many arguments to be called by the interpreter" << std::endl;
+                return false;
+            }
+
+            auto it=host_symbols.find(ext.name);
+            if(it!=host_symbols.end())
+            {
+                ext.address=it->second;
+                continue;
+            }
+#if !defined(_WIN32) && !defined(VIRE_USE_EMCC)
+            ext.address=dlsym(RTLD_DEFAULT, ext.name.c_str());
+#endif
+            if(!ext.address)
+            {
+                std::cout << "Could not find the extern `" << ext.name << "`" << std::endl;
+                return false;
+            }
+        }
+        return true;
+    }
+    bool VInterpreter::run(int& exit_code)
+    {
+        if(!link())
+            return false;
+
+        auto* entry=module->functions[module->entry].get();
+        stack.assign(entry->register_count>0?entry->register_count:1, Value{0});
+        // Sized once up front, the addresses the program holds must stay valid
+        memory.assign(memory_size, 0);
+        memory_top=0;
+        trapped=false;
+
+        exit_code=(int)execute(entry, 0).i;
+        if(trapped)
+        {
+            std::cout << "The program ran out of interpreter memory" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    void VInterpreter::requestPromotion(BytecodeFunction* function)
+    {
+        function->promotion_requested=true;
+        promote(function);
+    }
+
+    // Under VIRE_COMPUTED_GOTO every handler ends by jumping to the next one itself and the switch
+    // is only entered once, otherwise each handler breaks back to it
+#ifdef VIRE_COMPUTED_GOTO
+#define VIRE_OP(name) case name: label_##name:
+#define VIRE_NEXT() ins=ip++; goto *labels[ins->op]
+#else
+#define VIRE_OP(name) case name:
+#define VIRE_NEXT() break
+#endif
+
+    Value VInterpreter::execute(BytecodeFunction* function, std::size_t base)
+    {
+        if(stack.size()<base+function->register_count)
+            stack.resize(base+function->register_count);
+
+        // Frames start 16 byte aligned, as the compiled allocas do
+        auto frame_start=memory_top;
+        auto frame_offset=(memory_top+15)/16*16;
+        if(frame_offset+function->frame_size>memory.size())
+        {
+            trapped=true;
+            return Value{0};
+        }
+        memory_top=frame_offset+function->frame_size;
+        uint8_t* frame=memory.data()+frame_offset;
+
+#ifdef VIRE_COMPUTED_GOTO
+#define VIRE_OPCODE_LABEL(name) &&label_##name,
+        static void* const labels[op_count]={ VIRE_OPCODES(VIRE_OPCODE_LABEL) };
+#undef VIRE_OPCODE_LABEL
+#endif
+
+        Instruction const* code=function->code.data();
+        Value const* constants=function->constants.data();
+        uint8_t* data=function->data.data();
+        Value* r=stack.data()+base;
+        Instruction const* ip=code;
+        Instruction const* ins;
+
+        while(true)
+        {
+            ins=ip++;
+            switch(ins->op)
+            {
+                VIRE_OP(op_mov)     r[ins->a]=r[ins->b]; VIRE_NEXT();
+                VIRE_OP(op_loadi)   r[ins->a].i=ins->imm(); VIRE_NEXT();
+                VIRE_OP(op_loadk)   r[ins->a]=constants[ins->imm()]; VIRE_NEXT();
+
+                // 32 bit operations wrap like the compiled ones, division by zero gives zero
+                // instead of trapping
+                VIRE_OP(op_add32)   r[ins->a].i=(int32_t)((uint32_t)r[ins->b].i+(uint32_t)r[ins->c].i); VIRE_NEXT();
+                VIRE_OP(op_sub32)   r[ins->a].i=(int32_t)((uint32_t)r[ins->b].i-(uint32_t)r[ins->c].i); VIRE_NEXT();
+                VIRE_OP(op_mul32)   r[ins->a].i=(int32_t)((uint32_t)r[ins->b].i*(uint32_t)r[ins->c].i); VIRE_NEXT();
+                VIRE_OP(op_div32)
+                {
+                    auto lhs=(int32_t)r[ins->b].i, rhs=(int32_t)r[ins->c].i;
+                    r[ins->a].i=(rhs==0)?0:(rhs==-1)?(int32_t)(0u-(uint32_t)lhs):lhs/rhs;
+                    VIRE_NEXT();
+                }
+                VIRE_OP(op_rem32)
+                {
+                    auto lhs=(int32_t)r[ins->b].i, rhs=(int32_t)r[ins->c].i;
+                    r[ins->a].i=(rhs==0 || rhs==-1)?0:lhs%rhs;
+                    VIRE_NEXT();
+                }
+                VIRE_OP(op_add64)   r[ins->a].i=(int64_t)((uint64_t)r[ins->b].i+(uint64_t)r[ins->c].i); VIRE_NEXT();
+                VIRE_OP(op_sub64)   r[ins->a].i=(int64_t)((uint64_t)r[ins->b].i-(uint64_t)r[ins->c].i); VIRE_NEXT();
+                VIRE_OP(op_mul64)   r[ins->a].i=(int64_t)((uint64_t)r[ins->b].i*(uint64_t)r[ins->c].i); VIRE_NEXT();
+                VIRE_OP(op_div64)
+                {
+                    auto lhs=r[ins->b].i, rhs=r[ins->c].i;
+                    r[ins->a].i=(rhs==0)?0:(rhs==-1)?(int64_t)(0ull-(uint64_t)lhs):lhs/rhs;
+                    VIRE_NEXT();
+                }
+                VIRE_OP(op_rem64)
+                {
+                    auto lhs=r[ins->b].i, rhs=r[ins->c].i;
+                    r[ins->a].i=(rhs==0 || rhs==-1)?0:lhs%rhs;
+                    VIRE_NEXT();
+                }
+                VIRE_OP(op_addi32)  r[ins->a].i=(int32_t)((uint32_t)r[ins->b].i+(uint32_t)(int16_t)ins->c); VIRE_NEXT();
+                VIRE_OP(op_addi64)  r[ins->a].i=(int64_t)((uint64_t)r[ins->b].i+(uint64_t)(int16_t)ins->c); VIRE_NEXT();
+
+                VIRE_OP(op_fadd)    r[ins->a].d=r[ins->b].d+r[ins->c].d; VIRE_NEXT();
+                VIRE_OP(op_fsub)    r[ins->a].d=r[ins->b].d-r[ins->c].d; VIRE_NEXT();
+                VIRE_OP(op_fmul)    r[ins->a].d=r[ins->b].d*r[ins->c].d; VIRE_NEXT();
+                VIRE_OP(op_fdiv)    r[ins->a].d=r[ins->b].d/r[ins->c].d; VIRE_NEXT();
+
+                VIRE_OP(op_eq)      r[ins->a].i=r[ins->b].i==r[ins->c].i; VIRE_NEXT();
+                VIRE_OP(op_ne)      r[ins->a].i=r[ins->b].i!=r[ins->c].i; VIRE_NEXT();
+                VIRE_OP(op_lt)      r[ins->a].i=r[ins->b].i<r[ins->c].i; VIRE_NEXT();
+                VIRE_OP(op_le)      r[ins->a].i=r[ins->b].i<=r[ins->c].i; VIRE_NEXT();
+                VIRE_OP(op_gt)      r[ins->a].i=r[ins->b].i>r[ins->c].i; VIRE_NEXT();
+                VIRE_OP(op_ge)      r[ins->a].i=r[ins->b].i>=r[ins->c].i; VIRE_NEXT();
+                VIRE_OP(op_feq)     r[ins->a].i=r[ins->b].d==r[ins->c].d; VIRE_NEXT();
+                VIRE_OP(op_fne)     r[ins->a].i=(r[ins->b].d<r[ins->c].d) || (r[ins->b].d>r[ins->c].d); VIRE_NEXT();
+                VIRE_OP(op_flt)     r[ins->a].i=r[ins->b].d<r[ins->c].d; VIRE_NEXT();
+                VIRE_OP(op_fle)     r[ins->a].i=r[ins->b].d<=r[ins->c].d; VIRE_NEXT();
+                VIRE_OP(op_fgt)     r[ins->a].i=r[ins->b].d>r[ins->c].d; VIRE_NEXT();
+                VIRE_OP(op_fge)     r[ins->a].i=r[ins->b].d>=r[ins->c].d; VIRE_NEXT();
+
+                VIRE_OP(op_sext8)   r[ins->a].i=(int8_t)r[ins->b].i; VIRE_NEXT();
+                VIRE_OP(op_sext16)  r[ins->a].i=(int16_t)r[ins->b].i; VIRE_NEXT();
+                VIRE_OP(op_sext32)  r[ins->a].i=(int32_t)r[ins->b].i; VIRE_NEXT();
+                VIRE_OP(op_zext1)   r[ins->a].i=r[ins->b].i & 1; VIRE_NEXT();
+                VIRE_OP(op_zext8)   r[ins->a].i=(uint8_t)r[ins->b].i; VIRE_NEXT();
+                VIRE_OP(op_zext16)  r[ins->a].i=(uint16_t)r[ins->b].i; VIRE_NEXT();
+                VIRE_OP(op_zext32)  r[ins->a].i=(uint32_t)r[ins->b].i; VIRE_NEXT();
+                VIRE_OP(op_i2f)     r[ins->a].d=(double)r[ins->b].i; VIRE_NEXT();
+                VIRE_OP(op_f2i)     r[ins->a].i=(int64_t)r[ins->b].d; VIRE_NEXT();
+                VIRE_OP(op_f32)     r[ins->a].d=(double)(float)r[ins->b].d; VIRE_NEXT();
+
+                // Memory is accessed through memcpy, members and elements need not be aligned
+                VIRE_OP(op_frame)   r[ins->a].p=frame+ins->imm(); VIRE_NEXT();
+                VIRE_OP(op_data)    r[ins->a].p=data+ins->imm(); VIRE_NEXT();
+                VIRE_OP(op_index)   r[ins->a].p=(uint8_t*)r[ins->b].p+r[ins->c].i*r[ins->a].i; VIRE_NEXT();
+                VIRE_OP(op_ld1)
+                {
+                    uint8_t value;
+                    std::memcpy(&value, (uint8_t*)r[ins->b].p+ins->c, sizeof(value));
+                    r[ins->a].i=value & 1;
+                    VIRE_NEXT();
+                }
+                VIRE_OP(op_ld8)
+                {
+                    int8_t value;
+                    std::memcpy(&value, (uint8_t*)r[ins->b].p+ins->c, sizeof(value));
+                    r[ins->a].i=value;
+                    VIRE_NEXT();
+                }
+                VIRE_OP(op_ld16)
+                {
+                    int16_t value;
+                    std::memcpy(&value, (uint8_t*)r[ins->b].p+ins->c, sizeof(value));
+                    r[ins->a].i=value;
+                    VIRE_NEXT();
+                }
+                VIRE_OP(op_ld32)
+                {
+                    int32_t value;
+                    std::memcpy(&value, (uint8_t*)r[ins->b].p+ins->c, sizeof(value));
+                    r[ins->a].i=value;
+                    VIRE_NEXT();
+                }
+                VIRE_OP(op_ld64)    std::memcpy(&r[ins->a].i, (uint8_t*)r[ins->b].p+ins->c, sizeof(int64_t)); VIRE_NEXT();
+                VIRE_OP(op_ldf32)
+                {
+                    float value;
+                    std::memcpy(&value, (uint8_t*)r[ins->b].p+ins->c, sizeof(value));
+                    r[ins->a].d=value;
+                    VIRE_NEXT();
+                }
+                VIRE_OP(op_ldf64)   std::memcpy(&r[ins->a].d, (uint8_t*)r[ins->b].p+ins->c, sizeof(double)); VIRE_NEXT();
+                VIRE_OP(op_st8)
+                {
+                    auto value=(int8_t)r[ins->b].i;
+                    std::memcpy((uint8_t*)r[ins->a].p+ins->c, &value, sizeof(value));
+                    VIRE_NEXT();
+                }
+                VIRE_OP(op_st16)
+                {
+                    auto value=(int16_t)r[ins->b].i;
+                    std::memcpy((uint8_t*)r[ins->a].p+ins->c, &value, sizeof(value));
+                    VIRE_NEXT();
+                }
+                VIRE_OP(op_st32)
+                {
+                    auto value=(int32_t)r[ins->b].i;
+                    std::memcpy((uint8_t*)r[ins->a].p+ins->c, &value, sizeof(value));
+                    VIRE_NEXT();
+                }
+                VIRE_OP(op_st64)    std::memcpy((uint8_t*)r[ins->a].p+ins->c, &r[ins->b].i, sizeof(int64_t)); VIRE_NEXT();
+                VIRE_OP(op_stf32)
+                {
+                    auto value=(float)r[ins->b].d;
+                    std::memcpy((uint8_t*)r[ins->a].p+ins->c, &value, sizeof(value));
+                    VIRE_NEXT();
+                }
+                VIRE_OP(op_stf64)   std::memcpy((uint8_t*)r[ins->a].p+ins->c, &r[ins->b].d, sizeof(double)); VIRE_NEXT();
+                VIRE_OP(op_copy)    std::memmove(r[ins->a].p, r[ins->b].p, r[ins->c].i); VIRE_NEXT();
+
+                VIRE_OP(op_jmp)     ip=code+ins->imm(); VIRE_NEXT();
+                VIRE_OP(op_jz)      if(!r[ins->a].i) ip=code+ins->imm(); VIRE_NEXT();
+                VIRE_OP(op_jnz)     if(r[ins->a].i) ip=code+ins->imm(); VIRE_NEXT();
+                VIRE_OP(op_loop)
+                {
+                    ip=code+ins->imm();
+                    if(promote && function->promotable && !function->promotion_requested && ++function->loops>=loop_threshold)
+                        requestPromotion(function);
+                    VIRE_NEXT();
+                }
+
+                VIRE_OP(op_call)
+                {
+                    auto* callee=module->functions[ins->b].get();
+                    Value result;
+                    if(void* native=callee->native.load(std::memory_order_acquire))
+                    {
+                        result=callNative(native, callee->signature, r+ins->a);
+                    }
+                    else
+                    {
+                        if(promote && callee->promotable && !callee->promotion_requested && ++callee->calls>=call_threshold)
+                            requestPromotion(callee);
+
+                        result=execute(callee, base+ins->a);
+                        if(trapped)
+                            return Value{0};
+                        // The callee may have grown the stack
+                        r=stack.data()+base;
+                    }
+                    r[ins->a]=result;
+                    VIRE_NEXT();
+                }
+                VIRE_OP(op_callx)
+                {
+                    auto const& ext=module->externs[ins->b];
+                    r[ins->a]=callNative(ext.address, ext.signature, r+ins->a);
+                    VIRE_NEXT();
+                }
+                VIRE_OP(op_ret)
+                {
+                    memory_top=frame_start;
+                    return r[ins->a];
+                }
+                VIRE_OP(op_retv)
+                {
+                    memory_top=frame_start;
+                    return Value{0};
+                }
+
+                default:
+                {
+                    memory_top=frame_start;
+                    return Value{0};
+                }
+            }
+        }
+    }
+
+#undef VIRE_OP
+#undef VIRE_NEXT
+
+    bool VInterpreter::canCallNative()
+    {
+#ifdef VIRE_NATIVE_CALLS
+        return true;
+#else
+        return false;
+#endif
+    }
+    // Every integer argument register and every floating point one is loaded and the callee picks
+    // the ones its signature assigns, a float travels in the low half of its register
+    Value VInterpreter::callNative(void* address, Signature const& signature, Value const* args)
+    {
+        Value result;
+        result.i=0;
+#ifdef VIRE_NATIVE_CALLS
+        int64_t ints[6]={0};
+        double fps[8]={0};
+        unsigned int int_count=0, fp_count=0;
+        for(std::size_t i=0; i<signature.args.size(); ++i)
+        {
+            switch(signature.args[i])
+            {
+                case kind_f32:
+                {
+                    float value=(float)args[i].d;
+                    std::memcpy(&fps[fp_count++], &value, sizeof(value));
+                    break;
+                }
+                case kind_f64: fps[fp_count++]=args[i].d; break;
+                default:       ints[int_count++]=args[i].i; break;
+            }
+        }
+
+        if(isKindFloatingPoint(signature.ret))
+        {
+            using NativeFunction=double(*)(int64_t, int64_t, int64_t, int64_t, int64_t, int64_t,
+                double, double, double, double, double, double, double, double);
+            double value=((NativeFunction)address)(ints[0], ints[1], ints[2], ints[3], ints[4], ints[5],
+                fps[0], fps[1], fps[2], fps[3], fps[4], fps[5], fps[6], fps[7]);
+
+            if(signature.ret==kind_f32)
+            {
+                float narrow;
+                std::memcpy(&narrow, &value, sizeof(narrow));
+                result.d=narrow;
+            }
+            else
+            {
+                result.d=value;
+            }
+            return result;
+        }
+
+        using NativeFunction=int64_t(*)(int64_t, int64_t, int64_t, int64_t, int64_t, int64_t,
+            double, double, double, double, double, double, double, double);
+        int64_t value=((NativeFunction)address)(ints[0], ints[1], ints[2], ints[3], ints[4], ints[5],
+            fps[0], fps[1], fps[2], fps[3], fps[4], fps[5], fps[6], fps[7]);
+
+        // Only the low bits of the return register are defined
+        switch(signature.ret)
+        {
+            case kind_i1:  result.i=value & 1; break;
+            case kind_i8:  result.i=(int8_t)value; break;
+            case kind_i16: result.i=(int16_t)value; break;
+            case kind_i32: result.i=(int32_t)value; break;
+            case kind_i64: result.i=value; break;
+            default:       break;
+        }
+#endif
+        return result;
+    }
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "bytecode.hpp"
+
+// Native code is called by passing every argument register at once, which only works where the
+// calling convention assigns integer and floating point registers independently of each other
+#if ((defined(__x86_64__) && !defined(_WIN32)) || defined(__aarch64__)) && !defined(VIRE_USE_EMCC)
+#define VIRE_NATIVE_CALLS
+#endif
+
+// Each handler jumps straight to the next one through a table of label addresses where the
+// compiler supports it, one indirect branch per handler predicts far better than a shared switch
+#if defined(__GNUC__) && !defined(VIRE_NO_COMPUTED_GOTO)
+#define VIRE_COMPUTED_GOTO
+#endif
+
+namespace vire
+{
+
+// VInterpreter - Runs a BytecodeModule. Calls and loop back-edges are counted per function and
+// once a function is hot it is handed to the promotion handler, when that fills in its `native`
+// address the following calls to it go to the compiled code instead. Arrays and structs live
+// in `memory`, every call takes its function's frame_size from the top and gives it back on return
+class VInterpreter
+{
+    BytecodeModule* module;
+    std::vector<Value> stack;
+    std::vector<uint8_t> memory;
+    std::size_t memory_size;
+    std::size_t memory_top;
+    bool trapped;
+    std::unordered_map<std::string, void*> host_symbols;
+
+    std::function<void(BytecodeFunction*)> promote;
+    uint32_t call_threshold;
+    uint32_t loop_threshold;
+private:
+    Value execute(BytecodeFunction* function, std::size_t base);
+    void requestPromotion(BytecodeFunction* function);
+public:
+    VInterpreter(BytecodeModule* module)
+    : module(module), memory_size(8*1024*1024), memory_top(0), trapped(false), call_threshold(1000), loop_threshold(10000)
+    {}
+
+    // Externs resolve against these first, then against the symbols the host process exports
+    void addHostSymbol(std::string const& name, void* address);
+    void setPromotionHandler(std::function<void(BytecodeFunction*)> handler, uint32_t call_threshold=1000, uint32_t loop_threshold=10000);
+    // How many bytes the frames of all active calls may take together, 8MiB by default
+    void setMemorySize(std::size_t size);
+
+    // Returns false, after saying which, if an extern could not be found
+    bool link();
+    // Returns false if the program could not be started or ran out of memory
+    bool run(int& exit_code);
+
+    static bool canCallNative();
+    static Value callNative(void* address, Signature const& signature, Value const* args);
+};
+
+}
@@ -0,0 +1,1320 @@
+#include "lowering.hpp"
+
+#include <iostream>
+#include <ostream>
+
+namespace vire
+{
+    ValueKind VBytecodeCompiler::getKind(types::Base* type)
+    {
+        switch(type->getType())
+        {
+            case types::EType::Void:    return kind_void;
+            case types::EType::Bool:    return kind_i1;
+            case types::EType::Char:    return kind_i8;
+            case types::EType::Short:   return kind_i16;
+            case types::EType::Int:     return kind_i32;
+            case types::EType::Long:    return kind_i64;
+            case types::EType::Float:   return kind_f32;
+            case types::EType::Double:  return kind_f64;
+            case types::EType::Array:
+            case types::EType::Custom:  return kind_ptr;
+            default:                    return kind_void;
+        }
+    }
+    static bool isScalar(types::Base* type)
+    {
+        return type->getType()!=types::EType::Array && type->getType()!=types::EType::Custom
+            && type->getType()!=types::EType::Any && (type->getType()!=types::EType::Void || type->getSize()==0);
+    }
+
+    // Promoted functions are called through the argument registers alone
+    static bool fitsInRegisters(Signature const& signature)
+    {
+        unsigned int ints=0, fps=0;
+        for(auto kind : signature.args)
+        {
+            if(kind==kind_ptr)
+                return false;
+            isKindFloatingPoint(kind)?++fps:++ints;
+        }
+        return ints<=6 && fps<=8;
+    }
+
+    VBytecodeCompiler::Operand VBytecodeCompiler::fail(std::string const& what)
+    {
+        if(!failed)
+        {
+            std::cout << "The interpreter does not support " << what;
+            if(current)
+                std::cout << " (in `" << current->name << "`)";
+            std::cout << std::endl;
+        }
+        failed=true;
+        return Operand{0, kind_void};
+    }
+
+    uint16_t VBytecodeCompiler::allocate(unsigned int count)
+    {
+        auto reg=next_register;
+        next_register+=count;
+        if(next_register>UINT16_MAX)
+        {
+            fail("functions with this many values");
+            next_register=first_temporary;
+            return 0;
+        }
+        if(next_register>current->register_count)
+            current->register_count=next_register;
+
+        return reg;
+    }
+    // Frame memory is handed out once per function, a slot belongs to one value for the whole call
+    uint32_t VBytecodeCompiler::allocateFrame(types::Base* type)
+    {
+        uint32_t size, align;
+        if(!getSizeAndAlign(type, size, align))
+            return 0;
+
+        auto offset=(current->frame_size+align-1)/align*align;
+        current->frame_size=offset+size;
+        return offset;
+    }
+    std::size_t VBytecodeCompiler::emit(Opcode op, uint16_t a, uint16_t b, uint16_t c)
+    {
+        current->code.push_back(Instruction{op, a, b, c});
+        return current->code.size()-1;
+    }
+    std::size_t VBytecodeCompiler::emitJump(Opcode op, int32_t target, uint16_t a)
+    {
+        auto jump=emit(op, a);
+        current->code[jump].setImm(target);
+        return jump;
+    }
+    void VBytecodeCompiler::patch(std::size_t jump, int32_t target)
+    {
+        current->code[jump].setImm(target);
+    }
+    int32_t VBytecodeCompiler::here() const
+    {
+        return current->code.size();
+    }
+    uint16_t VBytecodeCompiler::loadConstant(Value value, int target)
+    {
+        auto reg=target>=0?(uint16_t)target:allocate();
+        if(value.i>=INT32_MIN && value.i<=INT32_MAX)
+        {
+            auto load=emit(op_loadi, reg);
+            current->code[load].setImm((int32_t)value.i);
+        }
+        else
+        {
+            current->constants.push_back(value);
+            auto load=emit(op_loadk, reg);
+            current->code[load].setImm(current->constants.size()-1);
+        }
+        return reg;
+    }
+    // Brings a register back to the width of its kind after a 64 bit operation
+    void VBytecodeCompiler::normalize(uint16_t reg, ValueKind kind)
+    {
+        switch(kind)
+        {
+            case kind_i1:  emit(op_zext1, reg, reg); break;
+            case kind_i8:  emit(op_sext8, reg, reg); break;
+            case kind_i16: emit(op_sext16, reg, reg); break;
+            case kind_i32: emit(op_sext32, reg, reg); break;
+            case kind_f32: emit(op_f32, reg, reg); break;
+            default: break;
+        }
+    }
+    // Variables are read straight from their register, an operand that changes them has to be
+    // evaluated after the variables to its left have been copied out
+    bool VBytecodeCompiler::hasSideEffects(ExprAST* const expr) const
+    {
+        if(!expr)
+            return false;
+
+        switch(expr->asttype)
+        {
+            case ast_incrdecr:
+            case ast_varassign:
+                return true;
+            case ast_binop:
+                return hasSideEffects(((BinaryExprAST*)expr)->getLHS()) || hasSideEffects(((BinaryExprAST*)expr)->getRHS());
+            case ast_cast:
+                return hasSideEffects(((CastExprAST*)expr)->getExpr());
+            case ast_call:
+                for(auto const& arg : ((CallExprAST*)expr)->getArgs())
+                    if(hasSideEffects(arg.get()))
+                        return true;
+                return false;
+            case ast_array_access:
+                for(auto const& index : ((VariableArrayAccessAST*)expr)->getIndices())
+                    if(hasSideEffects(index.get()))
+                        return true;
+                return false;
+            default:
+                return false;
+        }
+    }
+
+    VBytecodeCompiler::Layout const* VBytecodeCompiler::getLayout(StructExprAST* const st)
+    {
+        auto it=layouts.find(st);
+        if(it!=layouts.end())
+            return &it->second;
+
+        auto const& values=st->getMembersValues();
+        Layout layout;
+        layout.offsets.resize(values.size());
+
+        // Member `k` is the k-th element, which was declared k-th from the end
+        for(std::size_t k=0; k<values.size(); ++k)
+        {
+            auto* member=values[values.size()-1-k];
+            uint32_t size, align;
+            if(member->asttype==ast_struct)
+            {
+                auto const* inner=getLayout((StructExprAST*)member);
+                if(!inner)
+                    return nullptr;
+                size=inner->size;
+                align=inner->align;
+            }
+            else if(types::isUserDefined(member->getType()))
+            {
+                // The compiled code only keeps a pointer to these
+                fail("struct members of another struct's type");
+                return nullptr;
+            }
+            else if(!getSizeAndAlign(member->getType(), size, align))
+            {
+                return nullptr;
+            }
+
+            layout.offsets[k]=(layout.size+align-1)/align*align;
+            layout.size=layout.offsets[k]+size;
+            if(align>layout.align)
+                layout.align=align;
+        }
+        layout.size=(layout.size+layout.align-1)/layout.align*layout.align;
+
+        return &layouts.emplace(st, std::move(layout)).first->second;
+    }
+    // Sizes are worked out here, types::Base::getSize does not fit larger arrays
+    bool VBytecodeCompiler::getSizeAndAlign(types::Base* type, uint32_t& size, uint32_t& align)
+    {
+        switch(type->getType())
+        {
+            case types::EType::Bool:
+            case types::EType::Char:    size=align=1; return true;
+            case types::EType::Short:   size=align=2; return true;
+            case types::EType::Int:
+            case types::EType::Float:   size=align=4; return true;
+            case types::EType::Long:
+            case types::EType::Double:  size=align=8; return true;
+            case types::EType::Array:
+            {
+                auto* array=(types::Array*)type;
+                if(!getSizeAndAlign(array->getChild(), size, align))
+                    return false;
+                size*=array->getLength();
+                return true;
+            }
+            case types::EType::Custom:
+            {
+                auto* st=analyzer->getStruct(((types::Custom*)type)->getName());
+                if(!st)
+                {
+                    fail("unions and classes");
+                    return false;
+                }
+                auto const* layout=getLayout(st);
+                if(!layout)
+                    return false;
+                size=layout->size;
+                align=layout->align;
+                return true;
+            }
+            default:
+                fail("values of this type in memory");
+                return false;
+        }
+    }
+    uint32_t VBytecodeCompiler::getSize(types::Base* type)
+    {
+        uint32_t size=0, align;
+        getSizeAndAlign(type, size, align);
+        return size;
+    }
+    bool VBytecodeCompiler::isAggregate(types::Base* type) const
+    {
+        return type->getType()==types::EType::Array || type->getType()==types::EType::Custom;
+    }
+
+    // Loads and stores take a 16 bit offset, anything further is added to the pointer first
+    VBytecodeCompiler::Address VBytecodeCompiler::fitOffset(Address address)
+    {
+        if(address.offset<=INT16_MAX)
+            return address;
+
+        Value offset;
+        offset.i=address.offset;
+        auto reg=loadConstant(offset, -1);
+        emit(op_add64, reg, address.reg, reg);
+        return Address{reg, 0, address.type};
+    }
+    VBytecodeCompiler::Operand VBytecodeCompiler::loadFrom(Address address, int target)
+    {
+        address=fitOffset(address);
+        auto kind=getKind(address.type);
+        auto dest=target>=0?(uint16_t)target:allocate();
+
+        // Arrays and structs inside others are used through their address
+        Opcode op;
+        switch(kind)
+        {
+            case kind_i1:  op=op_ld1; break;
+            case kind_i8:  op=op_ld8; break;
+            case kind_i16: op=op_ld16; break;
+            case kind_i32: op=op_ld32; break;
+            case kind_i64: op=op_ld64; break;
+            case kind_f32: op=op_ldf32; break;
+            case kind_f64: op=op_ldf64; break;
+            case kind_ptr:
+                emit(op_addi64, dest, address.reg, address.offset);
+                return Operand{dest, kind_ptr};
+            default:
+                return fail("loading values of this type");
+        }
+        emit(op, dest, address.reg, address.offset);
+        return Operand{dest, kind};
+    }
+    void VBytecodeCompiler::storeTo(Address address, Operand value)
+    {
+        address=fitOffset(address);
+
+        Opcode op;
+        switch(getKind(address.type))
+        {
+            case kind_i1:
+            case kind_i8:  op=op_st8; break;
+            case kind_i16: op=op_st16; break;
+            case kind_i32: op=op_st32; break;
+            case kind_i64: op=op_st64; break;
+            case kind_f32: op=op_stf32; break;
+            case kind_f64: op=op_stf64; break;
+            case kind_ptr:
+            {
+                auto dest=loadFrom(address);
+                copyTo(dest.reg, value.reg, address.type);
+                return;
+            }
+            default:
+                fail("storing values of this type");
+                return;
+        }
+        emit(op, address.reg, value.reg, address.offset);
+    }
+    void VBytecodeCompiler::copyTo(uint16_t dest, uint16_t src, types::Base* type)
+    {
+        Value size;
+        size.i=getSize(type);
+        emit(op_copy, dest, src, loadConstant(size, -1));
+    }
+
+    VBytecodeCompiler::Operand VBytecodeCompiler::createBinaryOperation(Operand lhs, Operand rhs, VToken* const op, int target)
+    {
+        if(lhs.kind==kind_ptr || rhs.kind==kind_ptr)
+            return fail("operators on arrays and structs");
+
+        bool expr_is_fp=isKindFloatingPoint(lhs.kind);
+        bool is_i32=(lhs.kind==kind_i32);
+        auto kind=lhs.kind;
+
+        Opcode code;
+        switch(op->type)
+        {
+            case tok_plus:  code=expr_is_fp?op_fadd:(is_i32?op_add32:op_add64); break;
+            case tok_minus: code=expr_is_fp?op_fsub:(is_i32?op_sub32:op_sub64); break;
+            case tok_mul:   code=expr_is_fp?op_fmul:(is_i32?op_mul32:op_mul64); break;
+            case tok_div:   code=expr_is_fp?op_fdiv:(is_i32?op_div32:op_div64); break;
+            case tok_mod:
+            {
+                if(expr_is_fp)
+                    return fail("`%` on floating point values");
+                code=is_i32?op_rem32:op_rem64;
+                break;
+            }
+
+            case tok_lessthan:  code=expr_is_fp?op_flt:op_lt; kind=kind_i1; break;
+            case tok_morethan:  code=expr_is_fp?op_fgt:op_gt; kind=kind_i1; break;
+            case tok_dequal:    code=expr_is_fp?op_feq:op_eq; kind=kind_i1; break;
+            case tok_nequal:    code=expr_is_fp?op_fne:op_ne; kind=kind_i1; break;
+            case tok_moreeq:    code=expr_is_fp?op_fge:op_ge; kind=kind_i1; break;
+            case tok_lesseq:    code=expr_is_fp?op_fle:op_le; kind=kind_i1; break;
+
+            default:
+                return fail("the operator `"+std::string(op->value)+"`");
+        }
+
+        auto dest=target>=0?(uint16_t)target:allocate();
+        emit(code, dest, lhs.reg, rhs.reg);
+        if(kind==lhs.kind && !is_i32)
+            normalize(dest, kind);
+
+        return Operand{dest, kind};
+    }
+
+    VBytecodeCompiler::Operand VBytecodeCompiler::compileExpr(ExprAST* const expr, int target)
+    {
+        if(failed)
+            return Operand{0, kind_void};
+
+        switch(expr->asttype)
+        {
+            case ast_int:
+            {
+                Value value;
+                value.i=((IntExprAST*)expr)->getValue();
+                return Operand{loadConstant(value, target), kind_i32};
+            }
+            case ast_char:
+            {
+                Value value;
+                value.i=((CharExprAST*)expr)->getValue();
+                return Operand{loadConstant(value, target), kind_i8};
+            }
+            case ast_bool:
+            {
+                Value value;
+                value.i=((BoolExprAST*)expr)->getValue();
+                return Operand{loadConstant(value, target), kind_i1};
+            }
+            case ast_float:
+            case ast_double:
+            {
+                bool is_float=(expr->asttype==ast_float);
+                Value value;
+                value.d=is_float?(double)((FloatExprAST*)expr)->getValue():((DoubleExprAST*)expr)->getValue();
+
+                auto reg=target>=0?(uint16_t)target:allocate();
+                current->constants.push_back(value);
+                auto load=emit(op_loadk, reg);
+                current->code[load].setImm(current->constants.size()-1);
+                return Operand{reg, is_float?kind_f32:kind_f64};
+            }
+            case ast_array:
+                return compileArray((ArrayExprAST*)expr);
+
+            case ast_incrdecr:
+                return compileIncrementDecrement((IncrementDecrementAST*)expr);
+            case ast_var:
+                return compileVariable((VariableExprAST*)expr);
+            case ast_vardef:
+                return compileVariableDefinition((VariableDefAST*)expr);
+            case ast_varassign:
+                return compileVariableAssign((VariableAssignAST*)expr);
+            case ast_array_access:
+            case ast_type_access:
+            {
+                auto address=compileAddress(expr);
+                if(failed)
+                    return Operand{0, kind_void};
+                return loadFrom(address, target);
+            }
+            case ast_cast:
+                return compileCastExpr((CastExprAST*)expr, target);
+            case ast_binop:
+                return compileBinopExpr((BinaryExprAST*)expr, target);
+            case ast_call:
+                return compileCallExpr((CallExprAST*)expr);
+            case ast_return:
+                return compileReturnExpr((ReturnExprAST*)expr);
+
+            case ast_ifelse:
+                compileIfElse((IfExprAST*)expr);
+                return Operand{0, kind_void};
+            case ast_for:
+                compileForExpr((ForExprAST*)expr);
+                return Operand{0, kind_void};
+            case ast_while:
+                compileWhileExpr((WhileExprAST*)expr);
+                return Operand{0, kind_void};
+            case ast_break:
+                compileBreakExpr((BreakExprAST*)expr);
+                return Operand{0, kind_void};
+            case ast_continue:
+                compileContinueExpr((ContinueExprAST*)expr);
+                return Operand{0, kind_void};
+
+            case ast_str:           return fail("strings");
+            default:                return fail("this expression");
+        }
+    }
+    void VBytecodeCompiler::compileBlock(std::vector<std::unique_ptr<ExprAST>> const& block)
+    {
+        for(auto const& expr : block)
+        {
+            if(expr->asttype==ast_vardef && ((VariableDefAST*)expr.get())->isArgument())
+                continue;
+
+            // Temporaries only live as long as the statement that made them
+            auto statement_start=next_register;
+            compileExpr(expr.get());
+            next_register=statement_start;
+        }
+    }
+
+    // Array literals are constants, they are laid out in the function's data once and copied from there
+    VBytecodeCompiler::Operand VBytecodeCompiler::compileArray(ArrayExprAST* const array)
+    {
+        std::vector<uint8_t> bytes;
+        auto append=[&bytes](void const* value, std::size_t size)
+        {
+            auto const* raw=(uint8_t const*)value;
+            bytes.insert(bytes.end(), raw, raw+size);
+        };
+
+        // Nested literals are flattened in order, like the rows of the compiled constant
+        std::vector<std::pair<ArrayExprAST*, std::size_t>> pending={{array, 0}};
+        while(!pending.empty())
+        {
+            auto& [top, position]=pending.back();
+            if(position==top->getElements().size())
+            {
+                pending.pop_back();
+                continue;
+            }
+
+            auto* elem=top->getElements()[position++].get();
+            switch(elem->asttype)
+            {
+                case ast_array:
+                    pending.emplace_back((ArrayExprAST*)elem, 0);
+                    break;
+                case ast_int:
+                {
+                    int32_t value=((IntExprAST*)elem)->getValue();
+                    append(&value, sizeof(value));
+                    break;
+                }
+                case ast_char:
+                {
+                    int8_t value=((CharExprAST*)elem)->getValue();
+                    append(&value, sizeof(value));
+                    break;
+                }
+                case ast_bool:
+                {
+                    uint8_t value=((BoolExprAST*)elem)->getValue();
+                    append(&value, sizeof(value));
+                    break;
+                }
+                case ast_float:
+                {
+                    float value=((FloatExprAST*)elem)->getValue();
+                    append(&value, sizeof(value));
+                    break;
+                }
+                case ast_double:
+                {
+                    double value=((DoubleExprAST*)elem)->getValue();
+                    append(&value, sizeof(value));
+                    break;
+                }
+                default:
+                    return fail("array elements that are not constants");
+            }
+        }
+
+        // Kept 8 byte aligned so any element can be read in place
+        auto offset=(current->data.size()+7)/8*8;
+        current->data.resize(offset);
+        current->data.insert(current->data.end(), bytes.begin(), bytes.end());
+
+        auto reg=allocate();
+        auto load=emit(op_data, reg);
+        current->code[load].setImm(offset);
+        return Operand{reg, kind_ptr};
+    }
+    VBytecodeCompiler::Address VBytecodeCompiler::compileArrayAccess(VariableArrayAccessAST* const access)
+    {
+        auto* type=access->getExpr()->getType();
+        auto base=compileExpr(access->getExpr());
+        if(failed || base.kind!=kind_ptr)
+        {
+            fail("indexing this value");
+            return Address{0, 0, type};
+        }
+
+        // One step per index, like the GEPs of the compiled code
+        auto reg=base.reg;
+        for(auto const& elem : access->getIndices())
+        {
+            if(type->getType()!=types::EType::Array)
+            {
+                fail("indexing this value");
+                return Address{0, 0, type};
+            }
+            type=((types::Array*)type)->getChild();
+
+            if(reg<first_temporary && hasSideEffects(elem.get()))
+            {
+                auto copy=allocate();
+                emit(op_mov, copy, reg);
+                reg=copy;
+            }
+            auto index=compileExpr(elem.get());
+
+            Value size;
+            size.i=getSize(type);
+            auto dest=loadConstant(size, -1);
+            emit(op_index, dest, reg, index.reg);
+            reg=dest;
+        }
+        return Address{reg, 0, type};
+    }
+    VBytecodeCompiler::Address VBytecodeCompiler::compileTypeAccess(TypeAccessAST* const access)
+    {
+        Address address{0, 0, access->getType()};
+        StructExprAST* st=nullptr;
+        ExprAST* current_expr=access;
+
+        // Every level adds the offset of its member, only the outermost struct is loaded
+        while(current_expr->asttype==ast_type_access)
+        {
+            auto* current_access=(TypeAccessAST*)current_expr;
+            auto* st_type=current_access->getParent()->getType();
+            if(!types::isUserDefined(st_type))
+            {
+                fail("accessing members of this value");
+                return address;
+            }
+            auto const& st_name=((types::Custom*)st_type)->getName();
+
+            if(st)
+            {
+                auto* member=st->getMember(st_name);
+                if(!member || member->asttype!=ast_struct)
+                {
+                    fail("struct members of another struct's type");
+                    return address;
+                }
+                st=(StructExprAST*)member;
+            }
+            else
+            {
+                auto parent=compileExpr(current_access->getParent());
+                if(failed || parent.kind!=kind_ptr)
+                {
+                    fail("accessing members of this value");
+                    return address;
+                }
+                address.reg=parent.reg;
+                st=analyzer->getStruct(st_name);
+                if(!st)
+                {
+                    fail("unions and classes");
+                    return address;
+                }
+            }
+
+            if(current_access->getChild()->asttype==ast_call)
+            {
+                fail("methods");
+                return address;
+            }
+
+            auto const* layout=getLayout(st);
+            if(!layout)
+                return address;
+
+            address.offset+=layout->offsets[st->getMemberIndex(current_access->getIName())];
+            current_expr=current_access->getChild();
+        }
+        return address;
+    }
+    VBytecodeCompiler::Address VBytecodeCompiler::compileAddress(ExprAST* const expr)
+    {
+        switch(expr->asttype)
+        {
+            case ast_array_access:  return compileArrayAccess((VariableArrayAccessAST*)expr);
+            case ast_type_access:   return compileTypeAccess((TypeAccessAST*)expr);
+            default:
+            {
+                auto value=compileExpr(expr);
+                if(!failed && value.kind!=kind_ptr)
+                    fail("taking the address of this value");
+                return Address{value.reg, 0, expr->getType()};
+            }
+        }
+    }
+
+    VBytecodeCompiler::Operand VBytecodeCompiler::compileVariable(VariableExprAST* const expr)
+    {
+        auto it=variables.find(expr->getName());
+        if(it==variables.end())
+            return fail("the variable `"+expr->getIName().name+"` here");
+
+        return Operand{it->second.reg, it->second.kind};
+    }
+    VBytecodeCompiler::Operand VBytecodeCompiler::compileVariableDefinition(VariableDefAST* const def)
+    {
+        auto it=variables.find(def->getName());
+        if(it==variables.end())
+            return fail("the variable `"+def->getIName().name+"` here");
+
+        auto var=it->second;
+        auto* value=def->getValue();
+        if(!value)
+            return Operand{var.reg, var.kind};
+
+        if(var.kind!=kind_ptr)
+        {
+            auto val=compileExpr(value, var.reg);
+            if(val.reg!=var.reg)
+                emit(op_mov, var.reg, val.reg);
+            return Operand{var.reg, var.kind};
+        }
+
+        // Constructors and functions returning an array or a struct write straight into the variable
+        if(value->asttype==ast_call)
+        {
+            compileCallExpr((CallExprAST*)value, var.reg);
+            return Operand{var.reg, var.kind};
+        }
+
+        auto val=compileExpr(value);
+        if(failed)
+            return val;
+
+        copyTo(var.reg, val.reg, def->getType());
+        return Operand{var.reg, var.kind};
+    }
+    VBytecodeCompiler::Operand VBytecodeCompiler::compileVariableAssign(VariableAssignAST* const assign)
+    {
+        auto* lhs_expr=assign->getLHS();
+        if(lhs_expr->asttype==ast_var)
+        {
+            auto lhs=compileVariable((VariableExprAST*)lhs_expr);
+            if(failed)
+                return lhs;
+
+            if(lhs.kind==kind_ptr)
+            {
+                if(assign->is_shorthand)
+                    return fail("operators on arrays and structs");
+
+                auto value=compileExpr(assign->getRHS());
+                if(!failed)
+                    copyTo(lhs.reg, value.reg, lhs_expr->getType());
+                return lhs;
+            }
+
+            if(assign->is_shorthand)
+            {
+                auto rhs=compileExpr(assign->getRHS());
+                return createBinaryOperation(lhs, rhs, assign->getShorthandOperator(), lhs.reg);
+            }
+
+            auto value=compileExpr(assign->getRHS(), lhs.reg);
+            if(value.reg!=lhs.reg)
+                emit(op_mov, lhs.reg, value.reg);
+
+            return lhs;
+        }
+
+        // An element or a member, its address is worked out before the value
+        auto address=compileAddress(lhs_expr);
+        if(failed)
+            return Operand{0, kind_void};
+
+        auto value=compileExpr(assign->getRHS());
+        if(assign->is_shorthand)
+            value=createBinaryOperation(loadFrom(address), value, assign->getShorthandOperator(), -1);
+        if(failed)
+            return value;
+
+        storeTo(address, value);
+        return value;
+    }
+    VBytecodeCompiler::Operand VBytecodeCompiler::compileIncrementDecrement(IncrementDecrementAST* const incrdecr)
+    {
+        auto* expr=incrdecr->getExpr();
+        bool in_memory=(expr->asttype!=ast_var);
+
+        Address address{0, 0, expr->getType()};
+        Operand var;
+        if(in_memory)
+        {
+            address=compileAddress(expr);
+            if(failed)
+                return Operand{0, kind_void};
+            var=loadFrom(address);
+        }
+        else
+        {
+            var=compileVariable((VariableExprAST*)expr);
+        }
+        if(failed)
+            return var;
+        if(var.kind==kind_ptr)
+            return fail("incrementing arrays and structs");
+
+        Operand result=var;
+        if(!incrdecr->isPre())
+        {
+            result.reg=allocate();
+            emit(op_mov, result.reg, var.reg);
+        }
+
+        if(isKindFloatingPoint(var.kind))
+        {
+            Value one;
+            one.d=1.0;
+            current->constants.push_back(one);
+            auto reg=allocate();
+            auto load=emit(op_loadk, reg);
+            current->code[load].setImm(current->constants.size()-1);
+
+            emit(incrdecr->isIncrement()?op_fadd:op_fsub, var.reg, var.reg, reg);
+            normalize(var.reg, var.kind);
+        }
+        else
+        {
+            int16_t step=incrdecr->isIncrement()?1:-1;
+            emit(var.kind==kind_i32?op_addi32:op_addi64, var.reg, var.reg, (uint16_t)step);
+            if(var.kind!=kind_i32)
+                normalize(var.reg, var.kind);
+        }
+
+        if(in_memory)
+            storeTo(address, var);
+        return result;
+    }
+    VBytecodeCompiler::Operand VBytecodeCompiler::compileCastExpr(CastExprAST* const cast_expr, int target)
+    {
+        if(!cast_expr->isNonUserDefined())
+            return fail("user defined casts");
+
+        auto* const dest_type=cast_expr->getDestType();
+        auto* const src_type=cast_expr->getSourceType();
+        if(!isScalar(dest_type) || !isScalar(src_type))
+            return fail("casts of arrays and structs");
+
+        bool is_dest_fp=types::isTypeFloatingPoint(dest_type);
+        bool is_src_fp=types::isTypeFloatingPoint(src_type);
+
+        auto expr=compileExpr(cast_expr->getExpr());
+        auto dest_kind=getKind(dest_type);
+        auto dest=target>=0?(uint16_t)target:allocate();
+
+        if(is_dest_fp xor is_src_fp)
+        {
+            if(is_dest_fp)
+            {
+                if(src_type->is_signed)
+                {
+                    emit(op_i2f, dest, expr.reg);
+                }
+                else
+                {
+                    emit(op_zext32, dest, expr.reg);
+                    emit(op_i2f, dest, dest);
+                }
+                normalize(dest, dest_kind);
+            }
+            else
+            {
+                emit(op_f2i, dest, expr.reg);
+                normalize(dest, dest_kind);
+            }
+            return Operand{dest, dest_kind};
+        }
+        else if(is_dest_fp and is_src_fp)
+        {
+            // Widening keeps the value, narrowing rounds it like the compiled fptrunc
+            if(dest_type->getSize() > src_type->getSize())
+            {
+                emit(op_mov, dest, expr.reg);
+                return Operand{dest, dest_kind};
+            }
+            emit(op_f32, dest, expr.reg);
+            return Operand{dest, getKind(src_type)};
+        }
+
+        if(dest_type->getSize() > src_type->getSize())
+        {
+            switch(expr.kind)
+            {
+                case kind_i1:  emit(op_zext1, dest, expr.reg); break;
+                case kind_i8:  emit(op_zext8, dest, expr.reg); break;
+                case kind_i16: emit(op_zext16, dest, expr.reg); break;
+                case kind_i32: emit(op_zext32, dest, expr.reg); break;
+                default:       emit(op_mov, dest, expr.reg); break;
+            }
+        }
+        else
+        {
+            emit(op_mov, dest, expr.reg);
+            normalize(dest, dest_kind);
+        }
+        return Operand{dest, dest_kind};
+    }
+    VBytecodeCompiler::Operand VBytecodeCompiler::compileBinopExpr(BinaryExprAST* const expr, int target)
+    {
+        auto lhs=compileExpr(expr->getLHS());
+
+        if(expr->getOp()->type!=tok_and && expr->getOp()->type!=tok_or)
+        {
+            if(lhs.reg<first_temporary && hasSideEffects(expr->getRHS()))
+            {
+                auto copy=allocate();
+                emit(op_mov, copy, lhs.reg);
+                lhs.reg=copy;
+            }
+
+            auto rhs=compileExpr(expr->getRHS());
+            if(failed)
+                return lhs;
+
+            return createBinaryOperation(lhs, rhs, expr->getOp(), target);
+        }
+
+        // Operator is either `and` or `or`, the right hand side only runs if it decides the result
+        bool type_is_and=(expr->getOp()->type==tok_and);
+        auto dest=allocate();
+
+        Value preset;
+        preset.i=!type_is_and;
+        loadConstant(preset, dest);
+        auto skip=emitJump(type_is_and?op_jz:op_jnz, -1, lhs.reg);
+
+        auto rhs=compileExpr(expr->getRHS(), dest);
+        if(rhs.reg!=dest)
+            emit(op_mov, dest, rhs.reg);
+        patch(skip, here());
+
+        return Operand{dest, kind_i1};
+    }
+    // A constructor, or a function returning an array or a struct, gets the memory to fill as its
+    // first argument. That is `dest` when the caller has one, a slot of the caller's frame otherwise
+    VBytecodeCompiler::Operand VBytecodeCompiler::compileCallExpr(CallExprAST* const expr, int dest)
+    {
+        auto* afunc=analyzer->getFunction(expr->getIName());
+        if(!afunc)
+            return fail("the call to `"+expr->getIName().name+"`");
+        if(afunc->doesRequireSelfRef() && !afunc->isConstructor())
+            return fail("methods");
+
+        bool hidden=afunc->isConstructor() || returnsAggregate(afunc);
+        Operand result{0, getKind(afunc->getReturnType())};
+        if(hidden)
+        {
+            result.kind=kind_ptr;
+            if(dest>=0)
+            {
+                result.reg=dest;
+            }
+            else
+            {
+                auto* type=afunc->isConstructor()?afunc->getArgs()[0]->getType():afunc->getReturnType();
+                result.reg=allocate();
+                auto slot=emit(op_frame, result.reg);
+                current->code[slot].setImm(allocateFrame(type));
+            }
+        }
+
+        auto const& args=expr->getArgs();
+        std::size_t count=args.size()+hidden;
+        auto base=allocate(count==0?1:count);
+        if(hidden)
+            emit(op_mov, base, result.reg);
+        else
+            result.reg=base;
+
+        for(std::size_t i=0; i<args.size(); ++i)
+        {
+            auto slot=base+hidden+i;
+            auto arg=compileExpr(args[i].get(), slot);
+            if(arg.reg!=slot)
+                emit(op_mov, slot, arg.reg);
+        }
+
+        if(afunc->is_extern())
+        {
+            auto it=extern_indices.find(afunc);
+            if(it==extern_indices.end())
+                return fail("the call to `"+expr->getIName().name+"`");
+            emit(op_callx, base, it->second, count);
+        }
+        else
+        {
+            auto it=function_indices.find(afunc);
+            if(it==function_indices.end())
+                return fail("the call to `"+expr->getIName().name+"`");
+            emit(op_call, base, it->second, count);
+        }
+
+        return result;
+    }
+    VBytecodeCompiler::Operand VBytecodeCompiler::compileReturnExpr(ReturnExprAST* const expr)
+    {
+        if(!expr->getValue())
+        {
+            emit(op_retv);
+            return Operand{0, kind_void};
+        }
+
+        auto value=compileExpr(expr->getValue());
+        if(returnsAggregate(current_ast))
+        {
+            copyTo(0, value.reg, current_ast->getReturnType());
+            emit(op_retv);
+            return value;
+        }
+
+        emit(op_ret, value.reg);
+        return value;
+    }
+
+    void VBytecodeCompiler::compileIfThen(IfThenExpr* const ifthen)
+    {
+        auto cond=compileExpr(ifthen->getCondition());
+        auto jump=emitJump(op_jz, -1, cond.reg);
+
+        compileBlock(ifthen->getThenBlock());
+        patch(jump, here());
+    }
+    void VBytecodeCompiler::compileIfElse(IfExprAST* const ifelse)
+    {
+        compileIfThen(ifelse->getIfThen());
+
+        for(auto const& elseif : ifelse->getElifLadder())
+        {
+            if(elseif->getCondition()!=nullptr)
+            {
+                compileIfThen(elseif.get());
+            }
+            else
+            {
+                compileBlock(elseif->getThenBlock());
+                break;
+            }
+        }
+    }
+
+    // Like the compiled loops, `break` and `continue` go to the loop that was started last
+    void VBytecodeCompiler::compileForExpr(ForExprAST* const forexpr)
+    {
+        compileExpr(forexpr->getInit());
+
+        auto cond_start=here();
+        auto cond=compileExpr(forexpr->getCond());
+        auto exit=emitJump(op_jz, -1, cond.reg);
+
+        loops.emplace_back();
+        current_loop=loops.size()-1;
+        auto loop=current_loop;
+        loops[loop].body=here();
+
+        compileBlock(forexpr->getBody());
+        auto statement_start=next_register;
+        compileExpr(forexpr->getIncr());
+        next_register=statement_start;
+        emitJump(op_loop, cond_start);
+
+        patch(exit, here());
+        loops[loop].end=here();
+        for(auto jump : loops[loop].breaks)
+            patch(jump, here());
+    }
+    void VBytecodeCompiler::compileWhileExpr(WhileExprAST* const whileexpr)
+    {
+        auto cond_start=here();
+        auto cond=compileExpr(whileexpr->getCond());
+        auto exit=emitJump(op_jz, -1, cond.reg);
+
+        loops.emplace_back();
+        current_loop=loops.size()-1;
+        auto loop=current_loop;
+        loops[loop].body=here();
+
+        compileBlock(whileexpr->getBody());
+        emitJump(op_loop, cond_start);
+
+        patch(exit, here());
+        loops[loop].end=here();
+        for(auto jump : loops[loop].breaks)
+            patch(jump, here());
+    }
+    void VBytecodeCompiler::compileBreakExpr(BreakExprAST* const breakexpr)
+    {
+        if(auto* after=breakexpr->getAfterBreak())
+            compileExpr(after);
+        if(current_loop<0)
+        {
+            fail("`break` outside of a loop");
+            return;
+        }
+
+        auto& loop=loops[current_loop];
+        if(loop.end>=0)
+            emitJump(op_jmp, loop.end);
+        else
+            loop.breaks.push_back(emitJump(op_jmp));
+    }
+    void VBytecodeCompiler::compileContinueExpr(ContinueExprAST* const continueexpr)
+    {
+        if(auto* after=continueexpr->getAfterCont())
+            compileExpr(after);
+        if(current_loop<0)
+        {
+            fail("`continue` outside of a loop");
+            return;
+        }
+
+        emitJump(op_loop, loops[current_loop].body);
+    }
+
+    bool VBytecodeCompiler::getSignature(FunctionBaseAST* const func, Signature& signature)
+    {
+        if(func->isConstructor())
+        {
+            signature.ret=kind_void;
+        }
+        else if(returnsAggregate(func))
+        {
+            signature.args.push_back(kind_ptr);
+            signature.ret=kind_void;
+        }
+        else if(isScalar(func->getReturnType()))
+        {
+            signature.ret=getKind(func->getReturnType());
+        }
+        else
+        {
+            return false;
+        }
+
+        for(auto const& arg : func->getArgs())
+        {
+            if(!isScalar(arg->getType()) && !isAggregate(arg->getType()))
+                return false;
+            signature.args.push_back(getKind(arg->getType()));
+        }
+        return true;
+    }
+    bool VBytecodeCompiler::returnsAggregate(FunctionBaseAST* const func) const
+    {
+        return !func->isConstructor() && isAggregate(func->getReturnType());
+    }
+    void VBytecodeCompiler::beginFunction(BytecodeFunction* function)
+    {
+        current=function;
+        variables.clear();
+        loops.clear();
+        current_loop=-1;
+        first_temporary=next_register=0;
+    }
+    bool VBytecodeCompiler::endFunction()
+    {
+        emit(op_retv);
+        current=nullptr;
+        current_ast=nullptr;
+        return !failed;
+    }
+    // Scalars live in their register, arrays and structs in the frame with their address in it
+    bool VBytecodeCompiler::defineLocal(std::string const& name, types::Base* type)
+    {
+        auto kind=getKind(type);
+        if(kind==kind_void)
+        {
+            fail("variables of this type");
+            return false;
+        }
+
+        auto reg=allocate();
+        variables[name]=Variable{reg, kind};
+        if(kind==kind_ptr)
+        {
+            auto slot=emit(op_frame, reg);
+            current->code[slot].setImm(allocateFrame(type));
+        }
+        return !failed;
+    }
+    bool VBytecodeCompiler::compileFunction(FunctionAST* const func, BytecodeFunction* function)
+    {
+        beginFunction(function);
+        current_ast=func;
+
+        // Arguments come first, in order, then every other local gets a register of its own
+        bool sret=returnsAggregate(func);
+        auto const& args=func->getArgs();
+        for(std::size_t i=0; i<args.size(); ++i)
+            variables[args[i]->getName()]=Variable{(uint16_t)(i+sret), getKind(args[i]->getType())};
+        next_register=args.size()+sret;
+        if(function->register_count<next_register)
+            function->register_count=next_register;
+
+        for(auto const& [vname, var] : func->getLocals())
+        {
+            if(var->isArgument() || variables.count(vname))
+                continue;
+            if(!defineLocal(vname, var->getType()))
+                return endFunction();
+        }
+        first_temporary=next_register;
+
+        // Structs are passed by value, the callee works on a copy of its own
+        for(std::size_t i=0; i<args.size(); ++i)
+        {
+            if(!types::isUserDefined(args[i]->getType()) || (func->isConstructor() && i==0))
+                continue;
+
+            auto reg=(uint16_t)(i+sret);
+            auto copy=allocate();
+            auto slot=emit(op_frame, copy);
+            current->code[slot].setImm(allocateFrame(args[i]->getType()));
+            copyTo(copy, reg, args[i]->getType());
+            emit(op_mov, reg, copy);
+            next_register=first_temporary;
+        }
+
+        compileBlock(func->getBody());
+        return endFunction();
+    }
+    // The program's `main` runs the global statements and returns what the user's `main` does
+    bool VBytecodeCompiler::compileEntry(BytecodeFunction* function)
+    {
+        beginFunction(function);
+
+        auto* mod=analyzer->getSourceModule();
+        for(auto const& var : mod->getPreExecutionStatementsVariables())
+        {
+            if(!defineLocal(var->getName(), var->getType()))
+                return endFunction();
+        }
+        first_temporary=next_register;
+
+        for(auto const& e : mod->getPreExecutionStatements())
+        {
+            auto statement_start=next_register;
+            compileExpr(e.get());
+            next_register=statement_start;
+        }
+
+        for(auto const& [func, index] : function_indices)
+        {
+            if(func->getIName().name!="main" || func->isConstructor())
+                continue;
+
+            auto reg=allocate();
+            emit(op_call, reg, index, 0);
+            if(getKind(func->getReturnType())!=kind_void)
+            {
+                emit(op_ret, reg);
+                return endFunction();
+            }
+        }
+
+        Value zero;
+        zero.i=0;
+        emit(op_ret, loadConstant(zero, -1));
+        return endFunction();
+    }
+    bool VBytecodeCompiler::addFunction(FunctionAST* const func, std::vector<std::pair<FunctionAST*, BytecodeFunction*>>& bodies)
+    {
+        auto function=std::make_unique<BytecodeFunction>();
+        function->name=func->getIName().name;
+        function->native_name=(function->name=="main")?"entry_main":func->getName();
+        if(!getSignature(func, function->signature))
+        {
+            current=function.get();
+            fail("arguments and return values of this type");
+            current=nullptr;
+            return false;
+        }
+        // Only scalars can be handed to native code, memory in the interpreter's frames is not the JIT's
+        function->promotable=fitsInRegisters(function->signature);
+
+        function_indices[func]=module->functions.size();
+        bodies.emplace_back(func, function.get());
+        module->functions.push_back(std::move(function));
+        return true;
+    }
+
+    std::unique_ptr<BytecodeModule> VBytecodeCompiler::compileModule()
+    {
+        auto* mod=analyzer->getSourceModule();
+        types::TypeContextScope type_scope(analyzer->getTypeContext());
+
+        failed=false;
+        module=std::make_unique<BytecodeModule>();
+        layouts.clear();
+
+        if(!mod->getClasses().empty())
+        {
+            fail("classes");
+            return nullptr;
+        }
+
+        // Every callee needs an index before the first body refers to it
+        std::vector<std::pair<FunctionAST*, BytecodeFunction*>> bodies;
+        for(auto const& s : mod->getUnionStructs())
+        {
+            if(s->asttype!=ast_struct)
+            {
+                fail("unions");
+                return nullptr;
+            }
+            if(auto* constructor=((StructExprAST*)s.get())->getConstructor())
+            {
+                if(!addFunction(constructor, bodies))
+                    return nullptr;
+            }
+        }
+        for(auto const& f : mod->getFunctions())
+        {
+            if(f->is_extern())
+            {
+                Signature signature;
+                bool scalar=getSignature(f.get(), signature) && !returnsAggregate(f.get());
+                for(auto kind : signature.args)
+                    scalar=scalar && kind!=kind_ptr;
+
+                if(!scalar)
+                {
+                    fail("externs taking or returning arrays and structs");
+                    return nullptr;
+                }
+                extern_indices[f.get()]=module->externs.size();
+                module->externs.push_back(BytecodeExtern{f->getIName().name, std::move(signature)});
+                continue;
+            }
+            if(f->is_proto())
+                continue;
+
+            if(!addFunction((FunctionAST*)f.get(), bodies))
+                return nullptr;
+        }
+
+        for(auto& [func, function] : bodies)
+        {
+            if(!compileFunction(func, function))
+                return nullptr;
+        }
+
+        auto entry=std::make_unique<BytecodeFunction>();
+        entry->name="main";
+        entry->native_name="main";
+        module->entry=module->functions.size();
+        module->functions.push_back(std::move(entry));
+        if(!compileEntry(module->functions.back().get()))
+            return nullptr;
+
+        return std::move(module);
+    }
+}
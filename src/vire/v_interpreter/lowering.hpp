@@ -0,0 +1,134 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "vire/ast/include.hpp"
+#include "vire/v_analyzer/include.hpp"
+
+#include "bytecode.hpp"
+
+namespace vire
+{
+
+// VBytecodeCompiler - Lowers a verified module to bytecode. It follows VCompiler construct by
+// construct, down to how `else` blocks and `continue` are laid out, so a function gives the same
+// results interpreted as compiled and the two can be swapped while a program runs
+class VBytecodeCompiler
+{
+    struct Operand
+    {
+        uint16_t reg;
+        ValueKind kind;
+    };
+    // Where an array element or a struct member is, `offset` bytes past the pointer in `reg`
+    struct Address
+    {
+        uint16_t reg;
+        uint32_t offset;
+        types::Base* type;
+    };
+    struct Loop
+    {
+        int32_t body=0;
+        int32_t end=-1;
+        std::vector<std::size_t> breaks;
+    };
+    struct Variable
+    {
+        uint16_t reg;
+        ValueKind kind;
+    };
+    // Members are laid out like the LLVM struct, in reverse order of declaration
+    struct Layout
+    {
+        uint32_t size=0;
+        uint32_t align=1;
+        std::vector<uint32_t> offsets;
+    };
+
+    VAnalyzer* analyzer;
+    std::unique_ptr<BytecodeModule> module;
+    std::unordered_map<FunctionBaseAST const*, std::size_t> function_indices;
+    std::unordered_map<FunctionBaseAST const*, std::size_t> extern_indices;
+    std::unordered_map<StructExprAST const*, Layout> layouts;
+
+    // Current function
+    BytecodeFunction* current;
+    FunctionAST* current_ast;
+    std::unordered_map<std::string, Variable> variables;
+    uint32_t first_temporary;
+    uint32_t next_register;
+    std::vector<Loop> loops;
+    int current_loop;
+    bool failed;
+private:
+    Operand fail(std::string const& what);
+
+    uint16_t allocate(unsigned int count=1);
+    uint32_t allocateFrame(types::Base* type);
+    std::size_t emit(Opcode op, uint16_t a=0, uint16_t b=0, uint16_t c=0);
+    std::size_t emitJump(Opcode op, int32_t target=-1, uint16_t a=0);
+    void patch(std::size_t jump, int32_t target);
+    int32_t here() const;
+    uint16_t loadConstant(Value value, int target);
+    void normalize(uint16_t reg, ValueKind kind);
+    bool hasSideEffects(ExprAST* const expr) const;
+
+    Layout const* getLayout(StructExprAST* const st);
+    bool getSizeAndAlign(types::Base* type, uint32_t& size, uint32_t& align);
+    uint32_t getSize(types::Base* type);
+    bool isAggregate(types::Base* type) const;
+
+    Address fitOffset(Address address);
+    Operand loadFrom(Address address, int target=-1);
+    void storeTo(Address address, Operand value);
+    void copyTo(uint16_t dest, uint16_t src, types::Base* type);
+
+    Operand createBinaryOperation(Operand lhs, Operand rhs, VToken* const op, int target);
+    Operand compileExpr(ExprAST* const expr, int target=-1);
+    void compileBlock(std::vector<std::unique_ptr<ExprAST>> const& block);
+
+    Operand compileArray(ArrayExprAST* const array);
+    Address compileArrayAccess(VariableArrayAccessAST* const access);
+    Address compileTypeAccess(TypeAccessAST* const access);
+    Address compileAddress(ExprAST* const expr);
+
+    Operand compileVariable(VariableExprAST* const expr);
+    Operand compileVariableDefinition(VariableDefAST* const def);
+    Operand compileVariableAssign(VariableAssignAST* const assign);
+    Operand compileIncrementDecrement(IncrementDecrementAST* const incrdecr);
+    Operand compileCastExpr(CastExprAST* const cast_expr, int target);
+    Operand compileBinopExpr(BinaryExprAST* const expr, int target);
+    Operand compileCallExpr(CallExprAST* const expr, int dest=-1);
+    Operand compileReturnExpr(ReturnExprAST* const expr);
+
+    void compileIfThen(IfThenExpr* const ifthen);
+    void compileIfElse(IfExprAST* const ifelse);
+    void compileForExpr(ForExprAST* const forexpr);
+    void compileWhileExpr(WhileExprAST* const whileexpr);
+    void compileBreakExpr(BreakExprAST* const breakexpr);
+    void compileContinueExpr(ContinueExprAST* const continueexpr);
+
+    bool getSignature(FunctionBaseAST* const func, Signature& signature);
+    bool returnsAggregate(FunctionBaseAST* const func) const;
+    void beginFunction(BytecodeFunction* function);
+    bool endFunction();
+    bool defineLocal(std::string const& name, types::Base* type);
+    bool compileFunction(FunctionAST* const func, BytecodeFunction* function);
+    bool compileEntry(BytecodeFunction* function);
+    bool addFunction(FunctionAST* const func, std::vector<std::pair<FunctionAST*, BytecodeFunction*>>& bodies);
+public:
+    VBytecodeCompiler(VAnalyzer* analyzer)
+    : analyzer(analyzer), current(nullptr), current_ast(nullptr), first_temporary(0), next_register(0), current_loop(-1), failed(false)
+    {}
+
+    static ValueKind getKind(types::Base* type);
+
+    // Returns nullptr, after saying why, if the module uses something the interpreter cannot run
+    std::unique_ptr<BytecodeModule> compileModule();
+};
+
+}
@@ -0,0 +1,94 @@
+#include "tiering.hpp"
+
+#ifndef VIRE_USE_EMCC
+
+#include <iostream>
+#include <ostream>
+
+#include "llvm/IR/Verifier.h"
+#include "llvm/Support/raw_ostream.h"
+
+namespace vire
+{
+    VTierCompiler::~VTierCompiler()
+    {
+        stop();
+    }
+
+    void VTierCompiler::request(BytecodeFunction* function)
+    {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            if(stopping || failed)
+                return;
+
+            requests.push_back(function);
+            if(!thread.joinable())
+                thread=std::thread(&VTierCompiler::work, this);
+        }
+        wake.notify_one();
+    }
+    void VTierCompiler::stop()
+    {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stopping=true;
+        }
+        wake.notify_one();
+
+        if(thread.joinable())
+            thread.join();
+        if(loaded)
+        {
+            compiler->unloadJIT();
+            loaded=false;
+        }
+    }
+
+    bool VTierCompiler::load()
+    {
+        compiler->compileModule();
+
+        std::string errs;
+        llvm::raw_string_ostream os(errs);
+        if(llvm::verifyModule(*compiler->getModule(), &os))
+        {
+            std::cout << "Could not promote to native code, the module does not verify" << std::endl;
+            return false;
+        }
+        return compiler->loadJIT(opt_level, true);
+    }
+    void VTierCompiler::work()
+    {
+        while(true)
+        {
+            BytecodeFunction* function;
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                wake.wait(guard, [this]() { return stopping || !requests.empty(); });
+                if(stopping)
+                    return;
+
+                function=requests.front();
+                requests.pop_front();
+            }
+
+            if(!loaded)
+            {
+                loaded=load();
+                if(!loaded)
+                {
+                    std::lock_guard<std::mutex> guard(lock);
+                    failed=true;
+                    return;
+                }
+            }
+
+            // The interpreter keeps running this function until the address shows up
+            if(void* address=compiler->lookupJIT(function->native_name))
+                function->native.store(address, std::memory_order_release);
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,52 @@
+#pragma once
+
+#ifndef VIRE_USE_EMCC
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include "vire/v_compiler/include.hpp"
+
+#include "bytecode.hpp"
+
+namespace vire
+{
+
+// VTierCompiler - Compiles the functions the interpreter promotes on a thread of its own. The
+// module is generated and loaded into a lazy JIT with the first request, after that each request
+// only compiles the function asked for, which is then published through its `native` address
+class VTierCompiler
+{
+    VCompiler* compiler;
+    Optimization opt_level;
+
+    std::thread thread;
+    std::mutex lock;
+    std::condition_variable wake;
+    std::deque<BytecodeFunction*> requests;
+    bool stopping;
+    bool loaded;
+    bool failed;
+private:
+    void work();
+    bool load();
+public:
+    VTierCompiler(VCompiler* compiler, Optimization opt_level=Optimization::O2)
+    : compiler(compiler), opt_level(opt_level), stopping(false), loaded(false), failed(false)
+    {}
+    ~VTierCompiler();
+
+    VTierCompiler(VTierCompiler const&)=delete;
+    VTierCompiler& operator=(VTierCompiler const&)=delete;
+
+    // Safe to call from the interpreter, the thread is started by the first request
+    void request(BytecodeFunction* function);
+    // Waits for the compile thread and unloads what it compiled, no native code may run after this
+    void stop();
+};
+
+}
+
+#endif
@@ -0,0 +1,82 @@
+#include "vire/ast/include.hpp"
+#include "vire/lex/include.hpp"
+#include "vire/parse/include.hpp"
+#include "vire/errors/include.hpp"
+#include "vire/proto/include.hpp"
+#include "vire/v_analyzer/include.hpp"
+#include "vire/v_interpreter/include.hpp"
+
+#include <iostream>
+#include <memory>
+#include <ostream>
+#include <string>
+
+#ifdef VIRE_USE_EMCC
+#include <emscripten/bind.h>
+#endif
+
+// The bytecode-only front end, it parses, verifies and interprets a program without VApi or
+// VCompiler, so nothing it links generates code. The wasm build uses it with VIRE_BYTECODE_ONLY
+namespace vire
+{
+
+// Runs the program's `main`, -1 if it did not parse, verify or run
+int runSource(std::shared_ptr<const proto::SourceBuffer> source, std::string const& name)
+{
+    proto::SourceManager sources;
+    auto start=sources.addBuffer(source, name);
+    types::TypeContext type_context;
+    errors::ErrorBuilder ebuilder("This program");
+
+    auto lexer=std::make_unique<VLexer>(std::move(source), &ebuilder, start);
+    VParser parser(std::move(lexer), nullptr, true, &type_context);
+    VAnalyzer analyzer(&ebuilder, &sources, &type_context);
+    analyzer.setThreadCount(1);
+
+    auto ast=parser.ParseSourceModule();
+    if(!ast || !analyzer.verifySourceModule(std::move(ast)))
+    {
+        ebuilder.showErrors();
+        return -1;
+    }
+
+    VBytecodeCompiler lowering(&analyzer);
+    auto module=lowering.compileModule();
+    if(!module)
+        return -1;
+
+    int exit_code=-1;
+    VInterpreter interpreter(module.get());
+    if(!interpreter.run(exit_code))
+        return -1;
+    return exit_code;
+}
+
+}
+
+#ifndef VIRE_USE_EMCC
+int main(int argc, char** argv)
+{
+    if(argc<2)
+    {
+        std::cout << "No file to run was given" << std::endl;
+        return 1;
+    }
+    return vire::runSource(vire::proto::SourceBuffer::fromFile(argv[1]), argv[1]);
+}
+#endif
+
+#ifdef VIRE_USE_EMCC
+EMSCRIPTEN_BINDINGS(VIRE_VM)
+{
+    emscripten::function("RunBytecode", emscripten::optional_override([](std::string code)
+    {
+        return vire::runSource(vire::proto::SourceBuffer::fromString(std::move(code)), "<text>");
+    }));
+}
+
+int main()
+{
+    return 0;
+}
+#endif